@@ -109,6 +109,73 @@ extern "C" {
     |  1 |  - |    -    |  -  |  1  |  1  |  1  |     2    | 256x192 resolution graphics 6 (RG6)
 
     The CSS pins select between 2 possible color sets.
+
+    Dirty tracking
+
+    With dirty_tracking enabled in the setup parameters, a line of the
+    framebuffer is only decoded again when it was marked as dirty, or when
+    the control pins at the start of the line differ from the last time
+    the line was decoded. The system must report each video memory write
+    with mc6847_invalidate_addr() (with the address as the MC6847 would
+    fetch it), and call mc6847_invalidate() when the video memory changed
+    in any other way. Changing the graphics mode pins, the colors or the
+    framebuffer pointer invalidates all lines.
+
+    Colors
+
+    The palette, black and alnum colors may be changed at any time, the
+    pixel lookup tables are rebuilt (and all lines redrawn) at the start
+    of the next field.
+
+    Direct video memory
+
+    Instead of calling the fetch callback for each byte, the MC6847 can
+    read a linear video memory directly (desc.vram and desc.vram_size).
+    In the alphanumeric and semigraphics modes, each address below
+    attr_offset has an attribute byte at addr+attr_offset, whose
+    attr_inv, attr_css, attr_intext and attr_as bits set the respective
+    control pins for the character, like a fetch callback could do.
+    Systems with other mappings must use the fetch callback.
+
+    The frame_changed flag is updated at the end of each field and is
+    false if no line of the framebuffer was written during the field.
+    The change_count is incremented for each line written (and in indexed
+    mode when the colors change), a renderer which remembers it can skip
+    uploading frames which didn't change, even if it doesn't see every
+    field. To decode into rotating framebuffers without losing the dirty
+    state, switch buffers with mc6847_move_buffer().
+
+    Indexed output
+
+    With desc.index8_buffer, the MC6847 writes one byte per pixel into
+    that buffer instead of RGBA8 pixels: the index of the color in the
+    list returned by mc6847_colors() (MC6847_COLOR_*). The color lookup
+    is left to the renderer (for instance in a shader), color changes
+    then don't need to redraw anything on the CPU side.
+
+    External decoding
+
+    With desc.external_decode, the MC6847 doesn't write a framebuffer at
+    all, it only runs the fetches that decide the control pins and
+    records the control pins at the start of each line. At the end of a
+    field, mc6847_frame_data() packs everything a renderer needs to decode
+    the frame itself (for instance in a fragment shader) into a block of
+    MC6847_FRAME_DATA_SIZE bytes:
+
+        MC6847_FRAME_VRAM   8 KB video memory
+        MC6847_FRAME_CELLS  the INV, CSS, INT/EXT and AS pins of each of
+                            the 512 alphanumeric cells (from the attribute
+                            bytes)
+        MC6847_FRAME_FONT   the internal font, 64 characters of 12 lines
+        MC6847_FRAME_LINES  the control pins at the start of each line of
+                            the framebuffer
+
+    The control pins are stored as one byte with AG in bit 0, then AS,
+    INT/EXT, INV, GM0, GM1, GM2 and CSS in bit 7. External decoding needs
+    direct video memory with attribute bytes. The frame is decoded from
+    the video memory at the end of the field, so video memory writes in
+    the middle of a field (raster effects) aren't visible, mode and CSS
+    changes between lines are. The change_count works as in indexed mode.
 */
 
 /* address bus pins */
@@ -192,6 +259,24 @@ extern "C" {
 /* fixed point precision for more precise error accumulation */
 #define MC6847_FIXEDPOINT_SCALE (16)
 
+/* number of distinct colors (palette, black and the 4 alpha-numeric colors) */
+#define MC6847_NUM_COLORS (13)
+
+/* color indices of the indexed output */
+#define MC6847_COLOR_PALETTE            (0)     /* 8 graphics mode colors */
+#define MC6847_COLOR_BLACK              (8)
+#define MC6847_COLOR_ALNUM_GREEN        (9)
+#define MC6847_COLOR_ALNUM_DARK_GREEN   (10)
+#define MC6847_COLOR_ALNUM_ORANGE       (11)
+#define MC6847_COLOR_ALNUM_DARK_ORANGE  (12)
+
+/* the frame data layout for external decoding */
+#define MC6847_FRAME_VRAM       (0x0000)    /* 8 KB video memory */
+#define MC6847_FRAME_CELLS      (0x2000)    /* control pins of the 32x16 alphanumeric cells */
+#define MC6847_FRAME_FONT       (0x2200)    /* internal font, 64 characters * 12 lines */
+#define MC6847_FRAME_LINES      (0x2500)    /* control pins at the start of each framebuffer line */
+#define MC6847_FRAME_DATA_SIZE  (0x2600)
+
 /* a memory-fetch callback, used to read video memory bytes into the MC6847 */
 typedef uint64_t (*mc6847_fetch_t)(uint64_t pins, void* user_data);
 
@@ -203,19 +288,38 @@ typedef struct {
     uint32_t* rgba8_buffer;
     /* size of rgba8_buffer in bytes (must be at least 320*244*4=312320 bytes) */
     uint32_t rgba8_buffer_size;
+    /* optional 8-bit color index framebuffer, used instead of rgba8_buffer (see Indexed output) */
+    uint8_t* index8_buffer;
+    /* size of index8_buffer in bytes (must be at least 320*244=78080 bytes) */
+    uint32_t index8_buffer_size;
+    /* don't write a framebuffer, the renderer decodes mc6847_frame_data() (see External decoding) */
+    bool external_decode;
     /* memory-fetch callback */
     mc6847_fetch_t fetch_cb;
     /* optional user-data for the fetch callback */
     void* user_data;
+    /* optional direct video memory access instead of the fetch callback (see Direct video memory) */
+    const uint8_t* vram;
+    /* size of the video memory in bytes, must be a power of 2 */
+    uint32_t vram_size;
+    /* offset of the attribute bytes, 0 if there are none */
+    uint16_t attr_offset;
+    /* the attribute bits which drive the INV, CSS, INT/EXT and AS pins */
+    uint8_t attr_inv;
+    uint8_t attr_css;
+    uint8_t attr_intext;
+    uint8_t attr_as;
+    /* only decode lines which have changed (see Dirty tracking) */
+    bool dirty_tracking;
 } mc6847_desc_t;
 
 /* the mc6847 state struct */
 typedef struct {
     /* current pin state */
     uint64_t pins;
-    /* pins that transitioned from inactive-to-active during last tick */
+    /* pins that transitioned from inactive-to-active during last tick or exec */
     uint64_t on;
-    /* pins that transitioned from active-to-inactive during last tick */
+    /* pins that transitioned from active-to-inactive during last tick or exec */
     uint64_t off;
     /* the graphics mode color palette (RGBA8) */
     uint32_t palette[8];
@@ -234,12 +338,53 @@ typedef struct {
     int h_period;
     int l_count;
 
+    /* pixel lookup tables for a nibble of video data, for each CSS state */
+    uint32_t lut_alnum[2][16][4];
+    uint32_t lut_rg1[2][16][4];         /* 1 dot per bit */
+    uint32_t lut_rg2[2][16][8];         /* 2 dots per bit */
+    uint32_t lut_cg2[2][16][4];         /* 2 color pixels, 2 dots each */
+    uint32_t lut_cg4[2][16][8];         /* 2 color pixels, 4 dots each */
+    /* the colors the lookup tables were built from */
+    uint32_t lut_colors[MC6847_NUM_COLORS];
+    /* the same lookup tables with color indices */
+    uint8_t lut8_alnum[2][16][4];
+    uint8_t lut8_rg1[2][16][4];
+    uint8_t lut8_rg2[2][16][8];
+    uint8_t lut8_cg2[2][16][4];
+    uint8_t lut8_cg4[2][16][8];
+
     /* the fetch callback function */
     mc6847_fetch_t fetch_cb;
     /* optional user-data for the fetch-callback */
     void* user_data;
+    /* direct video memory access, used instead of fetch_cb if vram isn't null */
+    const uint8_t* vram;
+    uint16_t vram_mask;
+    uint16_t attr_offset;
+    /* the INV, CSS, INT/EXT and AS pins for each attribute byte value (shifted down to bit 0) */
+    uint8_t attr_ctrl[256];
     /* pointer to RGBA8 buffer where decoded video image is written too */
     uint32_t* rgba8_buffer;
+    /* the color index framebuffer, if not null it is written instead of rgba8_buffer */
+    uint8_t* index8_buffer;
+    /* true if no framebuffer is written, only the line control pins are recorded */
+    bool external_decode;
+
+    /* dirty tracking state, one bit per framebuffer line */
+    bool dirty_tracking;
+    uint32_t dirty[(MC6847_DISPLAY_HEIGHT+31)/32];
+    /* the control pins at the start of each line when it was last decoded */
+    uint8_t line_ctrl[MC6847_DISPLAY_HEIGHT];
+    /* the address, data and control pins a visible line was left with */
+    uint64_t line_pins[MC6847_DISPLAY_LINES];
+    /* the framebuffer the dirty state refers to */
+    const void* dirty_buffer;
+    /* number of lines written in the current field */
+    int field_lines;
+    /* false if the last complete field didn't change the framebuffer */
+    bool frame_changed;
+    /* incremented whenever the framebuffer output changes, wraps around */
+    uint32_t change_count;
 } mc6847_t;
 
 /* initialize a new mc6847_t instance */
@@ -248,8 +393,24 @@ void mc6847_init(mc6847_t* vdg, const mc6847_desc_t* desc);
 void mc6847_reset(mc6847_t* vdg);
 /* set or clear control-pins */
 void mc6847_ctrl(mc6847_t* vdg, uint64_t pins, uint64_t mask);
-/* tick the mc6847_t instance, this will call the fetch_cb and generate the image */
+/* mark all lines as dirty */
+void mc6847_invalidate(mc6847_t* vdg);
+/* mark the lines as dirty which are decoded from a video memory address in the current mode */
+void mc6847_invalidate_addr(mc6847_t* vdg, uint16_t addr);
+/* tick the mc6847_t instance, this will fetch video memory and generate the image */
 void mc6847_tick(mc6847_t* vdg);
+/* run the mc6847_t instance for a number of ticks at once, decoding each scanline as it completes */
+void mc6847_exec(mc6847_t* vdg, uint32_t num_ticks);
+/* same as mc6847_exec(), but only advances the counters and sync pins without decoding (for fast-forwarding) */
+void mc6847_skip(mc6847_t* vdg, uint32_t num_ticks);
+/* number of ticks until one of the sync pins in mask (MC6847_FS, MC6847_HS) changes state */
+uint32_t mc6847_ticks_to_edge(const mc6847_t* vdg, uint64_t mask);
+/* get the current RGBA8 colors for the MC6847_NUM_COLORS color indices of the indexed output */
+void mc6847_colors(const mc6847_t* vdg, uint32_t* colors);
+/* continue decoding into another framebuffer of the same format, copies the current frame into it */
+void mc6847_move_buffer(mc6847_t* vdg, void* buffer);
+/* pack the last field into MC6847_FRAME_DATA_SIZE bytes for external decoding */
+void mc6847_frame_data(const mc6847_t* vdg, uint8_t* dst);
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -262,25 +423,66 @@ void mc6847_tick(mc6847_t* vdg);
     #include <assert.h>
     #define CHIPS_ASSERT(c) assert(c)
 #endif
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+    #define _MC6847_SSE2 (1)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define _MC6847_NEON (1)
+#endif
+#if defined(__GNUC__)
+    #define _MC6847_FORCE_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+    #define _MC6847_FORCE_INLINE static __forceinline
+#else
+    #define _MC6847_FORCE_INLINE static inline
+#endif
 
 #define _MC6847_CLAMP(x) ((x)>255?255:(x))
 #define _MC6847_RGBA(r,g,b) (0xFF000000|_MC6847_CLAMP((r*4)/3)|(_MC6847_CLAMP((g*4)/3)<<8)|(_MC6847_CLAMP((b*4)/3)<<16))
+/* the pins which decide which address is decoded into which line */
+#define _MC6847_MODE_PINS (MC6847_AG|MC6847_GM0|MC6847_GM1|MC6847_GM2)
+/* the pins a decoded line leaves behind */
+#define _MC6847_LINE_PINS (MC6847_CTRL_PINS|0xFFFFFFULL)
+#define _MC6847_CTRL_BITS(p) ((uint8_t)(((p)&MC6847_CTRL_PINS)>>43))
+
+static void _mc6847_build_index_luts(mc6847_t* vdg);
+static void _mc6847_build_luts(mc6847_t* vdg);
 
 void mc6847_init(mc6847_t* vdg, const mc6847_desc_t* desc) {
     CHIPS_ASSERT(vdg && desc);
-    CHIPS_ASSERT(desc->rgba8_buffer);
-    CHIPS_ASSERT(desc->rgba8_buffer_size >= (MC6847_DISPLAY_WIDTH*MC6847_DISPLAY_HEIGHT*sizeof(uint32_t)));
-    CHIPS_ASSERT(desc->fetch_cb);
-    CHIPS_ASSERT((desc->tick_hz > 0) && (desc->tick_hz <= MC6847_TICK_HZ));
+    CHIPS_ASSERT(desc->rgba8_buffer || desc->index8_buffer || desc->external_decode);
+    CHIPS_ASSERT(!desc->external_decode || (desc->vram && (desc->attr_offset > 0)));
+    CHIPS_ASSERT(!desc->rgba8_buffer || (desc->rgba8_buffer_size >= (MC6847_DISPLAY_WIDTH*MC6847_DISPLAY_HEIGHT*sizeof(uint32_t))));
+    CHIPS_ASSERT(!desc->index8_buffer || (desc->index8_buffer_size >= (MC6847_DISPLAY_WIDTH*MC6847_DISPLAY_HEIGHT)));
+    CHIPS_ASSERT(desc->fetch_cb || desc->vram);
+    CHIPS_ASSERT(!desc->vram || ((desc->vram_size > 0) && (desc->vram_size <= 0x10000) && (0 == (desc->vram_size & (desc->vram_size-1)))));
+    CHIPS_ASSERT(desc->tick_hz > 0);
 
     memset(vdg, 0, sizeof(*vdg));
     vdg->rgba8_buffer = desc->rgba8_buffer;
+    vdg->index8_buffer = desc->index8_buffer;
+    vdg->external_decode = desc->external_decode;
     vdg->fetch_cb = desc->fetch_cb;
     vdg->user_data = desc->user_data;
+    vdg->vram = desc->vram;
+    vdg->vram_mask = (uint16_t) (desc->vram_size - 1);
+    vdg->attr_offset = desc->attr_offset;
+    for (int i = 0; i < 256; i++) {
+        const uint64_t pins = ((i & desc->attr_inv) ? MC6847_INV : 0) |
+                              ((i & desc->attr_css) ? MC6847_CSS : 0) |
+                              ((i & desc->attr_intext) ? MC6847_INTEXT : 0) |
+                              ((i & desc->attr_as) ? MC6847_AS : 0);
+        vdg->attr_ctrl[i] = _MC6847_CTRL_BITS(pins);
+    }
+    vdg->dirty_tracking = desc->dirty_tracking;
+    vdg->frame_changed = true;
+    mc6847_invalidate(vdg);
 
     /* compute counter periods, the MC6847 is always clocked at 3.579 MHz,
        and the frequency of how the tick function is called must be 
-       communicated to the init function
+       communicated to the init function (this may also be the faster
+       CPU clock, the counters are scaled accordingly)
 
        one scanline is 228 3.5 MC6847 ticks
     */
@@ -330,17 +532,65 @@ void mc6847_init(mc6847_t* vdg, const mc6847_desc_t* desc) {
     vdg->alnum_dark_green = 0xFF002400;
     vdg->alnum_orange = _MC6847_RGBA(140, 31, 11);
     vdg->alnum_dark_orange = 0xFF000E22;
+    _mc6847_build_index_luts(vdg);
+    _mc6847_build_luts(vdg);
 }
 
 void mc6847_reset(mc6847_t* vdg) {
     CHIPS_ASSERT(vdg);
     vdg->h_count = 0;
     vdg->l_count = 0;
+    mc6847_invalidate(vdg);
 }
 
 void mc6847_ctrl(mc6847_t* vdg, uint64_t pins, uint64_t mask) {
     CHIPS_ASSERT(vdg);
-    vdg->pins = (vdg->pins & ~(mask & MC6847_CTRL_PINS)) | pins;
+    uint64_t new_pins = (vdg->pins & ~(mask & MC6847_CTRL_PINS)) | pins;
+    if ((new_pins ^ vdg->pins) & _MC6847_MODE_PINS) {
+        /* video memory writes have been tracked for the old mode */
+        mc6847_invalidate(vdg);
+    }
+    vdg->pins = new_pins;
+}
+
+void mc6847_invalidate(mc6847_t* vdg) {
+    CHIPS_ASSERT(vdg);
+    memset(vdg->dirty, 0xFF, sizeof(vdg->dirty));
+}
+
+/* the video memory layout of a graphics mode, same as in _mc6847_decode_scanline() */
+static inline void _mc6847_graphics_layout(uint64_t pins, int* bytes_per_row, int* row_height) {
+    uint8_t sub_mode = (uint8_t) ((pins & (MC6847_GM2|MC6847_GM1)) / MC6847_GM1);
+    if (pins & MC6847_GM0) {
+        *bytes_per_row = (sub_mode < 3) ? 16 : 32;
+        *row_height = (pins & MC6847_GM2) ? 1 : (pins & MC6847_GM1) ? 2 : 3;
+    }
+    else {
+        *bytes_per_row = (sub_mode == 0) ? 16 : 32;
+        *row_height = (pins & MC6847_GM2) ? ((pins & MC6847_GM1) ? 1 : 2) : 3;
+    }
+}
+
+void mc6847_invalidate_addr(mc6847_t* vdg, uint16_t addr) {
+    CHIPS_ASSERT(vdg);
+    const uint64_t pins = vdg->pins;
+    int bytes_per_row, row_height;
+    if (pins & MC6847_AG) {
+        _mc6847_graphics_layout(pins, &bytes_per_row, &row_height);
+    }
+    else {
+        /* alphanumeric/semigraphics, 32 cells of 8x12 pixels */
+        bytes_per_row = 32;
+        row_height = 12;
+    }
+    int y = (addr / bytes_per_row) * row_height;
+    int end = y + row_height;
+    if (end > MC6847_DISPLAY_LINES) {
+        end = MC6847_DISPLAY_LINES;
+    }
+    for (y += MC6847_TOP_BORDER_LINES, end += MC6847_TOP_BORDER_LINES; y < end; y++) {
+        vdg->dirty[y>>5] |= 1U<<(y&31);
+    }
 }
 
 /*
@@ -415,38 +665,217 @@ static const uint8_t _mc6847_font[64 * 12] = {
 };
 
 
-static inline uint32_t _mc6847_border_color(mc6847_t* vdg, uint64_t pins) {
+/* the border color index */
+static inline uint8_t _mc6847_border_color(uint64_t pins) {
     if (pins & MC6847_AG) {
         /* a graphics mode, either green or buff, depending on CSS pin */
-        return (pins & MC6847_CSS) ? vdg->palette[4] : vdg->palette[0];
+        return (pins & MC6847_CSS) ? 4 : 0;
     }
     else {
         /* alphanumeric or semigraphics mode, always black */
-        return vdg->black;
+        return MC6847_COLOR_BLACK;
     }
 }
 
-static void _mc6847_decode_border(mc6847_t* vdg, uint64_t pins, int y) {
-    uint32_t* dst = &(vdg->rgba8_buffer[y * MC6847_DISPLAY_WIDTH]);
-    uint32_t c = _mc6847_border_color(vdg, pins);
-    for (int x = 0; x < MC6847_DISPLAY_WIDTH; x++) {
-        *dst++ = c;
+/* pixel stores, 4 or 8 pixels at once */
+static inline void _mc6847_copy4(uint32_t* dst, const uint32_t* src) {
+    #if defined(_MC6847_SSE2)
+        _mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+    #elif defined(_MC6847_NEON)
+        vst1q_u32(dst, vld1q_u32(src));
+    #else
+        dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3];
+    #endif
+}
+
+static inline void _mc6847_copy8(uint32_t* dst, const uint32_t* src) {
+    _mc6847_copy4(dst, src);
+    _mc6847_copy4(dst + 4, src + 4);
+}
+
+static inline void _mc6847_fill4(uint32_t* dst, uint32_t c) {
+    #if defined(_MC6847_SSE2)
+        _mm_storeu_si128((__m128i*)dst, _mm_set1_epi32((int)c));
+    #elif defined(_MC6847_NEON)
+        vst1q_u32(dst, vdupq_n_u32(c));
+    #else
+        dst[0] = dst[1] = dst[2] = dst[3] = c;
+    #endif
+}
+
+/*  the same for both framebuffer formats, ps is the pixel size in bytes
+    (4 for RGBA8, 1 for color indices), src points to a lookup table
+    entry of the respective format, fills take a color index
+*/
+_MC6847_FORCE_INLINE void _mc6847_put4(uint8_t* dst, const uint8_t* src, int ps) {
+    if (4 == ps) {
+        _mc6847_copy4((uint32_t*)dst, (const uint32_t*)src);
+    }
+    else {
+        memcpy(dst, src, 4);
     }
 }
 
-static uint64_t _mc6847_decode_scanline(mc6847_t* vdg, uint64_t pins, int y) {
-    uint32_t* dst = &(vdg->rgba8_buffer[(y+MC6847_TOP_BORDER_LINES) * MC6847_DISPLAY_WIDTH]);
-    uint32_t bc = _mc6847_border_color(vdg, pins);
-    void* ud = vdg->user_data;
+_MC6847_FORCE_INLINE void _mc6847_put8(uint8_t* dst, const uint8_t* src, int ps) {
+    if (4 == ps) {
+        _mc6847_copy8((uint32_t*)dst, (const uint32_t*)src);
+    }
+    else {
+        memcpy(dst, src, 8);
+    }
+}
+
+_MC6847_FORCE_INLINE void _mc6847_put_fill4(const mc6847_t* vdg, uint8_t* dst, uint8_t color, int ps) {
+    if (4 == ps) {
+        _mc6847_fill4((uint32_t*)dst, vdg->lut_colors[color]);
+    }
+    else {
+        memset(dst, color, 4);
+    }
+}
+
+static void _mc6847_gather_colors(const mc6847_t* vdg, uint32_t* colors) {
+    for (int i = 0; i < 8; i++) {
+        colors[i] = vdg->palette[i];
+    }
+    colors[8] = vdg->black;
+    colors[9] = vdg->alnum_green;
+    colors[10] = vdg->alnum_dark_green;
+    colors[11] = vdg->alnum_orange;
+    colors[12] = vdg->alnum_dark_orange;
+}
+
+/* build the color index lookup tables, these never change */
+static void _mc6847_build_index_luts(mc6847_t* vdg) {
+    for (int css = 0; css < 2; css++) {
+        const uint8_t rg_fg = css ? 4 : 0;
+        const uint8_t alnum_fg = css ? MC6847_COLOR_ALNUM_ORANGE : MC6847_COLOR_ALNUM_GREEN;
+        const uint8_t alnum_bg = css ? MC6847_COLOR_ALNUM_DARK_ORANGE : MC6847_COLOR_ALNUM_DARK_GREEN;
+        for (int n = 0; n < 16; n++) {
+            for (int p = 0; p < 4; p++) {
+                /* 4 bits, MSB first */
+                const bool bit = 0 != (n & (8>>p));
+                vdg->lut8_alnum[css][n][p] = bit ? alnum_fg : alnum_bg;
+                vdg->lut8_rg1[css][n][p] = bit ? rg_fg : MC6847_COLOR_BLACK;
+                vdg->lut8_rg2[css][n][p*2] = vdg->lut8_rg2[css][n][p*2+1] = bit ? rg_fg : MC6847_COLOR_BLACK;
+                /* 2 pixels of 2 bits each */
+                const uint8_t c = (uint8_t)(css * 4 + ((p < 2) ? (n>>2) : (n&3)));
+                vdg->lut8_cg2[css][n][p] = c;
+                vdg->lut8_cg4[css][n][p*2] = vdg->lut8_cg4[css][n][p*2+1] = c;
+            }
+        }
+    }
+}
+
+/* build the RGBA8 pixel lookup tables from the current colors */
+static void _mc6847_build_luts(mc6847_t* vdg) {
+    _mc6847_gather_colors(vdg, vdg->lut_colors);
+    const uint32_t* c = vdg->lut_colors;
+    for (int css = 0; css < 2; css++) {
+        for (int n = 0; n < 16; n++) {
+            for (int p = 0; p < 4; p++) {
+                vdg->lut_alnum[css][n][p] = c[vdg->lut8_alnum[css][n][p]];
+                vdg->lut_rg1[css][n][p] = c[vdg->lut8_rg1[css][n][p]];
+                vdg->lut_cg2[css][n][p] = c[vdg->lut8_cg2[css][n][p]];
+            }
+            for (int p = 0; p < 8; p++) {
+                vdg->lut_rg2[css][n][p] = c[vdg->lut8_rg2[css][n][p]];
+                vdg->lut_cg4[css][n][p] = c[vdg->lut8_cg4[css][n][p]];
+            }
+        }
+    }
+}
+
+/* rebuild the lookup tables and redraw all lines when the colors have been changed */
+static void _mc6847_check_colors(mc6847_t* vdg) {
+    uint32_t colors[MC6847_NUM_COLORS];
+    _mc6847_gather_colors(vdg, colors);
+    if (0 != memcmp(colors, vdg->lut_colors, sizeof(colors))) {
+        _mc6847_build_luts(vdg);
+        /* color indices stay valid */
+        if (vdg->index8_buffer || vdg->external_decode) {
+            vdg->change_count++;
+        }
+        else {
+            mc6847_invalidate(vdg);
+        }
+    }
+}
+
+/*  read a video memory byte, directly or through the fetch callback,
+    the address is passed separately so that the memory reads don't
+    depend on the pins of the previous fetch
+*/
+static inline uint64_t _mc6847_fetch(mc6847_t* vdg, uint64_t pins, uint16_t addr) {
+    MC6847_SET_ADDR(pins, addr);
+    if (!vdg->vram) {
+        return vdg->fetch_cb(pins, vdg->user_data);
+    }
+    addr &= vdg->vram_mask;
+    MC6847_SET_DATA(pins, vdg->vram[addr]);
+    if ((addr < vdg->attr_offset) && !(pins & MC6847_AG)) {
+        const uint8_t attr = vdg->vram[(addr + vdg->attr_offset) & vdg->vram_mask];
+        pins = (pins & ~(MC6847_INV|MC6847_CSS|MC6847_INTEXT|MC6847_AS)) | ((uint64_t)vdg->attr_ctrl[attr] << 43);
+    }
+    return pins;
+}
+
+/*  get a row of video memory bytes for the graphics modes, which don't
+    look at the pins within a row: points directly into video memory, or
+    into buf filled through the fetch callback
+*/
+static inline const uint8_t* _mc6847_fetch_row(mc6847_t* vdg, uint64_t* pins, uint16_t addr, int num, uint8_t* buf) {
+    if (vdg->vram && ((addr + num - 1) <= vdg->vram_mask)) {
+        /* leave the pins behind like the last fetch would */
+        MC6847_SET_ADDR(*pins, addr + num - 1);
+        MC6847_SET_DATA(*pins, vdg->vram[addr + num - 1]);
+        return &vdg->vram[addr];
+    }
+    for (int i = 0; i < num; i++) {
+        *pins = _mc6847_fetch(vdg, *pins, addr + i);
+        buf[i] = MC6847_GET_DATA(*pins);
+    }
+    return buf;
+}
+
+/*  fetch a line of an alphanumeric character from the external font
+    (characters 96..223 at 0x1600 and 0x1000, the others are read from
+    the character address)
+*/
+static inline uint64_t _mc6847_fetch_ext_font(mc6847_t* vdg, uint64_t pins, uint8_t chr, int chr_y) {
+    uint8_t ch = chr < 96 ? chr + 128 : chr;
+    uint16_t font_addr = MC6847_GET_ADDR(pins);
+    if (ch >= 96 && ch < 128) {
+        font_addr = 0x1600 + (ch - 96) * 16 + chr_y;
+    }
+    else if (ch >= 128 && ch < 224) {
+        font_addr = 0x1000 + (ch - 128) * 16 + chr_y;
+    }
+    return _mc6847_fetch(vdg, pins, font_addr);
+}
+
+_MC6847_FORCE_INLINE void _mc6847_decode_border_px(mc6847_t* vdg, uint64_t pins, uint8_t* dst, int ps) {
+    const uint8_t c = _mc6847_border_color(pins);
+    for (int x = 0; x < MC6847_DISPLAY_WIDTH; x += 4) {
+        _mc6847_put_fill4(vdg, dst + x * ps, c, ps);
+    }
+}
+
+/* decode a visible line into a line of the framebuffer with ps bytes per pixel */
+_MC6847_FORCE_INLINE uint64_t _mc6847_decode_scanline_px(mc6847_t* vdg, uint64_t pins, int y, uint8_t* dst, int ps) {
+    const uint8_t bc = _mc6847_border_color(pins);
+    const int css = (pins & MC6847_CSS) ? 1 : 0;
 
     /* left border */
-    for (int i = 0; i < MC6847_BORDER_PIXELS; i++) {
-        *dst++ = bc;
+    for (int i = 0; i < MC6847_BORDER_PIXELS; i += 4) {
+        _mc6847_put_fill4(vdg, dst + i * ps, bc, ps);
     }
+    dst += MC6847_BORDER_PIXELS * ps;
 
     /* visible scanline */
     if (pins & MC6847_AG) {
         /* one of the 8 graphics modes */
+        uint8_t buf[32];
         uint8_t sub_mode = (uint8_t) ((pins & (MC6847_GM2|MC6847_GM1)) / MC6847_GM1);
         if (pins & MC6847_GM0) {
             /*  one of the 'resolution modes' (1 bit == 1 pixel block)
@@ -456,20 +885,24 @@ static uint64_t _mc6847_decode_scanline(mc6847_t* vdg, uint64_t pins, int y) {
                     10:    RG3, 128x192, 16 bytes per row
                     11:    RG6, 256x192, 32 bytes per row
             */
-            int dots_per_bit  = (sub_mode < 3) ? 2 : 1;
-            int bytes_per_row = (sub_mode < 3) ? 16 : 32;
             int row_height = (pins & MC6847_GM2) ? 1 : (pins & MC6847_GM1) ? 2 : 3;
-            uint16_t addr = (y / row_height) * bytes_per_row;
-            uint32_t fg_color = (pins & MC6847_CSS) ? vdg->palette[4] : vdg->palette[0];
-            for (int x = 0; x < bytes_per_row; x++) {
-                MC6847_SET_ADDR(pins, addr++);
-                pins = vdg->fetch_cb(pins, ud);
-                uint8_t m = MC6847_GET_DATA(pins);
-                for (int p = 7; p >= 0; p--) {
-                    uint32_t c = ((m>>p) & 1) ? fg_color : vdg->black;
-                    for (int d = 0; d < dots_per_bit; d++) {
-                        *dst++ = c;
-                    }
+            if (sub_mode < 3) {
+                /* 2 dots per bit */
+                const uint8_t* lut = (4 == ps) ? (const uint8_t*)vdg->lut_rg2[css] : (const uint8_t*)vdg->lut8_rg2[css];
+                const uint8_t* row = _mc6847_fetch_row(vdg, &pins, (y / row_height) * 16, 16, buf);
+                for (int x = 0; x < 16; x++, dst += 16 * ps) {
+                    const uint8_t m = row[x];
+                    _mc6847_put8(dst, lut + (m>>4) * 8 * ps, ps);
+                    _mc6847_put8(dst + 8 * ps, lut + (m&15) * 8 * ps, ps);
+                }
+            }
+            else {
+                const uint8_t* lut = (4 == ps) ? (const uint8_t*)vdg->lut_rg1[css] : (const uint8_t*)vdg->lut8_rg1[css];
+                const uint8_t* row = _mc6847_fetch_row(vdg, &pins, (y / row_height) * 32, 32, buf);
+                for (int x = 0; x < 32; x++, dst += 8 * ps) {
+                    const uint8_t m = row[x];
+                    _mc6847_put4(dst, lut + (m>>4) * 4 * ps, ps);
+                    _mc6847_put4(dst + 4 * ps, lut + (m&15) * 4 * ps, ps);
                 }
             }
         }
@@ -482,20 +915,24 @@ static uint64_t _mc6847_decode_scanline(mc6847_t* vdg, uint64_t pins, int y) {
                     10: CG3, 128x96, 32 bytes per row
                     11: CG6, 128x192, 32 bytes per row
             */
-            uint32_t pal_offset = (pins & MC6847_CSS) ? 4 : 0;
-            int dots_per_2bit = (sub_mode == 0) ? 4 : 2;
-            int bytes_per_row = (sub_mode == 0) ? 16 : 32;
             int row_height = (pins & MC6847_GM2) ? ((pins & MC6847_GM1) ? 1 : 2) : 3;
-            uint16_t addr = (y / row_height) * bytes_per_row;
-            for (int x = 0; x < bytes_per_row; x++) {
-                MC6847_SET_ADDR(pins, addr++);
-                pins = vdg->fetch_cb(pins, ud);
-                uint8_t m = MC6847_GET_DATA(pins);
-                for (int p = 6; p >= 0; p -= 2) {
-                    const uint32_t c = vdg->palette[((m>>p) & 3) + pal_offset];
-                    for (int d = 0; d < dots_per_2bit; d++) {
-                        *dst++ = c;
-                    }
+            if (sub_mode == 0) {
+                /* 4 dots per pixel */
+                const uint8_t* lut = (4 == ps) ? (const uint8_t*)vdg->lut_cg4[css] : (const uint8_t*)vdg->lut8_cg4[css];
+                const uint8_t* row = _mc6847_fetch_row(vdg, &pins, (y / row_height) * 16, 16, buf);
+                for (int x = 0; x < 16; x++, dst += 16 * ps) {
+                    const uint8_t m = row[x];
+                    _mc6847_put8(dst, lut + (m>>4) * 8 * ps, ps);
+                    _mc6847_put8(dst + 8 * ps, lut + (m&15) * 8 * ps, ps);
+                }
+            }
+            else {
+                const uint8_t* lut = (4 == ps) ? (const uint8_t*)vdg->lut_cg2[css] : (const uint8_t*)vdg->lut8_cg2[css];
+                const uint8_t* row = _mc6847_fetch_row(vdg, &pins, (y / row_height) * 32, 32, buf);
+                for (int x = 0; x < 32; x++, dst += 8 * ps) {
+                    const uint8_t m = row[x];
+                    _mc6847_put4(dst, lut + (m>>4) * 4 * ps, ps);
+                    _mc6847_put4(dst + 4 * ps, lut + (m&15) * 4 * ps, ps);
                 }
             }
         }
@@ -510,15 +947,14 @@ static uint64_t _mc6847_decode_scanline(mc6847_t* vdg, uint64_t pins, int y) {
         /* bit shifters to extract a 2x2 or 2x3 semigraphics 2-bit stack */
         int shift_2x2 = (1 - (chr_y / 6))*2;
         int shift_2x3 = (2 - (chr_y / 4))*2;
-        uint32_t alnum_fg = (pins & MC6847_CSS) ? vdg->alnum_orange : vdg->alnum_green;
-        uint32_t alnum_bg = (pins & MC6847_CSS) ? vdg->alnum_dark_orange : vdg->alnum_dark_green;
-        for (int x = 0; x < 32; x++) {
-            MC6847_SET_ADDR(pins, addr++);
-            pins = vdg->fetch_cb(pins, ud);
+        /* the alphanumeric colors are selected by CSS at the start of the line */
+        const uint8_t* alnum_lut = (4 == ps) ? (const uint8_t*)vdg->lut_alnum[css] : (const uint8_t*)vdg->lut8_alnum[css];
+        for (int x = 0; x < 32; x++, dst += 8 * ps) {
+            pins = _mc6847_fetch(vdg, pins, addr++);
             uint8_t chr = MC6847_GET_DATA(pins);
             if (pins & MC6847_AS) {
                 /* semigraphics mode */
-                uint32_t fg_color;
+                uint8_t fg_color;
                 if (pins & MC6847_INTEXT) {
                     /*  2x3 semigraphics, 2 color sets at 4 colors (selected by CSS pin)
                         |C1|C0|L5|L4|L3|L2|L1|L0|
@@ -535,7 +971,7 @@ static uint64_t _mc6847_decode_scanline(mc6847_t* vdg, uint64_t pins, int y) {
                     /* extract the 2 horizontal bits from one of the 3 stacks */
                     m = (chr>>shift_2x3) & 3;
                     /* 2 bits of color, CSS bit selects upper or lower half of color palette */
-                    fg_color = vdg->palette[((chr>>6)&3) + ((pins&MC6847_CSS)?4:0)];
+                    fg_color = ((chr>>6)&3) + ((pins&MC6847_CSS)?4:0);
                 }
                 else {
                     /*  2x2 semigraphics, 8 colors + black
@@ -551,63 +987,123 @@ static uint64_t _mc6847_decode_scanline(mc6847_t* vdg, uint64_t pins, int y) {
                     /* extract the 2 horizontal bits from the upper or lower stack */
                     m = (chr>>shift_2x2) & 3;
                     /* 3 color bits directly point into the color palette */
-                    fg_color = vdg->palette[(chr>>4) & 7];
+                    fg_color = (chr>>4) & 7;
                 }
                 /* write the horizontal pixel blocks (2 blocks @ 4 pixel each) */
-                for (int p = 1; p>=0; p--) {
-                    uint32_t c = (m & (1<<p)) ? fg_color : vdg->black;
-                    *dst++=c; *dst++=c; *dst++=c; *dst++=c;
-                }
+                _mc6847_put_fill4(vdg, dst, (m & 2) ? fg_color : MC6847_COLOR_BLACK, ps);
+                _mc6847_put_fill4(vdg, dst + 4 * ps, (m & 1) ? fg_color : MC6847_COLOR_BLACK, ps);
             }
             else {
-                /*  alphanumeric mode
-                    FIXME: INT_EXT (switch between internal and external font
-                */
+                /* alphanumeric mode, internal or external font */
                 uint8_t m = _mc6847_font[(chr&0x3F)*12 + chr_y];
-#if 1                    
-				if (pins & MC6847_INTEXT)
-				{
-					uint8_t ch = chr < 96 ? chr + 128 : chr;
-					if (ch >= 96 && ch < 128)
-					{
-						MC6847_SET_ADDR(pins, (0x1600 + (ch - 96) * 16 + chr_y));
-					} 
-					else if (ch >= 128 && ch < 224)
-					{
-						MC6847_SET_ADDR(pins, 0x1000 + (ch - 128) * 16 + chr_y);
-					}
-                    pins = vdg->fetch_cb(pins, ud);
-                    m = MC6847_GET_DATA(pins);                    
+                if (pins & MC6847_INTEXT) {
+                    pins = _mc6847_fetch_ext_font(vdg, pins, chr, chr_y);
+                    m = MC6847_GET_DATA(pins);
                 }
-#endif                    
                 if (pins & MC6847_INV) {
                     m = ~m;
                 }
-                for (int p = 7; p >= 0; p--) {
-                    *dst++ = m & (1<<p) ? alnum_fg : alnum_bg;
-                }                
+                _mc6847_put4(dst, alnum_lut + (m>>4) * 4 * ps, ps);
+                _mc6847_put4(dst + 4 * ps, alnum_lut + (m&15) * 4 * ps, ps);
             }
         }
     }
 
     /* right border */
-    for (int i = 0; i < MC6847_BORDER_PIXELS; i++) {
-        *dst++ = bc;
+    for (int i = 0; i < MC6847_BORDER_PIXELS; i += 4) {
+        _mc6847_put_fill4(vdg, dst + i * ps, bc, ps);
     }
 
     return pins;
 }
 
-void mc6847_tick(mc6847_t* vdg) {
-    uint64_t prev_pins = vdg->pins;
-    uint64_t pins = vdg->pins;
-    vdg->h_count += MC6847_FIXEDPOINT_SCALE;
+static void _mc6847_decode_border(mc6847_t* vdg, uint64_t pins, int y) {
+    const int offset = y * MC6847_DISPLAY_WIDTH;
+    if (vdg->index8_buffer) {
+        _mc6847_decode_border_px(vdg, pins, &vdg->index8_buffer[offset], 1);
+    }
+    else {
+        _mc6847_decode_border_px(vdg, pins, (uint8_t*)&vdg->rgba8_buffer[offset], 4);
+    }
+}
 
-    /* horizontal and field sync */
-    if ((vdg->h_count >= vdg->h_sync_start) && (vdg->h_count < vdg->h_sync_end)) {
+static uint64_t _mc6847_decode_scanline(mc6847_t* vdg, uint64_t pins, int y) {
+    const int offset = (y + MC6847_TOP_BORDER_LINES) * MC6847_DISPLAY_WIDTH;
+    if (vdg->index8_buffer) {
+        return _mc6847_decode_scanline_px(vdg, pins, y, &vdg->index8_buffer[offset], 1);
+    }
+    else {
+        return _mc6847_decode_scanline_px(vdg, pins, y, (uint8_t*)&vdg->rgba8_buffer[offset], 4);
+    }
+}
+
+/*  external decoding: only run the fetches of a visible line that decide
+    the pins it leaves behind, which is the last fetch of the line
+*/
+static uint64_t _mc6847_scan_line(mc6847_t* vdg, uint64_t pins, int y) {
+    if (pins & MC6847_AG) {
+        int bytes_per_row, row_height;
+        _mc6847_graphics_layout(pins, &bytes_per_row, &row_height);
+        pins = _mc6847_fetch(vdg, pins, (y / row_height) * bytes_per_row + bytes_per_row - 1);
+    }
+    else {
+        pins = _mc6847_fetch(vdg, pins, (y / 12) * 32 + 31);
+        if (!(pins & MC6847_AS) && (pins & MC6847_INTEXT)) {
+            pins = _mc6847_fetch_ext_font(vdg, pins, MC6847_GET_DATA(pins), y % 12);
+        }
+    }
+    return pins;
+}
+
+/* decode a line of the framebuffer (0..MC6847_DISPLAY_HEIGHT-1), skips unchanged lines */
+static uint64_t _mc6847_decode_line(mc6847_t* vdg, uint64_t pins, int y) {
+    const int vis_y = y - MC6847_TOP_BORDER_LINES;
+    const bool visible = (vis_y >= 0) && (vis_y < MC6847_DISPLAY_LINES);
+    const uint8_t ctrl = _MC6847_CTRL_BITS(pins);
+    if (0 == y) {
+        /* color changes take effect with the next field */
+        _mc6847_check_colors(vdg);
+    }
+    if (vdg->dirty_tracking) {
+        const void* buffer = vdg->index8_buffer ? (const void*)vdg->index8_buffer : (const void*)vdg->rgba8_buffer;
+        if (vdg->dirty_buffer != buffer) {
+            vdg->dirty_buffer = buffer;
+            mc6847_invalidate(vdg);
+        }
+        const uint32_t bit = 1U<<(y&31);
+        if (!(vdg->dirty[y>>5] & bit) && (vdg->line_ctrl[y] == ctrl)) {
+            /* unchanged, but leave the pins behind like the decoder would */
+            if (visible) {
+                pins = (pins & ~_MC6847_LINE_PINS) | vdg->line_pins[vis_y];
+            }
+            return pins;
+        }
+        vdg->dirty[y>>5] &= ~bit;
+    }
+    vdg->line_ctrl[y] = ctrl;
+    vdg->field_lines++;
+    vdg->change_count++;
+    if (visible) {
+        if (vdg->external_decode) {
+            pins = _mc6847_scan_line(vdg, pins, vis_y);
+        }
+        else {
+            pins = _mc6847_decode_scanline(vdg, pins, vis_y);
+        }
+        vdg->line_pins[vis_y] = pins & _MC6847_LINE_PINS;
+    }
+    else if (!vdg->external_decode) {
+        _mc6847_decode_border(vdg, pins, y);
+    }
+    return pins;
+}
+
+/* update the sync pins for the current horizontal and line counter */
+static inline uint64_t _mc6847_sync(const mc6847_t* vdg, int h_count, int l_count, uint64_t pins) {
+    if ((h_count >= vdg->h_sync_start) && (h_count < vdg->h_sync_end)) {
         /* horizontal sync on */
         pins |= MC6847_HS;
-        if (vdg->l_count == MC6847_FSYNC_START) {
+        if (l_count == MC6847_FSYNC_START) {
             /* switch field sync on */
             pins |= MC6847_FS;
         }
@@ -616,6 +1112,30 @@ void mc6847_tick(mc6847_t* vdg) {
         /* horizontal sync off */
         pins &= ~MC6847_HS;
     }
+    return pins;
+}
+
+/* number of ticks until the horizontal counter crosses the next sync or rewind position */
+static inline uint32_t _mc6847_ticks_to_step(const mc6847_t* vdg, int h_count) {
+    int next;
+    if (h_count < vdg->h_sync_start) {
+        next = vdg->h_sync_start;
+    }
+    else if (h_count < vdg->h_sync_end) {
+        next = vdg->h_sync_end;
+    }
+    else {
+        next = vdg->h_period;
+    }
+    return (uint32_t) ((next - h_count + MC6847_FIXEDPOINT_SCALE - 1) / MC6847_FIXEDPOINT_SCALE);
+}
+
+/* advance by a single tick, optionally decodes a scanline when the horizontal counter rewinds */
+static uint64_t _mc6847_step(mc6847_t* vdg, uint64_t pins, bool decode) {
+    vdg->h_count += MC6847_FIXEDPOINT_SCALE;
+
+    /* horizontal and field sync */
+    pins = _mc6847_sync(vdg, vdg->h_count, vdg->l_count, pins);
 
     /* rewind horizontal counter? */
     if (vdg->h_count >= vdg->h_period) {
@@ -626,25 +1146,25 @@ void mc6847_tick(mc6847_t* vdg) {
             vdg->l_count = 0;
             pins &= ~MC6847_FS;
         }
-        if (vdg->l_count < MC6847_VBLANK_LINES) {
-            /* inside vblank area, nothing to do */
-        }
-        else if (vdg->l_count < MC6847_DISPLAY_START) {
-            /* top border */
-            int y = vdg->l_count - MC6847_VBLANK_LINES;
-            _mc6847_decode_border(vdg, pins, y);
-        }
-        else if (vdg->l_count < MC6847_DISPLAY_END) {
-            /* visible area */
-            int y = vdg->l_count - MC6847_DISPLAY_START;
-            pins = _mc6847_decode_scanline(vdg, pins, y);
+        if (!decode || (vdg->l_count < MC6847_VBLANK_LINES)) {
+            /* not decoding, or inside vblank area, nothing to do */
         }
         else if (vdg->l_count < MC6847_BOTTOM_BORDER_END) {
-            /* bottom border */
-            int y = vdg->l_count - MC6847_VBLANK_LINES;
-            _mc6847_decode_border(vdg, pins, y);
+            /* top border, visible area or bottom border */
+            pins = _mc6847_decode_line(vdg, pins, vdg->l_count - MC6847_VBLANK_LINES);
+        }
+        else if (vdg->l_count == MC6847_BOTTOM_BORDER_END) {
+            /* the field is complete */
+            vdg->frame_changed = vdg->field_lines > 0;
+            vdg->field_lines = 0;
         }
     }
+    return pins;
+}
+
+void mc6847_tick(mc6847_t* vdg) {
+    uint64_t prev_pins = vdg->pins;
+    uint64_t pins = _mc6847_step(vdg, vdg->pins, true);
 
     /* raising/falling edge transitions */
     vdg->on  = pins & (pins ^ prev_pins);
@@ -652,4 +1172,106 @@ void mc6847_tick(mc6847_t* vdg) {
     vdg->pins = pins;
 }
 
+static void _mc6847_exec(mc6847_t* vdg, uint32_t num_ticks, bool decode) {
+    uint64_t pins = vdg->pins;
+    uint64_t on = 0, off = 0;
+    while (num_ticks > 0) {
+        /* between sync and rewind positions only the counter moves */
+        uint32_t ticks = _mc6847_ticks_to_step(vdg, vdg->h_count);
+        if (ticks > num_ticks) {
+            vdg->h_count += num_ticks * MC6847_FIXEDPOINT_SCALE;
+            break;
+        }
+        vdg->h_count += (ticks - 1) * MC6847_FIXEDPOINT_SCALE;
+        num_ticks -= ticks;
+        uint64_t prev_pins = pins;
+        pins = _mc6847_step(vdg, pins, decode);
+        on  |= pins & (pins ^ prev_pins);
+        off |= ~pins & (pins ^ prev_pins);
+    }
+    vdg->on = on;
+    vdg->off = off;
+    vdg->pins = pins;
+}
+
+void mc6847_exec(mc6847_t* vdg, uint32_t num_ticks) {
+    _mc6847_exec(vdg, num_ticks, true);
+}
+
+void mc6847_skip(mc6847_t* vdg, uint32_t num_ticks) {
+    _mc6847_exec(vdg, num_ticks, false);
+}
+
+uint32_t mc6847_ticks_to_edge(const mc6847_t* vdg, uint64_t mask) {
+    CHIPS_ASSERT(mask & (MC6847_FS|MC6847_HS));
+    int h_count = vdg->h_count;
+    int l_count = vdg->l_count;
+    uint64_t pins = vdg->pins;
+    uint32_t ticks = 0;
+    /* both sync pins toggle at least once per field */
+    for (int i = 0; i <= 3*MC6847_ALL_LINES; i++) {
+        uint32_t step = _mc6847_ticks_to_step(vdg, h_count);
+        ticks += step;
+        h_count += step * MC6847_FIXEDPOINT_SCALE;
+        uint64_t new_pins = _mc6847_sync(vdg, h_count, l_count, pins);
+        if (h_count >= vdg->h_period) {
+            h_count -= vdg->h_period;
+            if (++l_count >= MC6847_ALL_LINES) {
+                l_count = 0;
+                new_pins &= ~MC6847_FS;
+            }
+        }
+        if ((new_pins ^ pins) & mask) {
+            break;
+        }
+        pins = new_pins;
+    }
+    return ticks;
+}
+
+void mc6847_colors(const mc6847_t* vdg, uint32_t* colors) {
+    CHIPS_ASSERT(vdg && colors);
+    _mc6847_gather_colors(vdg, colors);
+}
+
+void mc6847_move_buffer(mc6847_t* vdg, void* buffer) {
+    CHIPS_ASSERT(vdg && buffer && !vdg->external_decode);
+    const void* old = vdg->index8_buffer ? (const void*)vdg->index8_buffer : (const void*)vdg->rgba8_buffer;
+    if (old == buffer) {
+        return;
+    }
+    if (vdg->index8_buffer) {
+        memcpy(buffer, vdg->index8_buffer, MC6847_DISPLAY_WIDTH * MC6847_DISPLAY_HEIGHT);
+        vdg->index8_buffer = (uint8_t*) buffer;
+    }
+    else {
+        memcpy(buffer, vdg->rgba8_buffer, MC6847_DISPLAY_WIDTH * MC6847_DISPLAY_HEIGHT * sizeof(uint32_t));
+        vdg->rgba8_buffer = (uint32_t*) buffer;
+    }
+    /* the dirty state carries over, unless the old buffer wasn't up to date either */
+    if (vdg->dirty_buffer == old) {
+        vdg->dirty_buffer = buffer;
+    }
+}
+
+void mc6847_frame_data(const mc6847_t* vdg, uint8_t* dst) {
+    CHIPS_ASSERT(vdg && vdg->vram && dst);
+    /* video memory, mirrored if there's less than 8 KB */
+    const int vram_size = vdg->vram_mask + 1;
+    for (int i = 0; i < 0x2000; i += vram_size) {
+        memcpy(&dst[MC6847_FRAME_VRAM + i], vdg->vram, (vram_size < 0x2000) ? vram_size : 0x2000);
+    }
+    /* the attribute bytes as they would be fetched with each character */
+    for (int i = 0; i < 32*16; i++) {
+        uint8_t ctrl = 0;
+        if (i < vdg->attr_offset) {
+            ctrl = vdg->attr_ctrl[vdg->vram[(i + vdg->attr_offset) & vdg->vram_mask]];
+        }
+        dst[MC6847_FRAME_CELLS + i] = ctrl;
+    }
+    memcpy(&dst[MC6847_FRAME_FONT], _mc6847_font, sizeof(_mc6847_font));
+    memset(&dst[MC6847_FRAME_LINES], 0, MC6847_FRAME_DATA_SIZE - MC6847_FRAME_LINES);
+    memcpy(&dst[MC6847_FRAME_LINES], vdg->line_ctrl, MC6847_DISPLAY_HEIGHT);
+}
+
 # endif /* CHIPS_IMPL */
@@ -105,6 +105,70 @@
         Set a null ptr as trap callback disables the trap checking.
         To get the current trap callback, simply access z80_t.trap_cb directly.
 
+    ~~~C
+    void z80_set_pages(z80_t* cpu, const z80_page_t* pages)
+    ~~~
+        Set an optional table of Z80_NUM_PAGES memory pages (1 KB each) for
+        the memory access fast path. Memory reads, writes and opcode fetches
+        on pages with a non-null read_ptr/write_ptr access the memory
+        directly and don't invoke the tick callback, as long as the callback
+        has announced in z80_t.fast_ticks that it doesn't need to see the
+        next ticks. The skipped ticks are added to the next tick callback
+        invocation (at the latest at the end of z80_exec()), so the sum of
+        ticks seen by the tick callback doesn't change. Wait states are not
+        injected on the fast path. The page table is not copied, update it
+        in place when the memory mapping changes (for instance from the
+        tick callback). A null ptr disables the fast path.
+
+    ~~~C
+    void z80_set_blocks(z80_t* cpu, z80_blocks_t* blocks, const uint8_t* rom, int rom_size)
+    ~~~
+        Set an optional predecoded basic-block cache, this only has an
+        effect together with z80_set_pages(). A block is the run of
+        instructions from a PC up to and including the first jump, call,
+        return, IO or HALT instruction, within one page and at most
+        Z80_BLOCK_MAX_BYTES long. Its opcode and operand bytes are decoded
+        once from the page memory, together with an upper bound of its
+        ticks. When the fast path covers all of a block's ticks, its
+        instructions are fetched from the block, without the per-fetch page
+        lookup and fast path check. Blocks are keyed by PC and checked
+        against the page table when they are entered, so remapping memory
+        doesn't need to flush them. CPU writes make the blocks of the
+        written page stale, except for blocks decoded from the read-only
+        memory at rom. The cache is reset, a null ptr disables it.
+
+    ~~~C
+    void z80_invalidate_blocks(z80_t* cpu, uint16_t addr, int num_bytes)
+    ~~~
+        Make the predecoded blocks of a memory range stale, this must be
+        called when memory that may contain code has been written outside
+        of z80_exec() (for instance by a loader or debugger).
+
+    ~~~C
+    bool z80_set_jit(z80_t* cpu, bool enabled, bool verify)
+    ~~~
+        Enable or disable the optional dynamic recompiler, this needs the
+        block cache of z80_set_blocks(). Blocks are translated into native
+        code when they are first entered, up to the first instruction that
+        isn't translated: the DD, FD, ED and CB prefixed instructions, IO,
+        HALT, DI, EI, DAA and EX (SP),HL. The native code has the same
+        register, memory, address bus and tick results as the interpreter,
+        and calls the trap callback after each instruction. It only runs
+        when the fast path covers all of the block's ticks, when no
+        interrupt or EI delay is pending, and when the block ends before
+        num_ticks of z80_exec(). Each memory access checks the page table
+        first, and leaves the rest of the block to the interpreter if the
+        page isn't on the fast path, or if it writes to the page of the
+        block itself (self-modifying code). Blocks that go stale too often
+        stay in the interpreter. With verify, the interpreter runs each
+        block first on a copy of the CPU, and the results are compared
+        after the native code has run (see the jit_* counters in
+        z80_blocks_t). The recompiler needs executable memory and only
+        supports x86-64 (System V), z80_set_jit() returns false if it
+        can't be enabled, the CPU then keeps running in the interpreter.
+        The recompiler must be disabled before the block cache is removed
+        with z80_set_blocks(), it frees the executable memory.
+
     ## Macros
     ~~~C
     Z80_SET_ADDR(pins, addr)
@@ -378,6 +442,48 @@ typedef int (*z80_trap_t)(uint16_t pc, int ticks, uint64_t pins, void* trap_user
 #define Z80_ZF (1<<6)           /* zero */
 #define Z80_SF (1<<7)           /* sign */
 
+/* memory pages for the memory access fast path, see z80_set_pages() */
+#define Z80_PAGE_SHIFT (10)
+#define Z80_PAGE_SIZE (1<<Z80_PAGE_SHIFT)
+#define Z80_NUM_PAGES (1<<(16-Z80_PAGE_SHIFT))
+typedef struct {
+    const uint8_t* read_ptr;    /* 0 if reads need the tick callback */
+    uint8_t* write_ptr;         /* 0 if writes need the tick callback */
+} z80_page_t;
+
+/* predecoded basic-block cache, see z80_set_blocks() */
+#define Z80_BLOCK_MAX_BYTES (32)    /* max opcode and operand bytes of a block */
+#define Z80_MAX_BLOCKS (4096)       /* the cache is flushed when it is full */
+#define Z80_JIT_CODE_SIZE (1<<22)   /* native code buffer of the recompiler, flushed when it is full */
+typedef struct {
+    const uint8_t* src;         /* page memory the block was decoded from */
+    uint64_t gen;               /* write generation of its page at decode time */
+    bool rom;                   /* decoded from read-only memory, never stale */
+    uint8_t num_bytes;          /* number of opcode and operand bytes */
+    uint16_t ticks;             /* upper bound of the block's ticks */
+    uint8_t bytes[Z80_BLOCK_MAX_BYTES];
+    int32_t native;             /* offset of the native code in jit_code, 0 if not translated, -1 if none */
+    uint16_t native_ticks;      /* upper bound of the native code's ticks */
+    uint8_t native_ops;         /* number of translated instructions */
+    uint8_t num_decodes;        /* number of times the block was decoded at its pc */
+} z80_block_t;
+
+typedef struct {
+    const uint8_t* rom;         /* optional read-only memory */
+    int rom_size;
+    int num_blocks;             /* used blocks, block 0 is never used */
+    uint64_t gen[Z80_NUM_PAGES];        /* write generation of each page */
+    uint16_t index[1<<16];              /* block number of each PC, 0 if none */
+    z80_block_t block[Z80_MAX_BLOCKS];
+    /* the recompiler, see z80_set_jit() */
+    uint8_t* jit_code;          /* executable memory for the native code, 0 if off */
+    int jit_used;               /* used bytes of jit_code */
+    bool jit_verify;            /* compare each native block run against the interpreter */
+    uint32_t jit_checked;       /* compared native block runs */
+    uint32_t jit_mismatches;    /* compared runs with a different result */
+    uint16_t jit_mismatch_pc;   /* start of the first block with a different result */
+} z80_blocks_t;
+
 /* initialization attributes */
 typedef struct {
     z80_tick_t tick_cb;         /* tick callback */
@@ -396,6 +502,9 @@ typedef struct {
     z80_trap_t trap_cb;
     void* trap_user_data;
     int trap_id;                /* != 0 if a trap has been hit */
+    const z80_page_t* pages;    /* optional memory pages for the fast path */
+    int fast_ticks;             /* set by the tick callback: number of ticks it doesn't need to see */
+    z80_blocks_t* blocks;       /* optional predecoded basic-block cache */
 } z80_t;
 
 /* initialize a new z80 instance */
@@ -404,6 +513,14 @@ void z80_init(z80_t* cpu, const z80_desc_t* desc);
 void z80_reset(z80_t* cpu);
 /* set optional trap callback function */
 void z80_trap_cb(z80_t* cpu, z80_trap_t trap_cb, void* trap_user_data);
+/* set optional memory page table for the memory access fast path */
+void z80_set_pages(z80_t* cpu, const z80_page_t* pages);
+/* set optional predecoded basic-block cache, blocks decoded from rom never go stale */
+void z80_set_blocks(z80_t* cpu, z80_blocks_t* blocks, const uint8_t* rom, int rom_size);
+/* make the predecoded blocks of memory written outside of z80_exec() stale */
+void z80_invalidate_blocks(z80_t* cpu, uint16_t addr, int num_bytes);
+/* enable/disable the recompiler for the block cache, returns false if it isn't supported */
+bool z80_set_jit(z80_t* cpu, bool enabled, bool verify);
 /* execute instructions for at least 'ticks', but at least one, return executed ticks */
 uint32_t z80_exec(z80_t* cpu, uint32_t ticks);
 /* return false if z80_exec() returned in the middle of an extended instruction */
@@ -497,6 +614,15 @@ bool z80_ei_pending(z80_t* cpu);
 /*-- IMPLEMENTATION ----------------------------------------------------------*/
 #ifdef CHIPS_IMPL
 #include <string.h>
+/* the recompiler emits x86-64 code for the System V calling convention */
+#if defined(__x86_64__) && !defined(_WIN32)
+    #define _Z80_JIT (1)
+    #include <stddef.h>
+    #include <sys/mman.h>
+    #if !defined(MAP_ANONYMOUS)
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif
+#endif
 #ifndef CHIPS_ASSERT
     #include <assert.h>
     #define CHIPS_ASSERT(c) assert(c)
@@ -552,34 +678,44 @@ bool z80_ei_pending(z80_t* cpu);
 #define _SAD(addr,data) pins=(pins&~0xFFFFFFULL)|((((data)&0xFFULL)<<16)&0xFF0000ULL)|((addr)&0xFFFFULL)
 /* get 8-bit data bus value from pins */
 #define _GD() ((uint8_t)((pins&0xFF0000ULL)>>16))
-/* invoke 'filler tick' without control pins set */
-#define _T(num) pins=tick(num,(pins&~Z80_CTRL_MASK),ud);ticks+=num
-/* invoke tick callback with pins mask */
-#define _TM(num,mask) pins=tick(num,(pins&~(Z80_CTRL_MASK))|(mask),ud);ticks+=num
-/* invoke tick callback (with wait state detection) */
-#define _TWM(num,mask) pins=tick(num,(pins&~(Z80_WAIT_MASK|Z80_CTRL_MASK))|(mask),ud);ticks+=num+Z80_GET_WAIT(pins)
-/* memory read machine cycle */
-#define _MR(addr,data) _SA(addr);_TWM(3,Z80_MREQ|Z80_RD);data=_GD()
-/* memory write machine cycle */
-#define _MW(addr,data) _SAD(addr,data);_TWM(3,Z80_MREQ|Z80_WR)
+/* true if the tick callback doesn't need to see the next 'num' ticks */
+#define _FAST(num) ((pend+(num))<cpu->fast_ticks)
+/* fast path memory page of the address on the address bus */
+#define _PAGE() pages[(pins&0xFFFFULL)>>Z80_PAGE_SHIFT]
+/* offset of the address on the address bus into its memory page */
+#define _POFS() (pins&(Z80_PAGE_SIZE-1))
+/* invoke 'filler tick' without control pins set, or defer it to the next tick callback */
+#define _T(num) if(_FAST(num)){pend+=num;}else{pins=tick(pend+num,(pins&~Z80_CTRL_MASK),ud);pend=0;code_left=0;}ticks+=num
+/* invoke tick callback with pins mask, including the deferred ticks (this ends a predecoded block) */
+#define _TM(num,mask) pins=tick(pend+num,(pins&~(Z80_CTRL_MASK))|(mask),ud);pend=0;code_left=0;ticks+=num
+/* invoke tick callback (with wait state detection), including the deferred ticks (this ends a predecoded block) */
+#define _TWM(num,mask) pins=tick(pend+num,(pins&~(Z80_WAIT_MASK|Z80_CTRL_MASK))|(mask),ud);pend=0;code_left=0;ticks+=num+Z80_GET_WAIT(pins)
+/* memory read machine cycle, direct page access on the fast path */
+#define _MR(addr,data) _SA(addr);{const uint8_t* p_=_PAGE().read_ptr;if(p_&&_FAST(3)){data=p_[_POFS()];pend+=3;ticks+=3;}else{_TWM(3,Z80_MREQ|Z80_RD);data=_GD();}}
+/* memory write machine cycle, direct page access on the fast path, makes the page's predecoded blocks stale */
+#define _MW(addr,data) _SAD(addr,data);{const int pg_=(int)((pins&0xFFFFULL)>>Z80_PAGE_SHIFT);uint8_t* p_=pages[pg_].write_ptr;if(p_&&_FAST(3)){p_[_POFS()]=_GD();pend+=3;ticks+=3;}else{_TWM(3,Z80_MREQ|Z80_WR);}if(blocks){blocks->gen[pg_]++;if(pg_==(pc>>Z80_PAGE_SHIFT)){code_left=0;}}}
+/* read the next byte of the predecoded block as a 'num' ticks machine cycle on the fast path */
+#define _CODE(num,data) _SA(pc++);data=*code++;code_left--;pend+=num;ticks+=num
 /* input machine cycle */
 #define _IN(addr,data) _SA(addr);_TWM(4,Z80_IORQ|Z80_RD);data=_GD()
 /* output machine cycle */
 #define _OUT(addr,data) _SAD(addr,data);_TWM(4,Z80_IORQ|Z80_WR);
 /* read 8-bit immediate value */
-#define _IMM8(data) _MR(pc++,data);
+#define _IMM8(data) if(code_left>0){_CODE(3,data);}else{_MR(pc++,data);}
 /* read 16-bit immediate value (also update WZ register) */
-#define _IMM16(data) {uint8_t w,z;_MR(pc++,z);_MR(pc++,w);data=(w<<8)|z;_S_WZ(data);} 
+#define _IMM16(data) {uint8_t w,z;_IMM8(z);_IMM8(w);data=(w<<8)|z;_S_WZ(data);}
 /* true if current op is an indexed op */
 #define _IDX() (0!=(r2&_BITS_USE_IXIY))
 /* generate effective address for (HL), (IX+d), (IY+d) */
-#define _ADDR(addr,ext_ticks) {addr=_G16(ws,_HL);if(_IDX()){int8_t d;_MR(pc++,d);addr+=d;_S_WZ(addr);_T(ext_ticks);}}
-/* helper macro to bump R register */
-#define _BUMPR() d8=_G8(r2,_R);d8=(d8&0x80)|((d8+1)&0x7F);_S8(r2,_R,d8)
+#define _ADDR(addr,ext_ticks) {addr=_G16(ws,_HL);if(_IDX()){int8_t d;_IMM8(d);addr+=d;_S_WZ(addr);_T(ext_ticks);}}
+/* helper macro to bump R register, this only counts M1 cycles, see _SYNCR() */
+#define _BUMPR() m1++
+/* add the counted M1 cycles to the lower 7 bits of the R register */
+#define _SYNCR() {uint8_t r_=_G8(r2,_R);r_=(r_&0x80)|((r_+m1)&0x7F);_S8(r2,_R,r_);m1=0;}
 /* a normal opcode fetch, bump R */
-#define _FETCH(op) {_SA(pc++);_TWM(4,Z80_M1|Z80_MREQ|Z80_RD);op=_GD();_BUMPR();}
+#define _FETCH(op) {if(code_left>0){_CODE(4,op);}else{_SA(pc++);const uint8_t* p_=_PAGE().read_ptr;if(p_&&_FAST(4)){op=p_[_POFS()];pend+=4;ticks+=4;}else{_TWM(4,Z80_M1|Z80_MREQ|Z80_RD);op=_GD();}}_BUMPR();}
 /* special opcode fetch for CB prefix, only bump R if not a DD/FD+CB 'double prefix' op */
-#define _FETCH_CB(op) {_SA(pc++);_TWM(4,Z80_M1|Z80_MREQ|Z80_RD);op=_GD();if(!_IDX()){_BUMPR();}}
+#define _FETCH_CB(op) {if(code_left>0){_CODE(4,op);}else{_SA(pc++);const uint8_t* p_=_PAGE().read_ptr;if(p_&&_FAST(4)){op=p_[_POFS()];pend+=4;ticks+=4;}else{_TWM(4,Z80_M1|Z80_MREQ|Z80_RD);op=_GD();}}if(!_IDX()){_BUMPR();}}
 /* evaluate S+Z flags */
 #define _SZ(val) ((val&0xFF)?(val&Z80_SF):Z80_ZF)
 /* evaluate SZYXCH flags */
@@ -735,6 +871,189 @@ void z80_trap_cb(z80_t* cpu, z80_trap_t trap_cb, void* trap_user_data) {
     cpu->trap_user_data = trap_user_data;
 }
 
+void z80_set_pages(z80_t* cpu, const z80_page_t* pages) {
+    CHIPS_ASSERT(cpu);
+    cpu->pages = pages;
+    cpu->fast_ticks = 0;
+}
+
+/* page table without any directly accessible memory, used when no pages are set */
+static const z80_page_t _z80_no_pages[Z80_NUM_PAGES] = { { 0, 0 } };
+
+void z80_set_blocks(z80_t* cpu, z80_blocks_t* blocks, const uint8_t* rom, int rom_size) {
+    CHIPS_ASSERT(cpu);
+    CHIPS_ASSERT((0 == rom_size) || rom);
+    cpu->blocks = blocks;
+    if (blocks) {
+        memset(blocks->gen, 0, sizeof(blocks->gen));
+        memset(blocks->index, 0, sizeof(blocks->index));
+        blocks->num_blocks = 1;
+        blocks->rom = rom;
+        blocks->rom_size = rom_size;
+    }
+}
+
+void z80_invalidate_blocks(z80_t* cpu, uint16_t addr, int num_bytes) {
+    CHIPS_ASSERT(cpu && (num_bytes >= 0));
+    if (cpu->blocks && (num_bytes > 0)) {
+        const int last = (addr + num_bytes - 1) >> Z80_PAGE_SHIFT;
+        for (int pg = addr >> Z80_PAGE_SHIFT; pg <= last; pg++) {
+            cpu->blocks->gen[pg & (Z80_NUM_PAGES-1)]++;
+        }
+    }
+}
+
+/* number of immediate operand bytes of an unprefixed opcode */
+static int _z80_imm_bytes(uint8_t op) {
+    const uint8_t x = op>>6, y = (op>>3)&7, z = op&7;
+    if (x == 0) {
+        switch (z) {
+            case 0: return (y >= 2) ? 1 : 0;            /* DJNZ, JR */
+            case 1: return (y & 1) ? 0 : 2;             /* LD rr,nn */
+            case 2: return (y >= 4) ? 2 : 0;            /* LD (nn),HL/A, LD HL/A,(nn) */
+            case 6: return 1;                           /* LD r,n */
+            default: return 0;
+        }
+    }
+    else if (x == 3) {
+        switch (z) {
+            case 2: case 4: return 2;                   /* JP cc,nn, CALL cc,nn */
+            case 3: return (y == 0) ? 2 : (((y == 2) || (y == 3)) ? 1 : 0);  /* JP nn, OUT (n),A, IN A,(n) */
+            case 5: return (y == 1) ? 2 : 0;            /* CALL nn */
+            case 6: return 1;                           /* ALU n */
+            default: return 0;
+        }
+    }
+    return 0;
+}
+
+/* true if an unprefixed opcode accesses (HL), which becomes (IX+d)/(IY+d) */
+static bool _z80_hl_ind(uint8_t op) {
+    const uint8_t x = op>>6, y = (op>>3)&7, z = op&7;
+    if (x == 0) {
+        return (op >= 0x34) && (op <= 0x36);
+    }
+    else if (x == 1) {
+        return ((z == 6) || (y == 6)) && (op != 0x76);
+    }
+    else if (x == 2) {
+        return z == 6;
+    }
+    return false;
+}
+
+/* true if an unprefixed opcode may continue anywhere else than at the next instruction, or does IO */
+static bool _z80_block_end(uint8_t op) {
+    const uint8_t x = op>>6, y = (op>>3)&7, z = op&7;
+    if (x == 0) {
+        return (z == 0) && (y >= 2);                    /* DJNZ, JR */
+    }
+    else if (x == 3) {
+        switch (z) {
+            case 1: return (y == 1) || (y == 5);        /* RET, JP (HL) */
+            case 3: return (y == 0) || (y == 2) || (y == 3);    /* JP nn, OUT (n),A, IN A,(n) */
+            case 5: return y == 1;                      /* CALL nn */
+            case 6: return false;
+            default: return true;                       /* RET cc, JP cc, CALL cc, RST */
+        }
+    }
+    return op == 0x76;                                  /* HALT */
+}
+
+/* decode the block at pc from the page memory at src into the cache, returns 0 if no instruction fits */
+static z80_block_t* _z80_decode_block(z80_blocks_t* blocks, uint16_t pc, const uint8_t* src) {
+    int max_bytes = Z80_PAGE_SIZE - (pc & (Z80_PAGE_SIZE-1));
+    if (max_bytes > Z80_BLOCK_MAX_BYTES) {
+        max_bytes = Z80_BLOCK_MAX_BYTES;
+    }
+    int num_bytes = 0;
+    int ticks = 0;
+    bool end = false;
+    while (!end) {
+        /* DD/FD prefixes are executed as separate 4-tick instructions */
+        int pos = num_bytes;
+        int num_prefixes = 0;
+        while ((pos < max_bytes) && ((src[pos] == 0xDD) || (src[pos] == 0xFD))) {
+            pos++;
+            num_prefixes++;
+        }
+        if (pos >= max_bytes) {
+            break;
+        }
+        const uint8_t op = src[pos++];
+        if (op == 0xCB) {
+            /* DD/FD+CB has the displacement before the opcode */
+            pos += (num_prefixes > 0) ? 2 : 1;
+        }
+        else if (op == 0xED) {
+            /* ED cancels the DD/FD prefix */
+            if (pos >= max_bytes) {
+                break;
+            }
+            const uint8_t op2 = src[pos++];
+            if ((op2 & 0xC7) == 0x43) {
+                pos += 2;                               /* LD (nn),rr, LD rr,(nn) */
+            }
+            end = ((op2 & 0xC6) == 0x40) || ((op2 & 0xC7) == 0x45) || (op2 >= 0xA0);  /* IN, OUT, RETN, RETI, block ops */
+        }
+        else {
+            pos += _z80_imm_bytes(op) + (((num_prefixes > 0) && _z80_hl_ind(op)) ? 1 : 0);
+            end = _z80_block_end(op);
+        }
+        if (pos > max_bytes) {
+            break;
+        }
+        num_bytes = pos;
+        /* no instruction takes more than 23 ticks */
+        ticks += 4 * num_prefixes + 23;
+    }
+    if (0 == num_bytes) {
+        return 0;
+    }
+    int i = blocks->index[pc];
+    if (0 == i) {
+        if (blocks->num_blocks >= Z80_MAX_BLOCKS) {
+            memset(blocks->index, 0, sizeof(blocks->index));
+            blocks->num_blocks = 1;
+        }
+        i = blocks->num_blocks++;
+        blocks->index[pc] = (uint16_t) i;
+        blocks->block[i].num_decodes = 0;
+    }
+    z80_block_t* blk = &blocks->block[i];
+    blk->src = src;
+    blk->gen = blocks->gen[pc >> Z80_PAGE_SHIFT];
+    blk->rom = ((uintptr_t)src - (uintptr_t)blocks->rom) < (uintptr_t)blocks->rom_size;
+    blk->num_bytes = (uint8_t) num_bytes;
+    blk->ticks = (uint16_t) ticks;
+    memcpy(blk->bytes, src, num_bytes);
+    blk->native = 0;
+    if (blk->num_decodes < 0xFF) {
+        blk->num_decodes++;
+    }
+    return blk;
+}
+
+/* look up or decode the block at pc, returns it if it fits into the fast path ticks, or 0 */
+static inline z80_block_t* _z80_enter_block(z80_blocks_t* blocks, const z80_page_t* pages, uint16_t pc, int fast) {
+    const uint8_t* src = pages[pc >> Z80_PAGE_SHIFT].read_ptr;
+    if (!src) {
+        return 0;
+    }
+    src += pc & (Z80_PAGE_SIZE-1);
+    z80_block_t* blk = &blocks->block[blocks->index[pc]];
+    if ((0 == blocks->index[pc]) || (blk->src != src) || (!blk->rom && (blk->gen != blocks->gen[pc >> Z80_PAGE_SHIFT]))) {
+        blk = _z80_decode_block(blocks, pc, src);
+        if (!blk) {
+            return 0;
+        }
+    }
+    if (blk->ticks >= fast) {
+        return 0;
+    }
+    return blk;
+}
+
 bool z80_opdone(z80_t* cpu) {
     return 0 == (cpu->im_ir_pc_bits & _BITS_USE_IXIY);
 }
@@ -822,8 +1141,1153 @@ static inline uint64_t _z80_flush_r1(uint64_t ws, uint64_t r1, uint64_t map_bits
     return r1;
 }
 
-/* instruction decoder */
-uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
+#if defined(_Z80_JIT)
+/*  The recompiler
+
+    The native code of a block is a function that gets the CPU state in a
+    _z80_jit_ctx_t. It runs with rbx=ctx, r12d=executed ticks, r13d=executed
+    instructions, r14=pages, r15=gen and rbp=_z80_szp, the Z80 registers
+    stay in the context. Each instruction first checks the pages of its
+    memory accesses and jumps to an exit which stores its pc if one isn't on
+    the fast path, so the interpreter continues there, then it executes.
+    The flags come from the host's ALU: LAHF has S, Z, H and C at the Z80's
+    bit positions, SETO gives V. A block that jumps back to its own start
+    loops in the native code, as long as the interpreter would enter it
+    again (loop_ticks).
+*/
+typedef struct {
+    uint64_t ws;
+    uint64_t r1;
+    uint64_t r3;
+    uint64_t pins;
+    const z80_page_t* pages;
+    uint64_t* gen;
+    z80_trap_t trap;
+    void* trap_user_data;
+    uint32_t ticks;             /* ticks executed before the block, for the trap callback */
+    int32_t loop_ticks;         /* the block runs again if it jumps to its start with at most these executed ticks */
+    int trap_id;                /* out: != 0 if the trap callback stopped the block */
+    uint32_t num_ticks;         /* out: executed ticks */
+    uint32_t num_ops;           /* out: executed instructions */
+    uint16_t pc;                /* in/out */
+} _z80_jit_ctx_t;
+
+/* byte offsets of registers and fields in the context */
+#define _Z80_JIT_WS(r) ((int)offsetof(_z80_jit_ctx_t,ws)+((r)>>3))
+#define _Z80_JIT_R1(r) ((int)offsetof(_z80_jit_ctx_t,r1)+((r)>>3))
+#define _Z80_JIT_R3 ((int)offsetof(_z80_jit_ctx_t,r3))
+#define _Z80_JIT_PINS ((int)offsetof(_z80_jit_ctx_t,pins))
+#define _Z80_JIT_PC ((int)offsetof(_z80_jit_ctx_t,pc))
+#define _Z80_JIT_MAX_CODE (16*1024)     /* upper bound of one block's native code */
+#define _Z80_JIT_MAX_FIXUPS (256)
+#define _Z80_JIT_MAX_DECODES (8)        /* blocks decoded more often stay in the interpreter */
+#define _Z80_JIT_MAX_STEPS (128)      /* instructions compared in the conformance mode */
+#define _Z80_JIT_MAX_WRITES (2*_Z80_JIT_MAX_STEPS)
+
+/* host registers, and the 8-bit registers with the same numbers */
+enum { _Z80_JIT_EAX=0, _Z80_JIT_ECX=1, _Z80_JIT_EDX=2, _Z80_JIT_RSI=6, _Z80_JIT_RDI=7 };
+enum { _Z80_JIT_AL=0, _Z80_JIT_CL=1, _Z80_JIT_DL=2, _Z80_JIT_AH=4, _Z80_JIT_DH=6 };
+
+/* code buffer of one block, with the jumps to exits and to the epilogue */
+typedef struct {
+    uint8_t* buf;
+    int pos;
+    int num_fixups;
+    struct {
+        int pos;    /* rel32 to patch */
+        int pc;     /* exit storing this pc, or -1 for the epilogue */
+    } fixups[_Z80_JIT_MAX_FIXUPS];
+} _z80_jit_asm_t;
+
+static void _z80_jit_1(_z80_jit_asm_t* a, uint8_t b0) {
+    a->buf[a->pos++] = b0;
+}
+
+static void _z80_jit_2(_z80_jit_asm_t* a, uint8_t b0, uint8_t b1) {
+    _z80_jit_1(a, b0); _z80_jit_1(a, b1);
+}
+
+static void _z80_jit_3(_z80_jit_asm_t* a, uint8_t b0, uint8_t b1, uint8_t b2) {
+    _z80_jit_1(a, b0); _z80_jit_1(a, b1); _z80_jit_1(a, b2);
+}
+
+static void _z80_jit_4(_z80_jit_asm_t* a, uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+    _z80_jit_1(a, b0); _z80_jit_1(a, b1); _z80_jit_1(a, b2); _z80_jit_1(a, b3);
+}
+
+static void _z80_jit_32(_z80_jit_asm_t* a, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        _z80_jit_1(a, (uint8_t)(v >> (i*8)));
+    }
+}
+
+static void _z80_jit_64(_z80_jit_asm_t* a, uint64_t v) {
+    _z80_jit_32(a, (uint32_t)v);
+    _z80_jit_32(a, (uint32_t)(v >> 32));
+}
+
+/* movzx r32, byte [rbx+ofs] */
+static void _z80_jit_ldb(_z80_jit_asm_t* a, int reg, int ofs) {
+    _z80_jit_4(a, 0x0F, 0xB6, 0x43|(reg<<3), ofs);
+}
+
+/* movzx r32, word [rbx+ofs] */
+static void _z80_jit_ldw(_z80_jit_asm_t* a, int reg, int ofs) {
+    _z80_jit_4(a, 0x0F, 0xB7, 0x43|(reg<<3), ofs);
+}
+
+/* mov [rbx+ofs], r8 */
+static void _z80_jit_stb(_z80_jit_asm_t* a, int reg8, int ofs) {
+    _z80_jit_3(a, 0x88, 0x43|(reg8<<3), ofs);
+}
+
+/* mov [rbx+ofs], r16 */
+static void _z80_jit_stw(_z80_jit_asm_t* a, int reg, int ofs) {
+    _z80_jit_4(a, 0x66, 0x89, 0x43|(reg<<3), ofs);
+}
+
+/* mov byte [rbx+ofs], imm8 */
+static void _z80_jit_stbi(_z80_jit_asm_t* a, int ofs, uint8_t v) {
+    _z80_jit_4(a, 0xC6, 0x43, ofs, v);
+}
+
+/* mov word [rbx+ofs], imm16 */
+static void _z80_jit_stwi(_z80_jit_asm_t* a, int ofs, uint16_t v) {
+    _z80_jit_4(a, 0x66, 0xC7, 0x43, ofs);
+    _z80_jit_2(a, (uint8_t)v, (uint8_t)(v>>8));
+}
+
+/* mov r32, imm32 */
+static void _z80_jit_movi(_z80_jit_asm_t* a, int reg, uint32_t v) {
+    _z80_jit_1(a, 0xB8+reg);
+    _z80_jit_32(a, v);
+}
+
+/* mov dst32, src32 */
+static void _z80_jit_mov(_z80_jit_asm_t* a, int dst, int src) {
+    _z80_jit_2(a, 0x89, 0xC0|(src<<3)|dst);
+}
+
+/* add r12d, ticks; inc r13d */
+static void _z80_jit_count(_z80_jit_asm_t* a, int ticks) {
+    _z80_jit_4(a, 0x41, 0x83, 0xC4, ticks);
+    _z80_jit_3(a, 0x41, 0xFF, 0xC5);
+}
+
+/* the address bus after the instruction, and the data bus after a write */
+static void _z80_jit_addr(_z80_jit_asm_t* a, int reg) {
+    _z80_jit_stw(a, reg, _Z80_JIT_PINS);
+}
+
+static void _z80_jit_addri(_z80_jit_asm_t* a, uint16_t addr) {
+    _z80_jit_stwi(a, _Z80_JIT_PINS, addr);
+}
+
+static void _z80_jit_data(_z80_jit_asm_t* a, int reg8) {
+    _z80_jit_stb(a, reg8, _Z80_JIT_PINS+2);
+}
+
+/* jcc rel32 (cc 4: je, 5: jne, 0xF: unconditional) to the exit of pc, or to the epilogue if pc < 0 */
+static void _z80_jit_exit(_z80_jit_asm_t* a, int cc, int pc) {
+    if (cc == 0xF) {
+        _z80_jit_1(a, 0xE9);
+    }
+    else {
+        _z80_jit_2(a, 0x0F, 0x80|cc);
+    }
+    CHIPS_ASSERT(a->num_fixups < _Z80_JIT_MAX_FIXUPS);
+    a->fixups[a->num_fixups].pos = a->pos;
+    a->fixups[a->num_fixups].pc = pc;
+    a->num_fixups++;
+    _z80_jit_32(a, 0);
+}
+
+/* forward jcc rel32 inside the block, returns the position to land() */
+static int _z80_jit_fwd(_z80_jit_asm_t* a, int cc) {
+    if (cc == 0xF) {
+        _z80_jit_1(a, 0xE9);
+    }
+    else {
+        _z80_jit_2(a, 0x0F, 0x80|cc);
+    }
+    _z80_jit_32(a, 0);
+    return a->pos - 4;
+}
+
+static void _z80_jit_land(_z80_jit_asm_t* a, int pos) {
+    const uint32_t rel = (uint32_t)(a->pos - (pos + 4));
+    memcpy(&a->buf[pos], &rel, 4);
+}
+
+/* look up the fast path page of the address in areg, and put the host pointer into preg (rsi or rdi),
+   exits to pc if there is none, or if a write goes to the page of the block's code
+*/
+static void _z80_jit_page(_z80_jit_asm_t* a, int preg, int areg, bool write, int code_page, uint16_t pc) {
+    _z80_jit_mov(a, _Z80_JIT_EAX, areg);
+    _z80_jit_3(a, 0xC1, 0xE8, Z80_PAGE_SHIFT);                  /* shr eax, Z80_PAGE_SHIFT */
+    if (write) {
+        _z80_jit_3(a, 0x83, 0xF8, code_page);                   /* cmp eax, code_page */
+        _z80_jit_exit(a, 0x4, pc);
+    }
+    _z80_jit_3(a, 0xC1, 0xE0, 4);                               /* shl eax, 4 */
+    if (write) {
+        _z80_jit_4(a, 0x49, 0x8B, 0x44|(preg<<3), 0x06);        /* mov preg, [r14+rax+write_ptr] */
+        _z80_jit_1(a, (uint8_t)offsetof(z80_page_t, write_ptr));
+    }
+    else {
+        _z80_jit_4(a, 0x49, 0x8B, 0x04|(preg<<3), 0x06);        /* mov preg, [r14+rax] */
+    }
+    _z80_jit_3(a, 0x48, 0x85, 0xC0|(preg<<3)|preg);             /* test preg, preg */
+    _z80_jit_exit(a, 0x4, pc);
+    _z80_jit_mov(a, _Z80_JIT_EAX, areg);
+    _z80_jit_1(a, 0x25); _z80_jit_32(a, Z80_PAGE_SIZE-1);       /* and eax, Z80_PAGE_SIZE-1 */
+    _z80_jit_3(a, 0x48, 0x01, 0xC0|preg);                       /* add preg, rax */
+}
+
+/* bump the write generation of the page of the address in areg */
+static void _z80_jit_gen(_z80_jit_asm_t* a, int areg) {
+    _z80_jit_mov(a, _Z80_JIT_EAX, areg);
+    _z80_jit_3(a, 0xC1, 0xE8, Z80_PAGE_SHIFT);                  /* shr eax, Z80_PAGE_SHIFT */
+    _z80_jit_4(a, 0x49, 0xFF, 0x04, 0xC7);                      /* inc qword [r15+rax*8] */
+}
+
+/* test the condition y of a conditional jump, returns the jump to land() if it isn't met */
+static int _z80_jit_cond(_z80_jit_asm_t* a, int y) {
+    static const uint8_t masks[4] = { Z80_ZF, Z80_CF, Z80_PF, Z80_SF };
+    _z80_jit_4(a, 0xF6, 0x43, _Z80_JIT_WS(_F), masks[y>>1]);   /* test byte [F], mask */
+    return _z80_jit_fwd(a, (y & 1) ? 0x4 : 0x5);
+}
+
+/* the stack pages of a push: sp-1 in ecx/rsi for the high byte, sp-2 in edx/rdi for the low byte */
+static void _z80_jit_push_pages(_z80_jit_asm_t* a, int code_page, uint16_t pc) {
+    _z80_jit_ldw(a, _Z80_JIT_ECX, _Z80_JIT_R1(_SP));
+    _z80_jit_3(a, 0x66, 0xFF, 0xC9);                            /* dec cx */
+    _z80_jit_page(a, _Z80_JIT_RSI, _Z80_JIT_ECX, true, code_page, pc);
+    _z80_jit_mov(a, _Z80_JIT_EDX, _Z80_JIT_ECX);
+    _z80_jit_3(a, 0x66, 0xFF, 0xCA);                            /* dec dx */
+    _z80_jit_page(a, _Z80_JIT_RDI, _Z80_JIT_EDX, true, code_page, pc);
+}
+
+/* push the 16-bit immediate value */
+static void _z80_jit_push_imm(_z80_jit_asm_t* a, uint16_t v) {
+    _z80_jit_3(a, 0xC6, 0x06, (uint8_t)(v>>8));                 /* mov byte [rsi], hi */
+    _z80_jit_3(a, 0xC6, 0x07, (uint8_t)v);                      /* mov byte [rdi], lo */
+    _z80_jit_stw(a, _Z80_JIT_EDX, _Z80_JIT_R1(_SP));
+    _z80_jit_addr(a, _Z80_JIT_EDX);
+    _z80_jit_stbi(a, _Z80_JIT_PINS+2, (uint8_t)v);
+    _z80_jit_gen(a, _Z80_JIT_ECX);
+    _z80_jit_gen(a, _Z80_JIT_EDX);
+}
+
+/* the stack pages of a pop: sp in ecx/rsi for the low byte, sp+1 in edx/rdi for the high byte */
+static void _z80_jit_pop_pages(_z80_jit_asm_t* a, int code_page, uint16_t pc) {
+    _z80_jit_ldw(a, _Z80_JIT_ECX, _Z80_JIT_R1(_SP));
+    _z80_jit_page(a, _Z80_JIT_RSI, _Z80_JIT_ECX, false, code_page, pc);
+    _z80_jit_mov(a, _Z80_JIT_EDX, _Z80_JIT_ECX);
+    _z80_jit_3(a, 0x66, 0xFF, 0xC2);                            /* inc dx */
+    _z80_jit_page(a, _Z80_JIT_RDI, _Z80_JIT_EDX, false, code_page, pc);
+}
+
+/* pop into pc and wz */
+static void _z80_jit_ret(_z80_jit_asm_t* a) {
+    _z80_jit_3(a, 0x0F, 0xB6, 0x06);                            /* movzx eax, byte [rsi] */
+    _z80_jit_2(a, 0x8A, 0x27);                                  /* mov ah, [rdi] */
+    _z80_jit_stw(a, _Z80_JIT_EAX, _Z80_JIT_PC);
+    _z80_jit_stw(a, _Z80_JIT_EAX, _Z80_JIT_R1(_WZ));
+    _z80_jit_addr(a, _Z80_JIT_EDX);
+    _z80_jit_3(a, 0x66, 0xFF, 0xC2);                            /* inc dx */
+    _z80_jit_stw(a, _Z80_JIT_EDX, _Z80_JIT_R1(_SP));
+}
+
+/* INC/DEC of dl, sets F */
+static void _z80_jit_incdec(_z80_jit_asm_t* a, bool dec) {
+    _z80_jit_2(a, 0xFE, dec ? 0xCA : 0xC2);                     /* inc/dec dl */
+    _z80_jit_1(a, 0x9F);                                        /* lahf */
+    _z80_jit_3(a, 0x0F, 0x90, 0xC0);                            /* seto al */
+    _z80_jit_3(a, 0xC0, 0xE0, 2);                               /* shl al, 2 */
+    _z80_jit_3(a, 0x80, 0xE4, Z80_SF|Z80_ZF|Z80_HF);            /* and ah, S|Z|H */
+    _z80_jit_2(a, 0x08, 0xE0);                                  /* or al, ah */
+    _z80_jit_2(a, 0x88, 0xD4);                                  /* mov ah, dl */
+    _z80_jit_3(a, 0x80, 0xE4, Z80_YF|Z80_XF);                   /* and ah, Y|X */
+    _z80_jit_2(a, 0x08, 0xE0);                                  /* or al, ah */
+    _z80_jit_3(a, 0x8A, 0x63, _Z80_JIT_WS(_F));                 /* mov ah, [F] */
+    _z80_jit_3(a, 0x80, 0xE4, Z80_CF);                          /* and ah, C */
+    _z80_jit_2(a, 0x08, 0xE0);                                  /* or al, ah */
+    if (dec) {
+        _z80_jit_2(a, 0x0C, Z80_NF);                            /* or al, N */
+    }
+    _z80_jit_stb(a, _Z80_JIT_AL, _Z80_JIT_WS(_F));
+}
+
+/* 8-bit ALU operation y of A and dl */
+static void _z80_jit_alu(_z80_jit_asm_t* a, int y) {
+    static const uint8_t ops[8] = { 0x00, 0x10, 0x28, 0x18, 0x20, 0x30, 0x08, 0x38 };
+    _z80_jit_ldb(a, _Z80_JIT_EAX, _Z80_JIT_WS(_A));
+    if ((y >= 4) && (y <= 6)) {
+        /* AND, XOR, OR: flags from the SZP table */
+        _z80_jit_2(a, ops[y], 0xD0);                            /* op al, dl */
+        _z80_jit_stb(a, _Z80_JIT_AL, _Z80_JIT_WS(_A));
+        _z80_jit_3(a, 0x0F, 0xB6, 0xC0);                        /* movzx eax, al */
+        _z80_jit_4(a, 0x0F, 0xB6, 0x44, 0x05); _z80_jit_1(a, 0);   /* movzx eax, byte [rbp+rax] */
+        if (y == 4) {
+            _z80_jit_2(a, 0x0C, Z80_HF);                        /* or al, H */
+        }
+        _z80_jit_stb(a, _Z80_JIT_AL, _Z80_JIT_WS(_F));
+        return;
+    }
+    if ((y == 1) || (y == 3)) {
+        _z80_jit_4(a, 0x0F, 0xBA, 0x63, _Z80_JIT_WS(_F)); _z80_jit_1(a, 0);   /* bt dword [F], 0 */
+    }
+    _z80_jit_2(a, ops[y], 0xD0);                                /* op al, dl */
+    _z80_jit_1(a, 0x9F);                                        /* lahf */
+    _z80_jit_3(a, 0x0F, 0x90, 0xC6);                            /* seto dh */
+    _z80_jit_3(a, 0xC0, 0xE6, 2);                               /* shl dh, 2 */
+    _z80_jit_3(a, 0x80, 0xE4, Z80_SF|Z80_ZF|Z80_HF|Z80_CF);     /* and ah, S|Z|H|C */
+    _z80_jit_2(a, 0x08, 0xF4);                                  /* or ah, dh */
+    if (y != 7) {
+        _z80_jit_stb(a, _Z80_JIT_AL, _Z80_JIT_WS(_A));
+        _z80_jit_2(a, 0x88, 0xC6);                              /* mov dh, al */
+    }
+    else {
+        /* CP takes X and Y from the operand */
+        _z80_jit_2(a, 0x88, 0xD6);                              /* mov dh, dl */
+    }
+    _z80_jit_3(a, 0x80, 0xE6, Z80_YF|Z80_XF);                   /* and dh, Y|X */
+    _z80_jit_2(a, 0x08, 0xF4);                                  /* or ah, dh */
+    if (y >= 2) {
+        _z80_jit_3(a, 0x80, 0xCC, Z80_NF);                      /* or ah, N */
+    }
+    _z80_jit_stb(a, _Z80_JIT_AH, _Z80_JIT_WS(_F));
+}
+
+/* F = (F & keep) | (al & (Y|X)) | dl, with the new A in al and the new flag bits in dl */
+static void _z80_jit_accf(_z80_jit_asm_t* a, uint8_t keep) {
+    _z80_jit_2(a, 0x24, Z80_YF|Z80_XF);                         /* and al, Y|X */
+    _z80_jit_2(a, 0x08, 0xD0);                                  /* or al, dl */
+    _z80_jit_3(a, 0x8A, 0x53, _Z80_JIT_WS(_F));                 /* mov dl, [F] */
+    _z80_jit_3(a, 0x80, 0xE2, keep);                            /* and dl, keep */
+    _z80_jit_2(a, 0x08, 0xD0);                                  /* or al, dl */
+    _z80_jit_stb(a, _Z80_JIT_AL, _Z80_JIT_WS(_F));
+}
+
+/* translate the unprefixed instruction at b, returns its maximum ticks, or 0 if it stays in the interpreter,
+   end is set for instructions which set the pc in the context
+*/
+static int _z80_jit_op(_z80_jit_asm_t* a, const uint8_t* b, uint16_t pc, uint16_t next, int code_page, bool* end) {
+    static const int8_t r8[8] = { _Z80_JIT_WS(_B), _Z80_JIT_WS(_C), _Z80_JIT_WS(_D), _Z80_JIT_WS(_E), _Z80_JIT_WS(_H), _Z80_JIT_WS(_L), -1, _Z80_JIT_WS(_A) };
+    static const int8_t rp[4] = { _Z80_JIT_WS(_BC), _Z80_JIT_WS(_DE), _Z80_JIT_WS(_HL), _Z80_JIT_R1(_SP) };
+    const uint8_t op = b[0];
+    const int x = op>>6, y = (op>>3)&7, z = op&7, p = y>>1, q = y&1;
+    const uint8_t n = b[1];
+    const uint16_t nn = (uint16_t)(b[1] | (b[2]<<8));
+    const int HL = _Z80_JIT_WS(_HL), A = _Z80_JIT_WS(_A), WZ = _Z80_JIT_R1(_WZ), PC = _Z80_JIT_PC;
+    enum { EAX=_Z80_JIT_EAX, ECX=_Z80_JIT_ECX, EDX=_Z80_JIT_EDX, RSI=_Z80_JIT_RSI, RDI=_Z80_JIT_RDI };
+    if (x == 1) {
+        if (op == 0x76) {
+            /* HALT */
+            return 0;
+        }
+        if (z == 6) {
+            /* LD r,(HL) */
+            _z80_jit_ldw(a, ECX, HL);
+            _z80_jit_page(a, RSI, ECX, false, code_page, pc);
+            _z80_jit_count(a, 7);
+            _z80_jit_3(a, 0x0F, 0xB6, 0x06);                    /* movzx eax, byte [rsi] */
+            _z80_jit_stb(a, _Z80_JIT_AL, r8[y]);
+            _z80_jit_addr(a, ECX);
+            return 7;
+        }
+        if (y == 6) {
+            /* LD (HL),r */
+            _z80_jit_ldw(a, ECX, HL);
+            _z80_jit_page(a, RSI, ECX, true, code_page, pc);
+            _z80_jit_count(a, 7);
+            _z80_jit_ldb(a, EDX, r8[z]);
+            _z80_jit_2(a, 0x88, 0x16);                          /* mov [rsi], dl */
+            _z80_jit_addr(a, ECX);
+            _z80_jit_data(a, _Z80_JIT_DL);
+            _z80_jit_gen(a, ECX);
+            return 7;
+        }
+        /* LD r,r */
+        _z80_jit_count(a, 4);
+        _z80_jit_ldb(a, EAX, r8[z]);
+        _z80_jit_stb(a, _Z80_JIT_AL, r8[y]);
+        _z80_jit_addri(a, pc);
+        return 4;
+    }
+    if (x == 2) {
+        /* ALU r, ALU (HL) */
+        int ticks = 4;
+        if (z == 6) {
+            _z80_jit_ldw(a, ECX, HL);
+            _z80_jit_page(a, RSI, ECX, false, code_page, pc);
+            _z80_jit_count(a, 7);
+            _z80_jit_3(a, 0x0F, 0xB6, 0x16);                    /* movzx edx, byte [rsi] */
+            _z80_jit_addr(a, ECX);
+            ticks = 7;
+        }
+        else {
+            _z80_jit_count(a, 4);
+            _z80_jit_ldb(a, EDX, r8[z]);
+            _z80_jit_addri(a, pc);
+        }
+        _z80_jit_alu(a, y);
+        return ticks;
+    }
+    if (x == 0) {
+        switch (z) {
+            case 0:
+                if (y == 0) {
+                    /* NOP */
+                    _z80_jit_count(a, 4);
+                    _z80_jit_addri(a, pc);
+                    return 4;
+                }
+                else if (y == 1) {
+                    /* EX AF,AF' */
+                    _z80_jit_count(a, 4);
+                    _z80_jit_ldw(a, EAX, _Z80_JIT_WS(_FA));
+                    _z80_jit_ldw(a, EDX, _Z80_JIT_R3);
+                    _z80_jit_stw(a, EDX, _Z80_JIT_WS(_FA));
+                    _z80_jit_stw(a, EAX, _Z80_JIT_R3);
+                    _z80_jit_addri(a, pc);
+                    return 4;
+                }
+                else {
+                    /* DJNZ, JR, JR cc */
+                    const uint16_t target = (uint16_t)(next + (int8_t)n);
+                    int skip = -1;
+                    _z80_jit_addri(a, pc+1);
+                    if (y == 2) {
+                        _z80_jit_3(a, 0xFE, 0x4B, _Z80_JIT_WS(_B));     /* dec byte [B] */
+                        skip = _z80_jit_fwd(a, 0x4);
+                    }
+                    else if (y >= 4) {
+                        skip = _z80_jit_cond(a, y-4);
+                    }
+                    const int taken = (y == 2) ? 13 : 12;
+                    _z80_jit_count(a, taken);
+                    _z80_jit_stwi(a, PC, target);
+                    _z80_jit_stwi(a, WZ, target);
+                    if (skip >= 0) {
+                        const int done = _z80_jit_fwd(a, 0xF);
+                        _z80_jit_land(a, skip);
+                        _z80_jit_count(a, (y == 2) ? 8 : 7);
+                        _z80_jit_stwi(a, PC, next);
+                        _z80_jit_land(a, done);
+                    }
+                    *end = true;
+                    return taken;
+                }
+            case 1:
+                if (q == 0) {
+                    /* LD rr,nn */
+                    _z80_jit_count(a, 10);
+                    _z80_jit_stwi(a, rp[p], nn);
+                    _z80_jit_stwi(a, WZ, nn);
+                    _z80_jit_addri(a, pc+2);
+                    return 10;
+                }
+                else {
+                    /* ADD HL,rr */
+                    _z80_jit_count(a, 11);
+                    _z80_jit_ldw(a, EAX, HL);
+                    _z80_jit_ldw(a, EDX, rp[p]);
+                    _z80_jit_3(a, 0x8D, 0x48, 0x01);            /* lea ecx, [rax+1] */
+                    _z80_jit_stw(a, ECX, WZ);
+                    _z80_jit_mov(a, ECX, EAX);
+                    _z80_jit_2(a, 0x01, 0xD0);                  /* add eax, edx */
+                    _z80_jit_stw(a, EAX, HL);
+                    _z80_jit_2(a, 0x31, 0xD1);                  /* xor ecx, edx */
+                    _z80_jit_2(a, 0x31, 0xC1);                  /* xor ecx, eax */
+                    _z80_jit_3(a, 0xC1, 0xE9, 8);               /* shr ecx, 8 */
+                    _z80_jit_3(a, 0x83, 0xE1, Z80_HF);          /* and ecx, H */
+                    _z80_jit_mov(a, EDX, EAX);
+                    _z80_jit_3(a, 0xC1, 0xEA, 16);              /* shr edx, 16 */
+                    _z80_jit_2(a, 0x09, 0xD1);                  /* or ecx, edx */
+                    _z80_jit_3(a, 0xC1, 0xE8, 8);               /* shr eax, 8 */
+                    _z80_jit_3(a, 0x83, 0xE0, Z80_YF|Z80_XF);   /* and eax, Y|X */
+                    _z80_jit_2(a, 0x09, 0xC1);                  /* or ecx, eax */
+                    _z80_jit_3(a, 0x8A, 0x43, _Z80_JIT_WS(_F)); /* mov al, [F] */
+                    _z80_jit_2(a, 0x24, Z80_SF|Z80_ZF|Z80_VF);  /* and al, S|Z|V */
+                    _z80_jit_2(a, 0x08, 0xC1);                  /* or cl, al */
+                    _z80_jit_stb(a, _Z80_JIT_CL, _Z80_JIT_WS(_F));
+                    _z80_jit_addri(a, pc);
+                    return 11;
+                }
+            case 2:
+                if (p < 2) {
+                    /* LD (BC),A, LD (DE),A, LD A,(BC), LD A,(DE) */
+                    _z80_jit_ldw(a, ECX, rp[p]);
+                    _z80_jit_page(a, RSI, ECX, q == 0, code_page, pc);
+                    _z80_jit_count(a, 7);
+                    if (q == 0) {
+                        _z80_jit_ldb(a, EDX, A);
+                        _z80_jit_2(a, 0x88, 0x16);              /* mov [rsi], dl */
+                        _z80_jit_data(a, _Z80_JIT_DL);
+                    }
+                    else {
+                        _z80_jit_3(a, 0x0F, 0xB6, 0x06);        /* movzx eax, byte [rsi] */
+                        _z80_jit_stb(a, _Z80_JIT_AL, A);
+                    }
+                    _z80_jit_addr(a, ECX);
+                    _z80_jit_3(a, 0x8D, 0x41, 0x01);            /* lea eax, [rcx+1] */
+                    if (q == 0) {
+                        _z80_jit_2(a, 0x88, 0xD4);              /* mov ah, dl */
+                        _z80_jit_stw(a, EAX, WZ);
+                        _z80_jit_gen(a, ECX);
+                    }
+                    else {
+                        _z80_jit_stw(a, EAX, WZ);
+                    }
+                    return 7;
+                }
+                else if (p == 2) {
+                    /* LD (nn),HL, LD HL,(nn) */
+                    _z80_jit_movi(a, ECX, nn);
+                    _z80_jit_page(a, RSI, ECX, q == 0, code_page, pc);
+                    _z80_jit_movi(a, EDX, (uint16_t)(nn+1));
+                    _z80_jit_page(a, RDI, EDX, q == 0, code_page, pc);
+                    _z80_jit_count(a, 16);
+                    if (q == 0) {
+                        _z80_jit_ldb(a, EAX, _Z80_JIT_WS(_L));
+                        _z80_jit_2(a, 0x88, 0x06);              /* mov [rsi], al */
+                        _z80_jit_ldb(a, EAX, _Z80_JIT_WS(_H));
+                        _z80_jit_2(a, 0x88, 0x07);              /* mov [rdi], al */
+                        _z80_jit_data(a, _Z80_JIT_AL);
+                        _z80_jit_gen(a, ECX);
+                        _z80_jit_gen(a, EDX);
+                    }
+                    else {
+                        _z80_jit_3(a, 0x0F, 0xB6, 0x06);        /* movzx eax, byte [rsi] */
+                        _z80_jit_stb(a, _Z80_JIT_AL, _Z80_JIT_WS(_L));
+                        _z80_jit_3(a, 0x0F, 0xB6, 0x07);        /* movzx eax, byte [rdi] */
+                        _z80_jit_stb(a, _Z80_JIT_AL, _Z80_JIT_WS(_H));
+                    }
+                    _z80_jit_addr(a, EDX);
+                    _z80_jit_stwi(a, WZ, (uint16_t)(nn+1));
+                    return 16;
+                }
+                else {
+                    /* LD (nn),A, LD A,(nn) */
+                    _z80_jit_movi(a, ECX, nn);
+                    _z80_jit_page(a, RSI, ECX, q == 0, code_page, pc);
+                    _z80_jit_count(a, 13);
+                    _z80_jit_addr(a, ECX);
+                    if (q == 0) {
+                        _z80_jit_ldb(a, EAX, A);
+                        _z80_jit_2(a, 0x88, 0x06);              /* mov [rsi], al */
+                        _z80_jit_data(a, _Z80_JIT_AL);
+                        _z80_jit_2(a, 0x88, 0xC4);              /* mov ah, al */
+                        _z80_jit_2(a, 0xB0, (uint8_t)(nn+1));   /* mov al, lo(nn+1) */
+                        _z80_jit_stw(a, EAX, WZ);
+                        _z80_jit_gen(a, ECX);
+                    }
+                    else {
+                        _z80_jit_3(a, 0x0F, 0xB6, 0x06);        /* movzx eax, byte [rsi] */
+                        _z80_jit_stb(a, _Z80_JIT_AL, A);
+                        _z80_jit_stwi(a, WZ, (uint16_t)(nn+1));
+                    }
+                    return 13;
+                }
+            case 3:
+                /* INC rr, DEC rr */
+                _z80_jit_count(a, 6);
+                _z80_jit_4(a, 0x66, 0xFF, q ? 0x4B : 0x43, rp[p]);     /* inc/dec word [rr] */
+                _z80_jit_addri(a, pc);
+                return 6;
+            case 4:
+            case 5:
+                /* INC r, DEC r, INC (HL), DEC (HL) */
+                if (y == 6) {
+                    _z80_jit_ldw(a, ECX, HL);
+                    _z80_jit_page(a, RSI, ECX, false, code_page, pc);
+                    _z80_jit_page(a, RDI, ECX, true, code_page, pc);
+                    _z80_jit_count(a, 11);
+                    _z80_jit_3(a, 0x0F, 0xB6, 0x16);            /* movzx edx, byte [rsi] */
+                    _z80_jit_incdec(a, z == 5);
+                    _z80_jit_2(a, 0x88, 0x17);                  /* mov [rdi], dl */
+                    _z80_jit_addr(a, ECX);
+                    _z80_jit_data(a, _Z80_JIT_DL);
+                    _z80_jit_gen(a, ECX);
+                    return 11;
+                }
+                _z80_jit_count(a, 4);
+                _z80_jit_ldb(a, EDX, r8[y]);
+                _z80_jit_incdec(a, z == 5);
+                _z80_jit_stb(a, _Z80_JIT_DL, r8[y]);
+                _z80_jit_addri(a, pc);
+                return 4;
+            case 6:
+                if (y == 6) {
+                    /* LD (HL),n */
+                    _z80_jit_ldw(a, ECX, HL);
+                    _z80_jit_page(a, RSI, ECX, true, code_page, pc);
+                    _z80_jit_count(a, 10);
+                    _z80_jit_3(a, 0xC6, 0x06, n);               /* mov byte [rsi], n */
+                    _z80_jit_addr(a, ECX);
+                    _z80_jit_stbi(a, _Z80_JIT_PINS+2, n);
+                    _z80_jit_gen(a, ECX);
+                    return 10;
+                }
+                /* LD r,n */
+                _z80_jit_count(a, 7);
+                _z80_jit_stbi(a, r8[y], n);
+                _z80_jit_addri(a, pc+1);
+                return 7;
+            case 7:
+                _z80_jit_count(a, 4);
+                _z80_jit_ldb(a, EAX, A);
+                if (y < 4) {
+                    /* RLCA, RRCA, RLA, RRA */
+                    if (y >= 2) {
+                        _z80_jit_4(a, 0x0F, 0xBA, 0x63, _Z80_JIT_WS(_F)); _z80_jit_1(a, 0);   /* bt dword [F], 0 */
+                    }
+                    _z80_jit_2(a, 0xD0, 0xC0|(y<<3));           /* rol/ror/rcl/rcr al, 1 */
+                    _z80_jit_3(a, 0x0F, 0x92, 0xC2);            /* setc dl */
+                    _z80_jit_stb(a, _Z80_JIT_AL, A);
+                    _z80_jit_accf(a, Z80_SF|Z80_ZF|Z80_PF);
+                }
+                else if (y == 5) {
+                    /* CPL */
+                    _z80_jit_2(a, 0xF6, 0xD0);                  /* not al */
+                    _z80_jit_stb(a, _Z80_JIT_AL, A);
+                    _z80_jit_2(a, 0xB2, Z80_HF|Z80_NF);         /* mov dl, H|N */
+                    _z80_jit_accf(a, Z80_SF|Z80_ZF|Z80_PF|Z80_CF);
+                }
+                else if (y == 6) {
+                    /* SCF */
+                    _z80_jit_2(a, 0xB2, Z80_CF);                /* mov dl, C */
+                    _z80_jit_accf(a, Z80_SF|Z80_ZF|Z80_PF);
+                }
+                else if (y == 7) {
+                    /* CCF: H is the old C, C is inverted */
+                    _z80_jit_3(a, 0x8A, 0x53, _Z80_JIT_WS(_F)); /* mov dl, [F] */
+                    _z80_jit_3(a, 0x80, 0xE2, Z80_CF);          /* and dl, C */
+                    _z80_jit_3(a, 0xC0, 0xE2, 4);               /* shl dl, 4 */
+                    _z80_jit_accf(a, Z80_SF|Z80_ZF|Z80_PF|Z80_CF);
+                    _z80_jit_4(a, 0x80, 0x73, _Z80_JIT_WS(_F), Z80_CF);   /* xor byte [F], C */
+                }
+                else {
+                    /* DAA */
+                    return 0;
+                }
+                _z80_jit_addri(a, pc);
+                return 4;
+        }
+    }
+    /* x == 3 */
+    switch (z) {
+        case 0:
+            /* RET cc */
+            {
+                const int skip = _z80_jit_cond(a, y);
+                _z80_jit_pop_pages(a, code_page, pc);
+                _z80_jit_count(a, 11);
+                _z80_jit_ret(a);
+                const int done = _z80_jit_fwd(a, 0xF);
+                _z80_jit_land(a, skip);
+                _z80_jit_count(a, 5);
+                _z80_jit_stwi(a, PC, next);
+                _z80_jit_addri(a, pc);
+                _z80_jit_land(a, done);
+                *end = true;
+                return 11;
+            }
+        case 1:
+            if (q == 0) {
+                /* POP rr, the first byte goes to F for POP AF */
+                static const int8_t lo[4] = { _Z80_JIT_WS(_C), _Z80_JIT_WS(_E), _Z80_JIT_WS(_L), _Z80_JIT_WS(_F) };
+                static const int8_t hi[4] = { _Z80_JIT_WS(_B), _Z80_JIT_WS(_D), _Z80_JIT_WS(_H), _Z80_JIT_WS(_A) };
+                _z80_jit_pop_pages(a, code_page, pc);
+                _z80_jit_count(a, 10);
+                _z80_jit_3(a, 0x0F, 0xB6, 0x06);                /* movzx eax, byte [rsi] */
+                _z80_jit_stb(a, _Z80_JIT_AL, lo[p]);
+                _z80_jit_3(a, 0x0F, 0xB6, 0x07);                /* movzx eax, byte [rdi] */
+                _z80_jit_stb(a, _Z80_JIT_AL, hi[p]);
+                _z80_jit_addr(a, EDX);
+                _z80_jit_3(a, 0x66, 0xFF, 0xC2);                /* inc dx */
+                _z80_jit_stw(a, EDX, _Z80_JIT_R1(_SP));
+                return 10;
+            }
+            switch (p) {
+                case 0:
+                    /* RET */
+                    _z80_jit_pop_pages(a, code_page, pc);
+                    _z80_jit_count(a, 10);
+                    _z80_jit_ret(a);
+                    *end = true;
+                    return 10;
+                case 1:
+                    /* EXX: swap BC, DE, HL with the shadow registers */
+                    _z80_jit_count(a, 4);
+                    _z80_jit_4(a, 0x48, 0x8B, 0x43, _Z80_JIT_WS(0));        /* mov rax, [ws] */
+                    _z80_jit_4(a, 0x48, 0x8B, 0x53, _Z80_JIT_R3);           /* mov rdx, [r3] */
+                    _z80_jit_3(a, 0x48, 0x89, 0xC1);                        /* mov rcx, rax */
+                    _z80_jit_3(a, 0x48, 0x31, 0xD1);                        /* xor rcx, rdx */
+                    _z80_jit_3(a, 0x48, 0x81, 0xE1); _z80_jit_32(a, 0xFFFF0000);   /* and rcx, ~0xFFFF */
+                    _z80_jit_3(a, 0x48, 0x31, 0xC8);                        /* xor rax, rcx */
+                    _z80_jit_3(a, 0x48, 0x31, 0xCA);                        /* xor rdx, rcx */
+                    _z80_jit_4(a, 0x48, 0x89, 0x43, _Z80_JIT_WS(0));        /* mov [ws], rax */
+                    _z80_jit_4(a, 0x48, 0x89, 0x53, _Z80_JIT_R3);           /* mov [r3], rdx */
+                    _z80_jit_addri(a, pc);
+                    return 4;
+                case 2:
+                    /* JP (HL) */
+                    _z80_jit_count(a, 4);
+                    _z80_jit_ldw(a, EAX, HL);
+                    _z80_jit_stw(a, EAX, PC);
+                    _z80_jit_addri(a, pc);
+                    *end = true;
+                    return 4;
+                default:
+                    /* LD SP,HL */
+                    _z80_jit_count(a, 6);
+                    _z80_jit_ldw(a, EAX, HL);
+                    _z80_jit_stw(a, EAX, _Z80_JIT_R1(_SP));
+                    _z80_jit_addri(a, pc);
+                    return 6;
+            }
+        case 2:
+            /* JP cc,nn */
+            {
+                _z80_jit_count(a, 10);
+                _z80_jit_stwi(a, WZ, nn);
+                _z80_jit_addri(a, pc+2);
+                const int skip = _z80_jit_cond(a, y);
+                _z80_jit_stwi(a, PC, nn);
+                const int done = _z80_jit_fwd(a, 0xF);
+                _z80_jit_land(a, skip);
+                _z80_jit_stwi(a, PC, next);
+                _z80_jit_land(a, done);
+                *end = true;
+                return 10;
+            }
+        case 3:
+            if (y == 0) {
+                /* JP nn */
+                _z80_jit_count(a, 10);
+                _z80_jit_stwi(a, PC, nn);
+                _z80_jit_stwi(a, WZ, nn);
+                _z80_jit_addri(a, pc+2);
+                *end = true;
+                return 10;
+            }
+            else if (y == 5) {
+                /* EX DE,HL */
+                _z80_jit_count(a, 4);
+                _z80_jit_ldw(a, EAX, _Z80_JIT_WS(_DE));
+                _z80_jit_ldw(a, EDX, HL);
+                _z80_jit_stw(a, EDX, _Z80_JIT_WS(_DE));
+                _z80_jit_stw(a, EAX, HL);
+                _z80_jit_addri(a, pc);
+                return 4;
+            }
+            /* CB prefix, OUT (n),A, IN A,(n), EX (SP),HL, DI, EI */
+            return 0;
+        case 4:
+            /* CALL cc,nn */
+            {
+                const int skip = _z80_jit_cond(a, y);
+                _z80_jit_push_pages(a, code_page, pc);
+                _z80_jit_count(a, 17);
+                _z80_jit_push_imm(a, next);
+                _z80_jit_stwi(a, PC, nn);
+                const int done = _z80_jit_fwd(a, 0xF);
+                _z80_jit_land(a, skip);
+                _z80_jit_count(a, 10);
+                _z80_jit_stwi(a, PC, next);
+                _z80_jit_addri(a, pc+2);
+                _z80_jit_land(a, done);
+                _z80_jit_stwi(a, WZ, nn);
+                *end = true;
+                return 17;
+            }
+        case 5:
+            if (q == 0) {
+                /* PUSH rr, the high byte is A for PUSH AF */
+                static const int8_t hi[4] = { _Z80_JIT_WS(_B), _Z80_JIT_WS(_D), _Z80_JIT_WS(_H), _Z80_JIT_WS(_A) };
+                static const int8_t lo[4] = { _Z80_JIT_WS(_C), _Z80_JIT_WS(_E), _Z80_JIT_WS(_L), _Z80_JIT_WS(_F) };
+                _z80_jit_push_pages(a, code_page, pc);
+                _z80_jit_count(a, 11);
+                _z80_jit_ldb(a, EAX, hi[p]);
+                _z80_jit_2(a, 0x88, 0x06);                      /* mov [rsi], al */
+                _z80_jit_ldb(a, EAX, lo[p]);
+                _z80_jit_2(a, 0x88, 0x07);                      /* mov [rdi], al */
+                _z80_jit_stw(a, EDX, _Z80_JIT_R1(_SP));
+                _z80_jit_addr(a, EDX);
+                _z80_jit_data(a, _Z80_JIT_AL);
+                _z80_jit_gen(a, ECX);
+                _z80_jit_gen(a, EDX);
+                return 11;
+            }
+            else if (p == 0) {
+                /* CALL nn */
+                _z80_jit_push_pages(a, code_page, pc);
+                _z80_jit_count(a, 17);
+                _z80_jit_push_imm(a, next);
+                _z80_jit_stwi(a, PC, nn);
+                _z80_jit_stwi(a, WZ, nn);
+                *end = true;
+                return 17;
+            }
+            /* DD, ED, FD prefixes */
+            return 0;
+        case 6:
+            /* ALU n */
+            _z80_jit_count(a, 7);
+            _z80_jit_movi(a, EDX, n);
+            _z80_jit_addri(a, pc+1);
+            _z80_jit_alu(a, y);
+            return 7;
+        default:
+            /* RST */
+            _z80_jit_push_pages(a, code_page, pc);
+            _z80_jit_count(a, 11);
+            _z80_jit_push_imm(a, next);
+            _z80_jit_stwi(a, PC, (uint16_t)(y*8));
+            _z80_jit_stwi(a, WZ, (uint16_t)(y*8));
+            *end = true;
+            return 11;
+    }
+}
+
+/* called from the native code after each instruction if a trap callback is set */
+static int _z80_jit_call_trap(_z80_jit_ctx_t* ctx, uint32_t ticks) {
+    ctx->trap_id = ctx->trap(ctx->pc, (int)(ctx->ticks + ticks), ctx->pins, ctx->trap_user_data);
+    return ctx->trap_id;
+}
+
+/* forget all native code */
+static void _z80_jit_flush(z80_blocks_t* blocks) {
+    for (int i = 0; i < blocks->num_blocks; i++) {
+        blocks->block[i].native = 0;
+    }
+    blocks->jit_used = 16;
+}
+
+/* translate the block at pc into native code, up to the first instruction that stays in the interpreter */
+static void _z80_jit_translate(z80_blocks_t* blocks, z80_block_t* blk, uint16_t pc) {
+    if ((blocks->jit_used + _Z80_JIT_MAX_CODE) > Z80_JIT_CODE_SIZE) {
+        _z80_jit_flush(blocks);
+    }
+    blk->native = -1;
+    blk->native_ops = 0;
+    blk->native_ticks = 0;
+    if (blk->num_decodes > _Z80_JIT_MAX_DECODES) {
+        return;
+    }
+    _z80_jit_asm_t a;
+    a.buf = blocks->jit_code + blocks->jit_used;
+    a.pos = 0;
+    a.num_fixups = 0;
+    /* push rbx, rbp, r12..r15, align the stack, and load the context registers */
+    _z80_jit_2(&a, 0x53, 0x55);
+    _z80_jit_4(&a, 0x41, 0x54, 0x41, 0x55);
+    _z80_jit_4(&a, 0x41, 0x56, 0x41, 0x57);
+    _z80_jit_4(&a, 0x48, 0x83, 0xEC, 0x08);                     /* sub rsp, 8 */
+    _z80_jit_3(&a, 0x48, 0x89, 0xFB);                           /* mov rbx, rdi */
+    _z80_jit_4(&a, 0x4C, 0x8B, 0x73, (uint8_t)offsetof(_z80_jit_ctx_t, pages));    /* mov r14, [pages] */
+    _z80_jit_4(&a, 0x4C, 0x8B, 0x7B, (uint8_t)offsetof(_z80_jit_ctx_t, gen));      /* mov r15, [gen] */
+    _z80_jit_2(&a, 0x48, 0xBD); _z80_jit_64(&a, (uint64_t)(uintptr_t)_z80_szp);     /* mov rbp, _z80_szp */
+    _z80_jit_3(&a, 0x45, 0x31, 0xE4);                           /* xor r12d, r12d */
+    _z80_jit_3(&a, 0x45, 0x31, 0xED);                           /* xor r13d, r13d */
+    const int body = a.pos;
+    const uint16_t start_pc = pc;
+
+    const int code_page = pc >> Z80_PAGE_SHIFT;
+    int pos = 0;
+    int ticks = 0;
+    int num_ops = 0;
+    bool end = false;
+    while (!end && (pos < blk->num_bytes)) {
+        const uint8_t* b = &blk->bytes[pos];
+        const int len = 1 + _z80_imm_bytes(b[0]);
+        if (((pos + len) > blk->num_bytes) || ((((pc + len - 1) & 0xFFFF) >> Z80_PAGE_SHIFT) != code_page)) {
+            /* writes are only checked against the block's first page */
+            break;
+        }
+        const uint16_t next = (uint16_t)(pc + len);
+        const int op_ticks = _z80_jit_op(&a, b, pc, next, code_page, &end);
+        if (0 == op_ticks) {
+            break;
+        }
+        /* the trap callback, with the pc after the instruction */
+        _z80_jit_4(&a, 0x48, 0x83, 0x7B, (uint8_t)offsetof(_z80_jit_ctx_t, trap)); _z80_jit_1(&a, 0);  /* cmp qword [trap], 0 */
+        _z80_jit_2(&a, 0x74, 0);                                /* je skip */
+        const int skip = a.pos;
+        if (!end) {
+            _z80_jit_stwi(&a, _Z80_JIT_PC, next);
+        }
+        _z80_jit_3(&a, 0x48, 0x89, 0xDF);                       /* mov rdi, rbx */
+        _z80_jit_3(&a, 0x44, 0x89, 0xE6);                       /* mov esi, r12d */
+        _z80_jit_2(&a, 0x48, 0xB8); _z80_jit_64(&a, (uint64_t)(uintptr_t)_z80_jit_call_trap);    /* mov rax, _z80_jit_call_trap */
+        _z80_jit_2(&a, 0xFF, 0xD0);                             /* call rax */
+        _z80_jit_2(&a, 0x85, 0xC0);                             /* test eax, eax */
+        _z80_jit_exit(&a, 0x5, -1);
+        a.buf[skip-1] = (uint8_t)(a.pos - skip);
+        if (end) {
+            /* run again from the start of the block, like the interpreter would */
+            _z80_jit_4(&a, 0x66, 0x81, 0x7B, _Z80_JIT_PC);      /* cmp word [pc], start_pc */
+            _z80_jit_2(&a, (uint8_t)start_pc, (uint8_t)(start_pc>>8));
+            const int other = _z80_jit_fwd(&a, 0x5);
+            _z80_jit_4(&a, 0x44, 0x3B, 0x63, (uint8_t)offsetof(_z80_jit_ctx_t, loop_ticks));  /* cmp r12d, [loop_ticks] */
+            _z80_jit_2(&a, 0x0F, 0x8E); _z80_jit_32(&a, (uint32_t)(body - (a.pos + 4)));    /* jle body */
+            _z80_jit_land(&a, other);
+        }
+        pos += len;
+        pc = next;
+        ticks += op_ticks;
+        num_ops++;
+    }
+    if (0 == num_ops) {
+        return;
+    }
+    if (!end) {
+        _z80_jit_stwi(&a, _Z80_JIT_PC, pc);
+    }
+    /* epilogue: store the executed ticks and instructions, and return */
+    const int epilogue = a.pos;
+    _z80_jit_4(&a, 0x44, 0x89, 0x63, (uint8_t)offsetof(_z80_jit_ctx_t, num_ticks));  /* mov [num_ticks], r12d */
+    _z80_jit_4(&a, 0x44, 0x89, 0x6B, (uint8_t)offsetof(_z80_jit_ctx_t, num_ops));    /* mov [num_ops], r13d */
+    _z80_jit_4(&a, 0x48, 0x83, 0xC4, 0x08);                     /* add rsp, 8 */
+    _z80_jit_4(&a, 0x41, 0x5F, 0x41, 0x5E);
+    _z80_jit_4(&a, 0x41, 0x5D, 0x41, 0x5C);
+    _z80_jit_3(&a, 0x5D, 0x5B, 0xC3);
+    /* the exits, which store the pc of the instruction that continues in the interpreter */
+    int exits[Z80_BLOCK_MAX_BYTES+1];
+    int exit_pcs[Z80_BLOCK_MAX_BYTES+1];
+    int num_exits = 0;
+    for (int i = 0; i < a.num_fixups; i++) {
+        int target = epilogue;
+        if (a.fixups[i].pc >= 0) {
+            int e = 0;
+            while ((e < num_exits) && (exit_pcs[e] != a.fixups[i].pc)) {
+                e++;
+            }
+            if (e == num_exits) {
+                CHIPS_ASSERT(num_exits <= Z80_BLOCK_MAX_BYTES);
+                exit_pcs[e] = a.fixups[i].pc;
+                exits[e] = a.pos;
+                num_exits++;
+                _z80_jit_stwi(&a, _Z80_JIT_PC, (uint16_t)a.fixups[i].pc);
+                _z80_jit_1(&a, 0xE9); _z80_jit_32(&a, (uint32_t)(epilogue - (a.pos + 4)));   /* jmp epilogue */
+            }
+            target = exits[e];
+        }
+        const uint32_t rel = (uint32_t)(target - (a.fixups[i].pos + 4));
+        memcpy(&a.buf[a.fixups[i].pos], &rel, 4);
+    }
+    CHIPS_ASSERT(a.pos <= _Z80_JIT_MAX_CODE);
+    blk->native = blocks->jit_used;
+    blk->native_ops = (uint8_t) num_ops;
+    blk->native_ticks = (uint16_t) ticks;
+    blocks->jit_used += (a.pos + 15) & ~15;
+}
+
+/* memory of the interpreter run in the conformance mode: reads come from the fast path pages, writes are only logged */
+typedef struct {
+    const z80_page_t* pages;
+    bool fault;                 /* the access needed the system's tick callback */
+    int num_writes;
+    uint8_t* write_ptr[_Z80_JIT_MAX_WRITES];
+    uint8_t write_data[_Z80_JIT_MAX_WRITES];
+} _z80_jit_ref_t;
+
+static uint64_t _z80_jit_ref_tick(int num_ticks, uint64_t pins, void* user_data) {
+    (void)num_ticks;
+    _z80_jit_ref_t* ref = (_z80_jit_ref_t*) user_data;
+    if (pins & Z80_MREQ) {
+        const uint16_t addr = Z80_GET_ADDR(pins);
+        const z80_page_t* page = &ref->pages[addr >> Z80_PAGE_SHIFT];
+        if (pins & Z80_RD) {
+            if (page->read_ptr) {
+                const uint8_t* ptr = page->read_ptr + (addr & (Z80_PAGE_SIZE-1));
+                uint8_t data = *ptr;
+                for (int i = 0; i < ref->num_writes; i++) {
+                    if (ref->write_ptr[i] == ptr) {
+                        data = ref->write_data[i];
+                    }
+                }
+                Z80_SET_DATA(pins, data);
+            }
+            else {
+                ref->fault = true;
+            }
+        }
+        else if (pins & Z80_WR) {
+            if (page->write_ptr && (ref->num_writes < _Z80_JIT_MAX_WRITES)) {
+                ref->write_ptr[ref->num_writes] = page->write_ptr + (addr & (Z80_PAGE_SIZE-1));
+                ref->write_data[ref->num_writes] = Z80_GET_DATA(pins);
+                ref->num_writes++;
+            }
+            else {
+                ref->fault = true;
+            }
+        }
+    }
+    else if (pins & Z80_IORQ) {
+        ref->fault = true;
+    }
+    return pins;
+}
+
+/* compare the native code of a block with the interpreter on a copy of the CPU, the interpreter runs
+   first and only logs its writes, reading memory through them
+*/
+static void _z80_jit_verify(z80_blocks_t* blocks, z80_block_t* blk, uint64_t r2, _z80_jit_ctx_t* ctx) {
+    const uint16_t pc = ctx->pc;
+    _z80_jit_ref_t mem;
+    memset(&mem, 0, sizeof(mem));
+    mem.pages = ctx->pages;
+    z80_t ref;
+    memset(&ref, 0, sizeof(ref));
+    ref.tick_cb = _z80_jit_ref_tick;
+    ref.user_data = &mem;
+    ref.bc_de_hl_fa = ctx->ws;
+    ref.wz_ix_iy_sp = ctx->r1;
+    ref.bc_de_hl_fa_ = ctx->r3;
+    ref.im_ir_pc_bits = r2;
+    ref.pins = ctx->pins;
+    z80_set_pc(&ref, pc);
+    struct {
+        uint64_t ws, r1, r3;
+        uint16_t pc, addr;
+        uint32_t ticks;
+        int num_writes;
+    } steps[_Z80_JIT_MAX_STEPS];
+    /* the native code runs at most native_ops instructions, or up to loop_ticks plus one more round,
+       which are at most _Z80_JIT_MAX_STEPS instructions of 4 or more ticks
+    */
+    if (ctx->loop_ticks > (4*_Z80_JIT_MAX_STEPS - blk->native_ticks)) {
+        ctx->loop_ticks = 4*_Z80_JIT_MAX_STEPS - blk->native_ticks;
+    }
+    const int32_t max_ticks = ctx->loop_ticks + blk->native_ticks;
+    uint32_t ticks = 0;
+    int num_steps = 0;
+    while (((num_steps < blk->native_ops) || ((int32_t)ticks < max_ticks)) && (num_steps < _Z80_JIT_MAX_STEPS) && !mem.fault) {
+        ticks += z80_exec(&ref, 1);
+        steps[num_steps].ws = ref.bc_de_hl_fa;
+        steps[num_steps].r1 = ref.wz_ix_iy_sp;
+        steps[num_steps].r3 = ref.bc_de_hl_fa_;
+        steps[num_steps].pc = z80_pc(&ref);
+        steps[num_steps].addr = Z80_GET_ADDR(ref.pins);
+        steps[num_steps].ticks = ticks;
+        steps[num_steps].num_writes = mem.num_writes;
+        num_steps++;
+    }
+    /* a step that needed the tick callback doesn't count */
+    if (mem.fault) {
+        num_steps--;
+    }
+    ((void(*)(_z80_jit_ctx_t*)) (blocks->jit_code + blk->native))(ctx);
+    if (0 == ctx->num_ops) {
+        return;
+    }
+    bool ok = (int)ctx->num_ops <= num_steps;
+    if (ok) {
+        const int i = ctx->num_ops - 1;
+        ok = (steps[i].ws == ctx->ws) && (steps[i].r1 == ctx->r1) && (steps[i].r3 == ctx->r3) &&
+             (steps[i].pc == ctx->pc) && (steps[i].addr == Z80_GET_ADDR(ctx->pins)) &&
+             (steps[i].ticks == ctx->num_ticks);
+        /* the last logged write to each address must be in memory */
+        for (int w = 0; ok && (w < steps[i].num_writes); w++) {
+            bool last = true;
+            for (int l = w + 1; l < steps[i].num_writes; l++) {
+                if (mem.write_ptr[l] == mem.write_ptr[w]) {
+                    last = false;
+                }
+            }
+            ok = !last || (*mem.write_ptr[w] == mem.write_data[w]);
+        }
+    }
+    if (!ok) {
+        if (0 == blocks->jit_mismatches) {
+            blocks->jit_mismatch_pc = pc;
+        }
+        blocks->jit_mismatches++;
+    }
+    blocks->jit_checked++;
+}
+
+/* run the native code of a block, translated on the first run, returns false if it didn't execute any
+   instruction or might run past max_ticks, fast is the number of ticks left on the fast path
+*/
+static bool _z80_jit_run(z80_blocks_t* blocks, z80_block_t* blk, uint64_t r2, uint32_t max_ticks, int fast, _z80_jit_ctx_t* ctx) {
+    if (0 == blk->native) {
+        _z80_jit_translate(blocks, blk, ctx->pc);
+    }
+    if ((blk->native < 0) || (blk->native_ticks > max_ticks)) {
+        return false;
+    }
+    /* looping needs the ticks for another round, and the fast path checks of _z80_exec() entering the block */
+    ctx->loop_ticks = (int32_t)(max_ticks - blk->native_ticks);
+    const int fast_loop = fast - ((blk->ticks > 23) ? blk->ticks : 23) - 1;
+    if (fast_loop < ctx->loop_ticks) {
+        ctx->loop_ticks = fast_loop;
+    }
+    if (blocks->jit_verify) {
+        _z80_jit_verify(blocks, blk, r2, ctx);
+    }
+    else {
+        ((void(*)(_z80_jit_ctx_t*)) (blocks->jit_code + blk->native))(ctx);
+    }
+    return ctx->num_ops > 0;
+}
+
+#undef _Z80_JIT_WS
+#undef _Z80_JIT_R1
+#undef _Z80_JIT_R3
+#undef _Z80_JIT_PINS
+#undef _Z80_JIT_PC
+#undef _Z80_JIT_MAX_CODE
+#undef _Z80_JIT_MAX_FIXUPS
+#undef _Z80_JIT_MAX_DECODES
+#undef _Z80_JIT_MAX_STEPS
+#undef _Z80_JIT_MAX_WRITES
+#endif /* _Z80_JIT */
+
+bool z80_set_jit(z80_t* cpu, bool enabled, bool verify) {
+    CHIPS_ASSERT(cpu);
+    z80_blocks_t* blocks = cpu->blocks;
+    #if defined(_Z80_JIT)
+    if (!blocks) {
+        return !enabled;
+    }
+    if (enabled && !blocks->jit_code) {
+        void* code = mmap(0, Z80_JIT_CODE_SIZE, PROT_READ|PROT_WRITE|PROT_EXEC, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (code == MAP_FAILED) {
+            return false;
+        }
+        blocks->jit_code = (uint8_t*) code;
+    }
+    else if (!enabled && blocks->jit_code) {
+        munmap(blocks->jit_code, Z80_JIT_CODE_SIZE);
+        blocks->jit_code = 0;
+    }
+    blocks->jit_verify = enabled && verify;
+    blocks->jit_checked = 0;
+    blocks->jit_mismatches = 0;
+    blocks->jit_mismatch_pc = 0;
+    _z80_jit_flush(blocks);
+    return true;
+    #else
+    (void)blocks; (void)verify;
+    return !enabled;
+    #endif
+}
+
+#if defined(__GNUC__)
+    #define _Z80_FORCE_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+    #define _Z80_FORCE_INLINE static __forceinline
+#else
+    #define _Z80_FORCE_INLINE static inline
+#endif
+
+/* instruction decoder, 'blocks' is the predecoded block cache or a constant 0 */
+_Z80_FORCE_INLINE uint32_t _z80_exec(z80_t* cpu, uint32_t num_ticks, z80_blocks_t* blocks) {
     cpu->trap_id = 0;
     uint64_t r0 = cpu->bc_de_hl_fa;
     uint64_t r1 = cpu->wz_ix_iy_sp;
@@ -835,12 +2299,60 @@ uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
     const z80_tick_t tick = cpu->tick_cb;
     const z80_trap_t trap = cpu->trap_cb;
     void* ud = cpu->user_data;
+    const z80_page_t* pages = cpu->pages ? cpu->pages : _z80_no_pages;
+    int pend = 0;   /* ticks skipped on the fast path, not yet seen by the tick callback */
+    uint32_t m1 = 0;    /* M1 cycles not yet added to the R register */
+    const uint8_t* code = 0;    /* next byte of the current predecoded block */
+    int code_left = 0;          /* bytes left in the current predecoded block */
     uint32_t ticks = 0;
     uint8_t op = 0, d8 = 0;
     uint16_t addr = 0, d16 = 0;
     uint16_t pc = _G_PC();
     uint64_t pre_pins = pins;
     do {
+        /* enter the predecoded block at pc if the fast path covers all its ticks */
+        if (blocks && (0 == code_left) && (0 == map_bits) && _FAST(23)) {
+            z80_block_t* blk = _z80_enter_block(blocks, pages, pc, cpu->fast_ticks - pend);
+            if (blk) {
+                #if defined(_Z80_JIT)
+                /* or run its native code, unless an interrupt or EI delay is pending */
+                if (blocks->jit_code && (blk->native >= 0) && (0 == (r2 & (_BITS_USE_IXIY|_BIT_EI))) && (0 == (pins & Z80_INT))) {
+                    _z80_jit_ctx_t ctx;
+                    ctx.ws = ws;
+                    ctx.r1 = r1;
+                    ctx.r3 = r3;
+                    ctx.pins = pins;
+                    ctx.pages = pages;
+                    ctx.gen = blocks->gen;
+                    ctx.trap = trap;
+                    ctx.trap_user_data = cpu->trap_user_data;
+                    ctx.ticks = ticks;
+                    ctx.trap_id = 0;
+                    ctx.num_ticks = 0;
+                    ctx.num_ops = 0;
+                    ctx.pc = pc;
+                    if (_z80_jit_run(blocks, blk, r2, num_ticks - ticks, cpu->fast_ticks - pend, &ctx)) {
+                        ws = r0 = ctx.ws;
+                        r1 = ctx.r1;
+                        r3 = ctx.r3;
+                        pins = ctx.pins;
+                        pc = ctx.pc;
+                        ticks += ctx.num_ticks;
+                        pend += ctx.num_ticks;
+                        m1 += ctx.num_ops;
+                        pre_pins = pins;
+                        if (ctx.trap_id) {
+                            cpu->trap_id = ctx.trap_id;
+                            break;
+                        }
+                        continue;
+                    }
+                }
+                #endif
+                code = blk->bytes;
+                code_left = blk->num_bytes;
+            }
+        }
         /* fetch next opcode byte */
         _FETCH(op)
         /* special case ED-prefixed instruction: cancel effect of DD/FD prefix */
@@ -1199,7 +2711,7 @@ uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
                     case 0x4c:/*NEG*/d8=_G_A();_S_A(0);{uint8_t acc=_G_A();uint32_t res=(uint32_t)((int)acc-(int)d8);_S_F(_SUB_FLAGS(acc,d8,res));_S_A(res);}break;
                     case 0x4d:/*RETI*/pins|=Z80_RETI;d16=_G_SP();_MR(d16++,d8);pc=d8;_MR(d16++,d8);pc|=d8<<8;_S_SP(d16);_S_WZ(pc);if (r2&_BIT_IFF2){r2|=_BIT_IFF1;}else{r2&=~_BIT_IFF1;}break;
                     case 0x4e:/*IM 0*/_S_IM(0);break;
-                    case 0x4f:/*LD R,A*/_T(1);_S_R(_G_A());break;
+                    case 0x4f:/*LD R,A*/_T(1);m1=0;_S_R(_G_A());break;
                     case 0x50:/*IN D,(C)*/{addr=_G_BC();_IN(addr++,d8);_S_WZ(addr);uint8_t f=(_G_F()&Z80_CF)|_z80_szp[d8];_S8(ws,_F,f);_S_D(d8);}break;
                     case 0x51:/*OUT (C),D*/addr=_G_BC();_OUT(addr++,_G_D());_S_WZ(addr);break;
                     case 0x52:/*SBC HL,DE*/{uint16_t acc=_G_HL();_S_WZ(acc+1);d16=_G_DE();uint32_t r=acc-d16-(_G_F()&Z80_CF);uint8_t f=Z80_NF|(((d16^acc)&(acc^r)&0x8000)>>13);_S_HL(r);f|=((acc^r^d16)>>8) & Z80_HF;f|=(r>>16)&Z80_CF;f|=(r>>8)&(Z80_SF|Z80_YF|Z80_XF);f|=(r&0xFFFF)?0:Z80_ZF;_S_F(f);_T(7);}break;
@@ -1215,7 +2727,7 @@ uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
                     case 0x5c:/*NEG*/d8=_G_A();_S_A(0);{uint8_t acc=_G_A();uint32_t res=(uint32_t)((int)acc-(int)d8);_S_F(_SUB_FLAGS(acc,d8,res));_S_A(res);}break;
                     case 0x5d:/*RETN*/pins|=Z80_RETI;d16=_G_SP();_MR(d16++,d8);pc=d8;_MR(d16++,d8);pc|=d8<<8;_S_SP(d16);_S_WZ(pc);if (r2&_BIT_IFF2){r2|=_BIT_IFF1;}else{r2&=~_BIT_IFF1;}break;
                     case 0x5e:/*IM 2*/_S_IM(2);break;
-                    case 0x5f:/*LD A,R*/_T(1);d8=_G_R();_S_A(d8);_S_F(_SZIFF2_FLAGS(d8));break;
+                    case 0x5f:/*LD A,R*/_T(1);_SYNCR();d8=_G_R();_S_A(d8);_S_F(_SZIFF2_FLAGS(d8));break;
                     case 0x60:/*IN H,(C)*/{addr=_G_BC();_IN(addr++,d8);_S_WZ(addr);uint8_t f=(_G_F()&Z80_CF)|_z80_szp[d8];_S8(ws,_F,f);_S_H(d8);}break;
                     case 0x61:/*OUT (C),H*/addr=_G_BC();_OUT(addr++,_G_H());_S_WZ(addr);break;
                     case 0x62:/*SBC HL,HL*/{uint16_t acc=_G_HL();_S_WZ(acc+1);d16=_G_HL();uint32_t r=acc-d16-(_G_F()&Z80_CF);uint8_t f=Z80_NF|(((d16^acc)&(acc^r)&0x8000)>>13);_S_HL(r);f|=((acc^r^d16)>>8) & Z80_HF;f|=(r>>16)&Z80_CF;f|=(r>>8)&(Z80_SF|Z80_YF|Z80_XF);f|=(r&0xFFFF)?0:Z80_ZF;_S_F(f);_T(7);}break;
@@ -1385,8 +2897,13 @@ uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
         }
         pre_pins = pins;
     } while (ticks < num_ticks);
+    /* hand the remaining deferred ticks to the tick callback */
+    if (pend > 0) {
+        pins = tick(pend, (pins&~Z80_CTRL_MASK), ud);
+    }
     /* flush local state back to persistent CPU state before leaving */
     _S_PC(pc);
+    _SYNCR();
     r0 = _z80_flush_r0(ws, r0, r2);
     r1 = _z80_flush_r1(ws, r1, r2);
     r2 = (r2 & ~_BITS_USE_IXIY) | map_bits;
@@ -1398,6 +2915,16 @@ uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
     return ticks;
 }
 
+uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
+    /* without the block cache, the compiler drops all of its checks */
+    if (cpu->blocks) {
+        return _z80_exec(cpu, num_ticks, cpu->blocks);
+    }
+    else {
+        return _z80_exec(cpu, num_ticks, 0);
+    }
+}
+
 #undef _A
 #undef _F
 #undef _L
@@ -1438,6 +2965,9 @@ uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
 #undef _SA
 #undef _SAD
 #undef _GD
+#undef _FAST
+#undef _PAGE
+#undef _POFS
 #undef _T
 #undef _TM
 #undef _TWM
@@ -1449,8 +2979,12 @@ uint32_t z80_exec(z80_t* cpu, uint32_t num_ticks) {
 #undef _IMM16
 #undef _ADDR
 #undef _BUMPR
+#undef _SYNCR
 #undef _FETCH
 #undef _FETCH_CB
+#undef _CODE
+#undef _Z80_FORCE_INLINE
+#undef _Z80_JIT
 #undef _SZ
 #undef _SZYXCH
 #undef _ADD_FLAGS
@@ -1,40 +1,49 @@
 #pragma once
 /*
     Emulator frame timing helper functions.
-*/
-extern void clock_init(void);
-extern uint32_t clock_frame_time(void);
-extern uint32_t clock_frame_count(void);
-
-/*== IMPLEMENTATION ==========================================================*/
-#ifdef COMMON_IMPL
-#include "sokol_time.h"
 
+    clock_frame_time() returns the real time since the last call. The
+    elapsed time is accumulated exactly, the microsecond remainders are
+    carried over to the next frame. Longer stalls (window moves, debugger
+    breaks) are cut to CLOCK_MAX_FRAME_TIME_US.
+*/
+#define CLOCK_MAX_FRAME_TIME_US (100000)
 typedef struct {
     uint32_t frame_count;
     uint64_t last_time_stamp;
+    uint64_t elapsed_ticks;     /* sum of all frame lap times */
+    uint64_t elapsed_us;        /* sum of all returned frame times */
 } clock_state;
-static clock_state clck;
 
-void clock_init(void) {
+extern void clock_init(clock_state* clck);
+extern uint32_t clock_frame_time(clock_state* clck);
+extern uint32_t clock_frame_count(clock_state* clck);
+
+/*== IMPLEMENTATION ==========================================================*/
+#ifdef COMMON_IMPL
+#include "sokol_time.h"
+
+void clock_init(clock_state* clck) {
     stm_setup();
-    clck.frame_count = 0;
-    clck.last_time_stamp = stm_now();
+    clck->frame_count = 0;
+    clck->last_time_stamp = stm_now();
+    clck->elapsed_ticks = 0;
+    clck->elapsed_us = 0;
 }
 
-uint32_t clock_frame_time(void) {
-    clck.frame_count++;
-    uint32_t frame_time_us = (uint32_t) stm_us(stm_laptime(&clck.last_time_stamp));
-    if (frame_time_us < 24000) {   /* 24 ms */
-        frame_time_us = 16667;
-    }
-    else {
-        frame_time_us = 33333;
+uint32_t clock_frame_time(clock_state* clck) {
+    clck->frame_count++;
+    clck->elapsed_ticks += stm_laptime(&clck->last_time_stamp);
+    const uint64_t now_us = (uint64_t) stm_us(clck->elapsed_ticks);
+    if ((now_us - clck->elapsed_us) > CLOCK_MAX_FRAME_TIME_US) {
+        clck->elapsed_us = now_us - CLOCK_MAX_FRAME_TIME_US;
     }
+    const uint32_t frame_time_us = (uint32_t) (now_us - clck->elapsed_us);
+    clck->elapsed_us = now_us;
     return frame_time_us;
 }
 
-uint32_t clock_frame_count(void) {
-    return clck.frame_count;
+uint32_t clock_frame_count(clock_state* clck) {
+    return clck->frame_count;
 }
 #endif /* COMMON_IMPL */
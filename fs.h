@@ -1,14 +1,23 @@
 #pragma once
 /*
-    Simple file access functions.
+    Simple file access functions, all state lives in a caller-owned fs_state.
 */
-extern void fs_init(void);
-extern bool fs_load_file(const char* path);
-extern void fs_load_mem(const char* path, const uint8_t* ptr, uint32_t size);
-extern uint32_t fs_size(void);
-extern const uint8_t* fs_ptr(void);
-extern void fs_free(void);
-extern bool fs_ext(const char* str);
+#define FS_EXT_SIZE (16)
+#define FS_MAX_SIZE (1024 * 1024)
+typedef struct {
+    char ext[FS_EXT_SIZE];
+    uint8_t* ptr;
+    uint32_t size;
+    uint8_t buf[FS_MAX_SIZE + 1];
+} fs_state;
+
+extern void fs_init(fs_state* fs);
+extern bool fs_load_file(fs_state* fs, const char* path);
+extern void fs_load_mem(fs_state* fs, const char* path, const uint8_t* ptr, uint32_t size);
+extern uint32_t fs_size(fs_state* fs);
+extern const uint8_t* fs_ptr(fs_state* fs);
+extern void fs_free(fs_state* fs);
+extern bool fs_ext(fs_state* fs, const char* str);
 
 /*== IMPLEMENTATION ==========================================================*/
 #ifdef COMMON_IMPL
@@ -22,18 +31,8 @@ extern bool fs_ext(const char* str);
 #include <emscripten/emscripten.h>
 #endif
 
-#define FS_EXT_SIZE (16)
-#define FS_MAX_SIZE (1024 * 1024)
-typedef struct {
-    char ext[FS_EXT_SIZE];
-    uint8_t* ptr;
-    uint32_t size;
-    uint8_t buf[FS_MAX_SIZE + 1];
-} fs_state;
-static fs_state fs;
-
-void fs_copy_ext(const char* path) {
-    fs.ext[0] = 0;
+void fs_copy_ext(fs_state* fs, const char* path) {
+    fs->ext[0] = 0;
     const char* str = path;
     const char* slash = strrchr(str, '/');
     if (slash) {
@@ -44,68 +43,68 @@ void fs_copy_ext(const char* path) {
         int i = 0;
         char c = 0;
         while ((c = *++ext) && (i < (FS_EXT_SIZE-1))) {
-            fs.ext[i] = tolower(c);
+            fs->ext[i] = tolower(c);
             i++;
         }
-        fs.ext[i] = 0;
+        fs->ext[i] = 0;
     }
 }
 
-bool fs_ext(const char* ext) {
-    return 0 == strcmp(ext, fs.ext);
+bool fs_ext(fs_state* fs, const char* ext) {
+    return 0 == strcmp(ext, fs->ext);
 }
 
-void fs_free(void) {
-    memset(&fs, 0, sizeof(fs));
+void fs_free(fs_state* fs) {
+    memset(fs, 0, sizeof(fs_state));
 }
 
-void fs_load_mem(const char* path, const uint8_t* ptr, uint32_t size) {
-    fs_free();
+void fs_load_mem(fs_state* fs, const char* path, const uint8_t* ptr, uint32_t size) {
+    fs_free(fs);
     if ((size > 0) && (size <= FS_MAX_SIZE)) {
-        fs_copy_ext(path);
-        fs.size = size;
-        fs.ptr = fs.buf;
-        memcpy(fs.ptr, ptr, size);
+        fs_copy_ext(fs, path);
+        fs->size = size;
+        fs->ptr = fs->buf;
+        memcpy(fs->ptr, ptr, size);
         /* zero-terminate in case this is a text file */
-        fs.ptr[fs.size] = 0;
+        fs->ptr[fs->size] = 0;
     }
 }
 
 #if !defined(__EMSCRIPTEN__)
-bool fs_load_file(const char* path) {
-    fs_free();
-    fs_copy_ext(path);
+bool fs_load_file(fs_state* fs, const char* path) {
+    fs_free(fs);
+    fs_copy_ext(fs, path);
     FILE* fp = fopen(path, "rb");
     bool success = false;
     if (fp) {
         fseek(fp, 0, SEEK_END);
         int size = ftell(fp);
         if (size <= FS_MAX_SIZE) {
-            fs.size = size;
+            fs->size = size;
             fseek(fp, 0, SEEK_SET);
-            if (fs.size > 0) {
-                fs.ptr = fs.buf;
-                uint32_t res = (int) fread(fs.ptr, 1, fs.size, fp); (void)res;
-                success = (res == fs.size);
+            if (fs->size > 0) {
+                fs->ptr = fs->buf;
+                uint32_t res = (int) fread(fs->ptr, 1, fs->size, fp); (void)res;
+                success = (res == fs->size);
             }
             fclose(fp);
             /* zero-terminate in case this is a text file */
-            fs.ptr[fs.size] = 0;
+            fs->ptr[fs->size] = 0;
         }
     }
     return success;
 }
 #else
-EMSCRIPTEN_KEEPALIVE void emsc_load_data(const char* path, const uint8_t* ptr, int size) {
-    fs_load_mem(path, ptr, size);
+EMSCRIPTEN_KEEPALIVE void emsc_load_data(fs_state* fs, const char* path, const uint8_t* ptr, int size) {
+    fs_load_mem(fs, path, ptr, size);
 }
 
 EM_JS(void, emsc_fs_init, (void), {
-    console.log("fs.h: registering Module['ccall']");
+    console.log("fs->h: registering Module['ccall']");
     Module['ccall'] = ccall;
 });
 
-EM_JS(void, emsc_load_file, (const char* path_cstr), {
+EM_JS(void, emsc_load_file, (fs_state* fs, const char* path_cstr), {
     var path = UTF8ToString(path_cstr);
     var req = new XMLHttpRequest();
     req.open("GET", path);
@@ -114,8 +113,8 @@ EM_JS(void, emsc_load_file, (const char* path_cstr), {
         var uint8Array = new Uint8Array(req.response);
         var res = ccall('emsc_load_data',
             'int',
-            ['string', 'array', 'number'],
-            [path, uint8Array, uint8Array.length]);
+            ['number', 'string', 'array', 'number'],
+            [fs, path, uint8Array, uint8Array.length]);
     };
     req.send();
 });
@@ -123,26 +122,26 @@ EM_JS(void, emsc_load_file, (const char* path_cstr), {
 /* NOTE: this is loading the data asynchronously, need to check fs_ptr()
    whether the data has actually been loaded!
 */
-bool fs_load_file(const char* path) {
-    fs_free();
-    emsc_load_file(path);
+bool fs_load_file(fs_state* fs, const char* path) {
+    fs_free(fs);
+    emsc_load_file(fs, path);
     return true;
 }
 #endif
 
-void fs_init(void) {
-    memset(&fs, 0, sizeof(fs));
+void fs_init(fs_state* fs) {
+    memset(fs, 0, sizeof(fs_state));
     #if defined(__EMSCRIPTEN__)
     emsc_fs_init();
     #endif
 }
 
-const uint8_t* fs_ptr(void) {
-    return fs.ptr;
+const uint8_t* fs_ptr(fs_state* fs) {
+    return fs->ptr;
 }
 
-uint32_t fs_size(void) {
-    return fs.size;
+uint32_t fs_size(fs_state* fs) {
+    return fs->size;
 }
 
 #endif /* COMMON_IMPL */
@@ -15,6 +15,9 @@ extern "C" {
 
 #define GFX_MAX_FB_WIDTH (1024)
 #define GFX_MAX_FB_HEIGHT (1024)
+#define GFX_PALETTE_SIZE (16)   /* max number of colors for gfx_draw_indexed() */
+#define GFX_MC6847_FRAME_WIDTH (256)    /* the MC6847 frame data as 256x38 texture */
+#define GFX_MC6847_FRAME_HEIGHT (38)
 
 typedef struct {
     int top_offset;
@@ -28,6 +31,10 @@ void gfx_init(const gfx_desc_t* desc);
 uint32_t* gfx_framebuffer(void);
 int gfx_framebuffer_size(void);
 void gfx_draw(int width, int height);
+void gfx_draw_pixels(const uint32_t* pixels, int width, int height);
+void gfx_draw_indexed(const uint8_t* pixels, const uint32_t* palette, int num_colors, int width, int height);
+void gfx_draw_mc6847(const uint8_t* frame_data, const uint32_t* palette, int num_colors, int width, int height);
+void gfx_redraw(void);
 void gfx_shutdown(void);
 void* gfx_create_texture(int w, int h);
 void gfx_update_texture(void* h, void* data, int data_byte_size);
@@ -42,6 +49,7 @@ void gfx_flash_error(void);
 /*== IMPLEMENTATION ==========================================================*/
 #ifdef COMMON_IMPL
 
+#include <string.h>
 #include "sokol_gfx.h"
 #include "sokol_app.h"
 #include "sokol_time.h"
@@ -59,8 +67,15 @@ typedef struct {
     sg_pipeline upscale_pip;
     sg_bindings upscale_bind;
     sg_pass upscale_pass;
+    sg_pipeline upscale_indexed_pip;
+    sg_bindings upscale_indexed_bind;
+    sg_pipeline mc6847_pip;
+    sg_bindings mc6847_bind;
     sg_pipeline display_pip;
     sg_bindings display_bind;
+    uint32_t palette[GFX_PALETTE_SIZE];
+    int num_palette_colors;
+    bool has_frame;     /* the upscaled texture holds a frame */
     int flash_success_count;
     int flash_error_count;
     int top_offset;
@@ -94,8 +109,10 @@ void gfx_init_images_and_pass(void) {
 
     /* destroy previous resources (if exist) */
     sg_destroy_image(gfx.upscale_bind.fs_images[0]);
+    sg_destroy_image(gfx.upscale_indexed_bind.fs_images[SLOT_tex]);
     sg_destroy_image(gfx.display_bind.fs_images[0]);
     sg_destroy_pass(gfx.upscale_pass);
+    gfx.has_frame = false;
 
     /* a texture with the emulator's raw pixel data */
     gfx.upscale_bind.fs_images[0] = sg_make_image(&(sg_image_desc){
@@ -108,6 +125,17 @@ void gfx_init_images_and_pass(void) {
         .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
         .wrap_v = SG_WRAP_CLAMP_TO_EDGE
     });
+    /* the same with 8-bit color indices for gfx_draw_indexed() */
+    gfx.upscale_indexed_bind.fs_images[SLOT_tex] = sg_make_image(&(sg_image_desc){
+        .width = gfx.fb_width,
+        .height = gfx.fb_height,
+        .pixel_format = SG_PIXELFORMAT_R8,
+        .usage = SG_USAGE_STREAM,
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE
+    });
     /* a 2x upscaled render-target-texture */
     gfx.display_bind.fs_images[0] = sg_make_image(&(sg_image_desc){
         .render_target = true,
@@ -136,8 +164,8 @@ void gfx_init(const gfx_desc_t* desc) {
     sg_setup(&(sg_desc){
         .buffer_pool_size = 8,
         .image_pool_size = 128,
-        .shader_pool_size = 4,
-        .pipeline_pool_size = 4,
+        .shader_pool_size = 8,
+        .pipeline_pool_size = 8,
         .context_pool_size = 2,
         .mtl_device = sapp_metal_get_device(),
         .mtl_renderpass_descriptor_cb = sapp_metal_get_renderpass_descriptor,
@@ -177,6 +205,8 @@ void gfx_init(const gfx_desc_t* desc) {
         .size = sizeof(verts),
         .content = verts,
     });
+    gfx.upscale_indexed_bind.vertex_buffers[0] = gfx.upscale_bind.vertex_buffers[0];
+    gfx.mc6847_bind.vertex_buffers[0] = gfx.upscale_bind.vertex_buffers[0];
     gfx.display_bind.vertex_buffers[0] = sg_make_buffer(&(sg_buffer_desc){
         .size = sizeof(verts),
         .content = sg_query_features().origin_top_left ? 
@@ -184,7 +214,33 @@ void gfx_init(const gfx_desc_t* desc) {
                         (gfx.rot90 ? verts_flipped_rot : verts_flipped)
     });
 
-    /* 2 pipeline-state-objects, one for upscaling, one for rendering */
+    /* the color palette for gfx_draw_indexed(), uploaded when it changes */
+    gfx.num_palette_colors = 0;
+    gfx.upscale_indexed_bind.fs_images[SLOT_pal] = sg_make_image(&(sg_image_desc){
+        .width = GFX_PALETTE_SIZE,
+        .height = 1,
+        .pixel_format = SG_PIXELFORMAT_RGBA8,
+        .usage = SG_USAGE_STREAM,
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE
+    });
+    gfx.mc6847_bind.fs_images[SLOT_pal] = gfx.upscale_indexed_bind.fs_images[SLOT_pal];
+
+    /* the MC6847 video memory and line table for gfx_draw_mc6847(), one byte per texel */
+    gfx.mc6847_bind.fs_images[SLOT_frame] = sg_make_image(&(sg_image_desc){
+        .width = GFX_MC6847_FRAME_WIDTH,
+        .height = GFX_MC6847_FRAME_HEIGHT,
+        .pixel_format = SG_PIXELFORMAT_R8,
+        .usage = SG_USAGE_STREAM,
+        .min_filter = SG_FILTER_NEAREST,
+        .mag_filter = SG_FILTER_NEAREST,
+        .wrap_u = SG_WRAP_CLAMP_TO_EDGE,
+        .wrap_v = SG_WRAP_CLAMP_TO_EDGE
+    });
+
+    /* pipeline-state-objects for upscaling RGBA8 or indexed pixels, decoding MC6847 frames, and for rendering */
     gfx.display_pip = sg_make_pipeline(&(sg_pipeline_desc){
         .shader = sg_make_shader(display_shader_desc()),
         .layout = {
@@ -206,6 +262,28 @@ void gfx_init(const gfx_desc_t* desc) {
         .primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP,
         .blend.depth_format = SG_PIXELFORMAT_NONE
     });
+    gfx.upscale_indexed_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(upscale_indexed_shader_desc()),
+        .layout = {
+            .attrs = {
+                [0].format = SG_VERTEXFORMAT_FLOAT2,
+                [1].format = SG_VERTEXFORMAT_FLOAT2
+            }
+        },
+        .primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP,
+        .blend.depth_format = SG_PIXELFORMAT_NONE
+    });
+    gfx.mc6847_pip = sg_make_pipeline(&(sg_pipeline_desc){
+        .shader = sg_make_shader(mc6847_shader_desc()),
+        .layout = {
+            .attrs = {
+                [0].format = SG_VERTEXFORMAT_FLOAT2,
+                [1].format = SG_VERTEXFORMAT_FLOAT2
+            }
+        },
+        .primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP,
+        .blend.depth_format = SG_PIXELFORMAT_NONE
+    });
 }
 
 /* apply a viewport rectangle to preserve the emulator's aspect ratio,
@@ -234,31 +312,33 @@ static void apply_viewport(int canvas_width, int canvas_height) {
 }
 
 void gfx_draw(int width, int height) {
-    /* check if framebuffer size has changed, need to create new backing texture */
+    gfx_draw_pixels(gfx.rgba8_buffer, width, height);
+}
+
+/* check if framebuffer size has changed, need to create new backing textures */
+static void gfx_check_size(int width, int height) {
     if ((width != gfx.fb_width) || (height != gfx.fb_height)) {
         gfx.fb_width = width;
         gfx.fb_height = height;
         gfx_init_images_and_pass();
     }
-	//printf("gfx_init_images_and_pass\n");
-    /* copy emulator pixel data into upscaling source texture */
-    sg_update_image(gfx.upscale_bind.fs_images[0], &(sg_image_content){
-        .subimage[0][0] = { 
-            .ptr = gfx.rgba8_buffer,
-            .size = gfx.fb_width*gfx.fb_height*sizeof(uint32_t)
-        }
-    });
-	//printf("sg_update_image\n");
-    /* upscale the original framebuffer 2x with nearest filtering */
+}
+
+/* upscale the uploaded source texture 2x with nearest filtering */
+static void gfx_upscale(sg_pipeline upscale_pip, const sg_bindings* upscale_bind) {
     sg_begin_pass(gfx.upscale_pass, &gfx_upscale_pass_action);
 	//printf("sg_begin_pass\n");
-    sg_apply_pipeline(gfx.upscale_pip);
-    sg_apply_bindings(&gfx.upscale_bind);
+    sg_apply_pipeline(upscale_pip);
+    sg_apply_bindings(upscale_bind);
     sg_draw(0, 4, 1);
 	//printf("sg_draw\n");
     sg_end_pass();
 	//printf("sg_end_pass\n");
+    gfx.has_frame = true;
+}
 
+/* draw the upscaled frame to the display */
+static void gfx_display(void) {
     /* tint the clear color red or green if flash feedback is requested */
     if (gfx.flash_error_count > 0) {
         gfx.flash_error_count--;
@@ -277,11 +357,13 @@ void gfx_draw(int width, int height) {
     int w = (int) sapp_width();
     int h = (int) sapp_height();
     sg_begin_default_pass(&gfx_draw_pass_action, w, h);
-    apply_viewport(w, h);
-    sg_apply_pipeline(gfx.display_pip);
-    sg_apply_bindings(&gfx.display_bind);
-    sg_draw(0, 4, 1);
-    sg_apply_viewport(0, 0, w, h, true);
+    if (gfx.has_frame) {
+        apply_viewport(w, h);
+        sg_apply_pipeline(gfx.display_pip);
+        sg_apply_bindings(&gfx.display_bind);
+        sg_draw(0, 4, 1);
+        sg_apply_viewport(0, 0, w, h, true);
+    }
 	//printf("sg_apply_viewport\n");
     if (gfx.draw_extra_cb) {
         gfx.draw_extra_cb();
@@ -292,6 +374,73 @@ void gfx_draw(int width, int height) {
 	//printf("sg_commit\n");
 }
 
+/* draw from a pixel buffer other than gfx_framebuffer() */
+void gfx_draw_pixels(const uint32_t* pixels, int width, int height) {
+    gfx_check_size(width, height);
+	//printf("gfx_init_images_and_pass\n");
+    /* copy emulator pixel data into upscaling source texture */
+    sg_update_image(gfx.upscale_bind.fs_images[0], &(sg_image_content){
+        .subimage[0][0] = { 
+            .ptr = pixels,
+            .size = gfx.fb_width*gfx.fb_height*sizeof(uint32_t)
+        }
+    });
+	//printf("sg_update_image\n");
+    gfx_upscale(gfx.upscale_pip, &gfx.upscale_bind);
+    gfx_display();
+}
+
+/*  draw from a buffer of 8-bit color indices, the upscale pass looks up
+    the colors in the palette (up to GFX_PALETTE_SIZE RGBA8 colors),
+    this uploads a quarter of the data of gfx_draw_pixels(), the width
+    must be a multiple of 4 (the default GL unpack alignment)
+*/
+/* upload the palette of the indexed shaders if it changed */
+static void gfx_update_palette(const uint32_t* palette, int num_colors) {
+    if (num_colors > GFX_PALETTE_SIZE) {
+        num_colors = GFX_PALETTE_SIZE;
+    }
+    if ((num_colors != gfx.num_palette_colors) || (0 != memcmp(palette, gfx.palette, num_colors * sizeof(uint32_t)))) {
+        memset(gfx.palette, 0, sizeof(gfx.palette));
+        memcpy(gfx.palette, palette, num_colors * sizeof(uint32_t));
+        gfx.num_palette_colors = num_colors;
+        sg_update_image(gfx.upscale_indexed_bind.fs_images[SLOT_pal], &(sg_image_content){
+            .subimage[0][0] = { .ptr = gfx.palette, .size = sizeof(gfx.palette) }
+        });
+    }
+}
+
+void gfx_draw_indexed(const uint8_t* pixels, const uint32_t* palette, int num_colors, int width, int height) {
+    gfx_check_size(width, height);
+    gfx_update_palette(palette, num_colors);
+    sg_update_image(gfx.upscale_indexed_bind.fs_images[SLOT_tex], &(sg_image_content){
+        .subimage[0][0] = { .ptr = pixels, .size = gfx.fb_width*gfx.fb_height }
+    });
+    gfx_upscale(gfx.upscale_indexed_pip, &gfx.upscale_indexed_bind);
+    gfx_display();
+}
+
+/*  draw from MC6847 frame data (MC6847_FRAME_DATA_SIZE bytes from
+    mc6847_frame_data()), the MC6847 modes are decoded in the upscale
+    pass, width and height are the MC6847 display size
+*/
+void gfx_draw_mc6847(const uint8_t* frame_data, const uint32_t* palette, int num_colors, int width, int height) {
+    gfx_check_size(width, height);
+    gfx_update_palette(palette, num_colors);
+    sg_update_image(gfx.mc6847_bind.fs_images[SLOT_frame], &(sg_image_content){
+        .subimage[0][0] = { .ptr = frame_data, .size = GFX_MC6847_FRAME_WIDTH*GFX_MC6847_FRAME_HEIGHT }
+    });
+    gfx_upscale(gfx.mc6847_pip, &gfx.mc6847_bind);
+    gfx_display();
+}
+
+/*  draw the last frame again when the emulator output didn't change,
+    without uploading and upscaling it
+*/
+void gfx_redraw(void) {
+    gfx_display();
+}
+
 void gfx_shutdown() {
     sg_shutdown();
 }
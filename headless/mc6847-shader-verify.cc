@@ -0,0 +1,128 @@
+/*
+    mc6847-shader-verify.cc
+
+    Checks the mc6847_fs fragment shader in shaders.glsl against the
+    MC6847's own decoder. The shader source is compiled as C++ with just
+    enough GLSL declared around it (the Makefile extracts it into
+    mc6847_fs.inc), and run for every pixel of the 320x243 framebuffer
+    on the mc6847_frame_data() of random video memory, in all 32
+    combinations of the AG, GM0..GM2 and CSS pins. The color index it
+    picks from the palette texture must be the same as in the MC6847's
+    indexed framebuffer. The attribute bits are the SPC-1000's.
+
+    Usage:
+        make mc6847-shader-verify && ./mc6847-shader-verify
+
+    Returns 0 if all pixels match (this is also run by 'make verify').
+*/
+#define CHIPS_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include "chips/mc6847.h"
+
+#define NUM_SEEDS (8)
+#define MAX_REPORTS (10)
+
+/* the frame data texture, as uploaded by gfx_draw_mc6847() */
+static uint8_t frame_data[MC6847_FRAME_DATA_SIZE];
+
+namespace glsl {
+    struct vec2 {
+        float x, y;
+        vec2() : x(0.0f), y(0.0f) { }
+        vec2(float x_, float y_) : x(x_), y(y_) { }
+    };
+    struct vec4 {
+        float x, y, z, w;
+    };
+    struct sampler2D {
+        int unused;
+    };
+    inline float floor(float v) { return std::floor(v); }
+    inline float exp2(float v) { return std::exp2(v); }
+    vec4 texture(const sampler2D& s, vec2 uv);
+
+    #define uniform static
+    #define in static
+    #define out static
+    #define main mc6847_fs_main
+    #include "mc6847_fs.inc"
+    #undef uniform
+    #undef in
+    #undef out
+    #undef main
+
+    /*  nearest-filtered lookups: the 256x38 R8 frame texture, and instead
+        of the 16x1 palette texture the color index itself
+    */
+    vec4 texture(const sampler2D& s, vec2 uv) {
+        vec4 c = { 0.0f, 0.0f, 0.0f, 1.0f };
+        if (&s == &frame) {
+            const int x = (int)(uv.x * 256.0f);
+            const int y = (int)(uv.y * (MC6847_FRAME_DATA_SIZE / 256));
+            c.x = frame_data[y * 256 + x] / 255.0f;
+        }
+        else {
+            c.x = (float)(int)(uv.x * 16.0f);
+        }
+        return c;
+    }
+}
+
+static uint8_t vram[0x2000];
+static uint8_t index8[MC6847_DISPLAY_WIDTH * MC6847_DISPLAY_HEIGHT];
+
+int main() {
+    static const uint64_t gm_pins[8] = {
+        0, MC6847_GM0, MC6847_GM1, MC6847_GM0|MC6847_GM1,
+        MC6847_GM2, MC6847_GM2|MC6847_GM0, MC6847_GM2|MC6847_GM1, MC6847_GM2|MC6847_GM1|MC6847_GM0
+    };
+    int mismatches = 0;
+    int pixels = 0;
+    for (int seed = 0; seed < NUM_SEEDS; seed++) {
+        srand(seed);
+        for (int i = 0; i < (int)sizeof(vram); i++) {
+            vram[i] = (uint8_t) rand();
+        }
+        static mc6847_t vdg;
+        mc6847_desc_t desc;
+        memset(&desc, 0, sizeof(desc));
+        desc.tick_hz = MC6847_TICK_HZ;
+        desc.index8_buffer = index8;
+        desc.index8_buffer_size = sizeof(index8);
+        desc.vram = vram;
+        desc.vram_size = sizeof(vram);
+        desc.attr_offset = 0x800;
+        desc.attr_inv = 0x1;
+        desc.attr_css = 0x2;
+        desc.attr_as = 0x4;
+        desc.attr_intext = 0x8;
+        mc6847_init(&vdg, &desc);
+        for (int mode = 0; mode < 32; mode++) {
+            const uint64_t pins = gm_pins[mode & 7] | ((mode & 8) ? MC6847_AG : 0) | ((mode & 16) ? MC6847_CSS : 0);
+            mc6847_ctrl(&vdg, pins, MC6847_AG|MC6847_GM0|MC6847_GM1|MC6847_GM2|MC6847_CSS);
+            /* two fields, so that every line has been decoded in this mode */
+            mc6847_exec(&vdg, 2 * (MC6847_TICK_HZ / 60));
+            mc6847_frame_data(&vdg, frame_data);
+            for (int y = 0; y < MC6847_DISPLAY_HEIGHT; y++) {
+                for (int x = 0; x < MC6847_DISPLAY_WIDTH; x++) {
+                    glsl::uv = glsl::vec2((x + 0.5f) / MC6847_DISPLAY_WIDTH, (y + 0.5f) / MC6847_DISPLAY_HEIGHT);
+                    glsl::mc6847_fs_main();
+                    const int got = (int) glsl::frag_color.x;
+                    const int expected = index8[y * MC6847_DISPLAY_WIDTH + x];
+                    if (got != expected) {
+                        if (mismatches < MAX_REPORTS) {
+                            fprintf(stderr, "seed %d mode %d: pixel %d,%d is %d, expected %d\n", seed, mode, x, y, got, expected);
+                        }
+                        mismatches++;
+                    }
+                    pixels++;
+                }
+            }
+        }
+    }
+    printf("mc6847_fs: %d pixels, %d mismatches\n", pixels, mismatches);
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,696 @@
+/*
+    spc1000-bench.c
+
+    Emulation throughput benchmark. Runs a fixed set of workloads from
+    the bundled ROM and tapes as fast as possible and reports emulated
+    MHz, frames per second and nanoseconds per Z80 tick, together with a
+    cost breakdown for CPU, VDG, AY, beeper and tape. The breakdown is
+    measured by running each workload again with one device switched off
+    (see spc1000_disable_devices()), the CPU cost is the run with all
+    devices switched off. Switching off the tape stops tapes from loading,
+    so for workloads that load during the run the tape cost also contains
+    the difference between the two workloads. Costs are differences of
+    timings, small values can be negative because of measurement noise.
+
+    With instances=n, each workload instead runs on n instances at once
+    through the spc1000_farm.h thread pool, once on a single thread and
+    once on all threads, to measure how throughput scales with cores.
+
+    With verify=on, each workload instead runs on two instances in
+    lockstep, one with the CPU memory fast path, the MC6847 dirty
+    tracking and direct VRAM reads, and one without (see
+    spc1000_set_cpu_fast_path()), and the CPU registers, tick count, RAM,
+    VRAM and framebuffer are compared after every frame.
+
+    With blocks=on, all runs use the CPU's predecoded basic-block cache
+    (see spc1000_set_cpu_block_cache()), with verify=on it is compared
+    together with the other fast paths.
+
+    With jit=on, the blocks also run as native code where the CPU's
+    recompiler supports the host (see spc1000_set_cpu_jit()), with
+    jit=verify each block run is compared with the interpreter, and any
+    difference fails the benchmark.
+
+    Usage:
+        spc1000-bench [roms=dir] [workload=name] [repeat=n] [json=file]
+                      [breakdown=off] [vdg=off] [ay=off] [beeper=off] [tape=off]
+                      [instances=n] [threads=n] [verify=on] [blocks=on]
+                      [jit=on|verify]
+
+        roms        directory with spcall.rom and the tapes (default: roms/spc1000)
+        workload    only run this workload (default: all)
+        repeat      each run is repeated n times, the fastest counts (default: 3)
+        json        write the results to this file (default: spc1000-bench.json)
+        breakdown   skip the per-device runs
+        vdg..tape   switch a device off for all runs
+        instances   run n instances in parallel, no breakdown
+        threads     number of threads with instances (default: CPU cores)
+        verify      compare the fast paths with the plain emulation
+        blocks      run the CPU from predecoded basic blocks
+        jit         translate the blocks into native code (x86-64 only)
+
+    Workloads with input and tapes are deterministic, the fb_hash and
+    ram_hash in the results change only when the emulation output changes.
+*/
+#define CHIPS_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "chips/z80.h"
+#include "chips/mc6847.h"
+#include "chips/beeper.h"
+#include "chips/ay38910.h"
+#include "chips/kbd.h"
+#include "chips/clk.h"
+#include "chips/mem.h"
+#include "systems/spc1000.h"
+#include "systems/spc1000_farm.h"
+
+#define FRAME_US (16667)
+#define INPUT_KEY_FRAMES (6)        /* frames between two typed keys */
+#define MAX_INPUTS (8)
+#define MAX_PATH (1024)
+
+/* text typed into the keyboard starting at a frame, '\n' is Return */
+typedef struct {
+    int frame;
+    const char* text;
+} bench_input_t;
+
+typedef struct {
+    const char* name;
+    const char* tape;       /* tape file in the roms directory, or 0 */
+    bool fastload;
+    int num_frames;
+    bench_input_t input[MAX_INPUTS];
+} bench_workload_t;
+
+/* cursor keys as typed characters */
+#define KEY_LEFT "\x08"
+#define KEY_RIGHT "\x09"
+#define KEY_DOWN "\x0a"
+#define KEY_UP "\x0b"
+
+static const bench_workload_t workloads[] = {
+    {
+        .name = "basic_idle",
+        .num_frames = 1200,
+    },
+    {
+        /* load through the unpatched ROM routines, with the tape fast-forward */
+        .name = "demo_load",
+        .tape = "demo.tap",
+        .num_frames = 1200,
+        .input = { { 120, "LOAD\n" } },
+    },
+    {
+        .name = "pengo",
+        .tape = "PENGO.tap",
+        .fastload = true,
+        .num_frames = 3000,
+        .input = {
+            { 120, "LOAD\n" },
+            { 500, "LOAD\n" },
+            { 1000, "RUN\n" },
+            { 1600, "  " KEY_UP KEY_UP KEY_LEFT KEY_LEFT KEY_DOWN KEY_DOWN KEY_RIGHT KEY_RIGHT " "
+                    KEY_LEFT KEY_LEFT KEY_UP KEY_UP "  " KEY_RIGHT KEY_RIGHT KEY_DOWN KEY_DOWN " " },
+        },
+    },
+    {
+        .name = "xevious",
+        .tape = "Xevious.cas",
+        .fastload = true,
+        .num_frames = 2400,
+        .input = {
+            { 120, "LOAD\n" },
+            { 900, " " KEY_LEFT KEY_LEFT " " KEY_RIGHT KEY_RIGHT " " KEY_UP KEY_UP " " KEY_DOWN KEY_DOWN
+                   " " KEY_LEFT " " KEY_RIGHT " " KEY_LEFT " " KEY_RIGHT "   " },
+        },
+    },
+};
+#define NUM_WORKLOADS ((int)(sizeof(workloads) / sizeof(workloads[0])))
+
+/* the benchmarked devices, in the order of the breakdown */
+static const struct {
+    const char* name;
+    uint8_t mask;
+} devices[] = {
+    { "vdg", SPC1K_DEVICE_VDG },
+    { "ay", SPC1K_DEVICE_AY },
+    { "beeper", SPC1K_DEVICE_BEEPER },
+    { "tape", SPC1K_DEVICE_TAPE },
+};
+#define NUM_DEVICES ((int)(sizeof(devices) / sizeof(devices[0])))
+#define ALL_DEVICES (SPC1K_DEVICE_VDG|SPC1K_DEVICE_AY|SPC1K_DEVICE_BEEPER|SPC1K_DEVICE_TAPE)
+
+/* result of one workload run */
+typedef struct {
+    int frames;
+    uint64_t ticks;
+    double wall;
+    uint64_t fb_hash;
+    uint64_t ram_hash;
+} bench_result_t;
+
+/* playback state of a workload's input */
+typedef struct {
+    const bench_workload_t* wl;
+    const bench_input_t* input;
+    const char* text;
+    int key;
+    uint32_t tick_count;
+    uint64_t ticks;
+} bench_script_t;
+
+/* parallel runs of one workload */
+typedef struct {
+    const bench_workload_t* wl;
+    bench_script_t* scripts;
+} bench_farm_t;
+
+static spc1000_t spc1000;
+static uint32_t pixels[MC6847_DISPLAY_WIDTH * MC6847_DISPLAY_HEIGHT];
+static spc1000_t spc1000_ref;
+static uint32_t ref_pixels[MC6847_DISPLAY_WIDTH * MC6847_DISPLAY_HEIGHT];
+static uint8_t rom[0x8000];
+static bool block_cache;
+static bool jit;
+static bool jit_verify;
+static bool jit_unsupported;
+static uint32_t jit_checked;
+static uint32_t jit_mismatches;
+static uint16_t jit_mismatch_pc;
+
+/* key=value command line arguments, like sokol_args in the frontend */
+static const char* arg(int argc, char* argv[], const char* key) {
+    const size_t len = strlen(key);
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strncmp(argv[i], key, len)) && (argv[i][len] == '=')) {
+            return &argv[i][len+1];
+        }
+    }
+    return 0;
+}
+
+static bool arg_off(int argc, char* argv[], const char* key) {
+    const char* val = arg(argc, argv, key);
+    return val && (0 == strcmp(val, "off"));
+}
+
+static bool arg_on(int argc, char* argv[], const char* key) {
+    const char* val = arg(argc, argv, key);
+    return val && (0 == strcmp(val, "on"));
+}
+
+static uint8_t* load_file(const char* path, int* out_size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    int size = (int) ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* buf = (uint8_t*) malloc(size > 0 ? size : 1);
+    if (fread(buf, 1, size, fp) != (size_t)size) {
+        free(buf);
+        buf = 0;
+    }
+    fclose(fp);
+    *out_size = size;
+    return buf;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* FNV-1a */
+static uint64_t hash(const void* ptr, size_t num_bytes) {
+    const uint8_t* p = (const uint8_t*) ptr;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < num_bytes; i++) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static spc1000_desc_t bench_desc(const bench_workload_t* wl) {
+    return (spc1000_desc_t){
+        .type = SPC1000,
+        .pixel_buffer = pixels,
+        .pixel_buffer_size = sizeof(pixels),
+        .rom_spc1000 = rom,
+        .rom_spc1000_size = sizeof(rom),
+        .tape_fastload = wl->fastload,
+        .cpu_block_cache = block_cache,
+        .cpu_jit = jit,
+    };
+}
+
+/* switch on the recompiler's conformance mode after spc1000_init() */
+static void jit_start(spc1000_t* sys) {
+    if (jit_verify) {
+        spc1000_set_cpu_jit(sys, true, true);
+    }
+    if (jit && !sys->cpu_jit) {
+        jit_unsupported = true;
+    }
+}
+
+/* collect the recompiler's conformance results before spc1000_discard() */
+static void jit_stop(spc1000_t* sys) {
+    if ((0 == jit_mismatches) && (sys->cpu_blocks.jit_mismatches > 0)) {
+        jit_mismatch_pc = sys->cpu_blocks.jit_mismatch_pc;
+    }
+    jit_checked += sys->cpu_blocks.jit_checked;
+    jit_mismatches += sys->cpu_blocks.jit_mismatches;
+}
+
+static void script_init(bench_script_t* s, const bench_workload_t* wl, spc1000_t* sys) {
+    memset(s, 0, sizeof(bench_script_t));
+    s->wl = wl;
+    s->input = wl->input;
+    s->tick_count = sys->tick_count;
+}
+
+/* release the last key, type the next one and count the ticks of the last frame */
+static void script_frame(bench_script_t* s, spc1000_t* sys, int frame) {
+    if (s->key) {
+        spc1000_key_up(sys, s->key);
+        s->key = 0;
+    }
+    s->ticks += (uint32_t)(sys->tick_count - s->tick_count);
+    s->tick_count = sys->tick_count;
+    if (frame >= s->wl->num_frames) {
+        return;
+    }
+    const bench_workload_t* wl = s->wl;
+    if (!s->text && (s->input < &wl->input[MAX_INPUTS]) && s->input->text && (frame >= s->input->frame)) {
+        s->text = s->input->text;
+        s->input++;
+    }
+    if (s->text && (0 == (frame % INPUT_KEY_FRAMES))) {
+        s->key = (*s->text == '\n') ? 0x0D : *s->text;
+        spc1000_key_down(sys, s->key);
+        if (0 == *(++s->text)) {
+            s->text = 0;
+        }
+    }
+}
+
+static void run(const bench_workload_t* wl, const spc1000_tape_t* tape_image, uint8_t devices_off, bench_result_t* res) {
+    spc1000_desc_t desc = bench_desc(wl);
+    spc1000_init(&spc1000, &desc);
+    jit_start(&spc1000);
+    /* the tape is copied, so that every run starts at the same position */
+    spc1000_tape_t tape;
+    if (tape_image) {
+        tape = *tape_image;
+        spc1000_attach_tape(&spc1000, &tape);
+    }
+    spc1000_disable_devices(&spc1000, devices_off);
+
+    bench_script_t script;
+    script_init(&script, wl, &spc1000);
+    const double start = now_sec();
+    for (int frame = 0; frame < wl->num_frames; frame++) {
+        script_frame(&script, &spc1000, frame);
+        spc1000_exec(&spc1000, FRAME_US);
+    }
+    script_frame(&script, &spc1000, wl->num_frames);
+    res->wall = now_sec() - start;
+    res->frames = wl->num_frames;
+    res->ticks = script.ticks;
+    res->fb_hash = hash(pixels, sizeof(pixels));
+    res->ram_hash = hash(spc1000.ram, sizeof(spc1000.ram));
+    jit_stop(&spc1000);
+    spc1000_discard(&spc1000);
+}
+
+static void farm_frame(spc1000_t* sys, int index, uint32_t frame, void* user_data) {
+    bench_farm_t* bf = (bench_farm_t*) user_data;
+    script_frame(&bf->scripts[index], sys, (int)frame);
+}
+
+/*  run a workload on num_instances instances in parallel, the result has
+    the total number of frames and ticks of all instances, the hashes are
+    those of the first instance, false if any instance has different hashes
+*/
+static bool run_farm(const bench_workload_t* wl, const spc1000_tape_t* tape_image, uint8_t devices_off, int num_instances, int num_threads, bench_result_t* res) {
+    bench_farm_t bf = { .wl = wl };
+    bf.scripts = (bench_script_t*) calloc(num_instances, sizeof(bench_script_t));
+    spc1000_tape_t* tapes = (spc1000_tape_t*) calloc(num_instances, sizeof(spc1000_tape_t));
+    spc1000_farm_t farm;
+    spc1000_farm_init(&farm, &(spc1000_farm_desc_t){
+        .num_instances = num_instances,
+        .num_threads = num_threads,
+        .desc = bench_desc(wl),
+        .frame_cb = farm_frame,
+        .user_data = &bf,
+    });
+    for (int i = 0; i < num_instances; i++) {
+        spc1000_t* sys = spc1000_farm_instance(&farm, i);
+        if (tape_image) {
+            tapes[i] = *tape_image;
+            spc1000_attach_tape(sys, &tapes[i]);
+        }
+        spc1000_disable_devices(sys, devices_off);
+        script_init(&bf.scripts[i], wl, sys);
+    }
+    const double start = now_sec();
+    spc1000_farm_exec(&farm, FRAME_US, wl->num_frames);
+    res->wall = now_sec() - start;
+    res->frames = 0;
+    res->ticks = 0;
+    bool same = true;
+    for (int i = 0; i < num_instances; i++) {
+        spc1000_t* sys = spc1000_farm_instance(&farm, i);
+        script_frame(&bf.scripts[i], sys, wl->num_frames);
+        res->frames += wl->num_frames;
+        res->ticks += bf.scripts[i].ticks;
+        const uint64_t fb_hash = hash(sys->vdg.rgba8_buffer, sizeof(pixels));
+        const uint64_t ram_hash = hash(sys->ram, sizeof(sys->ram));
+        if (i == 0) {
+            res->fb_hash = fb_hash;
+            res->ram_hash = ram_hash;
+        }
+        else if ((fb_hash != res->fb_hash) || (ram_hash != res->ram_hash)) {
+            same = false;
+        }
+    }
+    spc1000_farm_discard(&farm);
+    free(tapes);
+    free(bf.scripts);
+    return same;
+}
+
+/* name of the first part of the machine state that differs, or 0 */
+static const char* state_diff(spc1000_t* a, spc1000_t* b) {
+    if (a->tick_count != b->tick_count) {
+        return "tick_count";
+    }
+    if ((a->cpu.bc_de_hl_fa != b->cpu.bc_de_hl_fa) ||
+        (a->cpu.bc_de_hl_fa_ != b->cpu.bc_de_hl_fa_) ||
+        (a->cpu.wz_ix_iy_sp != b->cpu.wz_ix_iy_sp) ||
+        (a->cpu.im_ir_pc_bits != b->cpu.im_ir_pc_bits))
+    {
+        return "cpu registers";
+    }
+    if (0 != memcmp(a->ram, b->ram, sizeof(a->ram))) {
+        return "ram";
+    }
+    if (0 != memcmp(a->vram, b->vram, sizeof(a->vram))) {
+        return "vram";
+    }
+    if (0 != memcmp(a->vdg.rgba8_buffer, b->vdg.rgba8_buffer, sizeof(pixels))) {
+        return "framebuffer";
+    }
+    return 0;
+}
+
+/*  run a workload with and without the CPU and video fast paths in lockstep,
+    returns the first frame after which the states differ, or -1
+*/
+static int run_verify(const bench_workload_t* wl, const spc1000_tape_t* tape_image, uint8_t devices_off, const char** what) {
+    spc1000_desc_t desc = bench_desc(wl);
+    spc1000_init(&spc1000, &desc);
+    jit_start(&spc1000);
+    desc.pixel_buffer = ref_pixels;
+    desc.pixel_buffer_size = sizeof(ref_pixels);
+    spc1000_init(&spc1000_ref, &desc);
+    spc1000_set_cpu_fast_path(&spc1000_ref, false);
+    spc1000_set_cpu_block_cache(&spc1000_ref, false);
+    spc1000_ref.vdg.dirty_tracking = false;
+    spc1000_ref.vdg.vram = 0;
+    spc1000_tape_t tape, ref_tape;
+    if (tape_image) {
+        tape = *tape_image;
+        ref_tape = *tape_image;
+        spc1000_attach_tape(&spc1000, &tape);
+        spc1000_attach_tape(&spc1000_ref, &ref_tape);
+    }
+    spc1000_disable_devices(&spc1000, devices_off);
+    spc1000_disable_devices(&spc1000_ref, devices_off);
+
+    bench_script_t script, ref_script;
+    script_init(&script, wl, &spc1000);
+    script_init(&ref_script, wl, &spc1000_ref);
+    int bad_frame = -1;
+    *what = 0;
+    for (int frame = 0; frame < wl->num_frames; frame++) {
+        script_frame(&script, &spc1000, frame);
+        script_frame(&ref_script, &spc1000_ref, frame);
+        spc1000_exec(&spc1000, FRAME_US);
+        spc1000_exec(&spc1000_ref, FRAME_US);
+        if ((*what = state_diff(&spc1000, &spc1000_ref))) {
+            bad_frame = frame;
+            break;
+        }
+    }
+    jit_stop(&spc1000);
+    spc1000_discard(&spc1000_ref);
+    spc1000_discard(&spc1000);
+    return bad_frame;
+}
+
+/* run a workload several times and keep the fastest run */
+static void run_best(const bench_workload_t* wl, const spc1000_tape_t* tape, uint8_t devices_off, int repeat, bench_result_t* res) {
+    for (int i = 0; i < repeat; i++) {
+        bench_result_t r;
+        run(wl, tape, devices_off, &r);
+        if ((i == 0) || (r.wall < res->wall)) {
+            *res = r;
+        }
+    }
+}
+
+static double ns_per_tick(const bench_result_t* res) {
+    return (res->ticks > 0) ? (res->wall * 1e9 / res->ticks) : 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    const char* roms_dir = arg(argc, argv, "roms");
+    const char* only = arg(argc, argv, "workload");
+    const char* repeat_arg = arg(argc, argv, "repeat");
+    const char* json_path = arg(argc, argv, "json");
+    const char* instances_arg = arg(argc, argv, "instances");
+    const char* threads_arg = arg(argc, argv, "threads");
+    const int repeat = (repeat_arg && (atoi(repeat_arg) > 0)) ? atoi(repeat_arg) : 3;
+    const int num_instances = instances_arg ? atoi(instances_arg) : 0;
+    int num_threads = threads_arg ? atoi(threads_arg) : 0;
+    if (num_threads <= 0) {
+        num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    const bool verify = arg_on(argc, argv, "verify");
+    block_cache = arg_on(argc, argv, "blocks");
+    const char* jit_arg = arg(argc, argv, "jit");
+    jit_verify = jit_arg && (0 == strcmp(jit_arg, "verify"));
+    jit = jit_verify || arg_on(argc, argv, "jit");
+    const bool breakdown = !arg_off(argc, argv, "breakdown") && (num_instances <= 0) && !verify;
+    if (!roms_dir) {
+        roms_dir = "roms/spc1000";
+    }
+    if (!json_path) {
+        json_path = "spc1000-bench.json";
+    }
+    uint8_t devices_off = 0;
+    for (int i = 0; i < NUM_DEVICES; i++) {
+        if (arg_off(argc, argv, devices[i].name)) {
+            devices_off |= devices[i].mask;
+        }
+    }
+
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/spcall.rom", roms_dir);
+    int rom_size = 0;
+    uint8_t* rom_data = load_file(path, &rom_size);
+    if (!rom_data || (rom_size != sizeof(rom))) {
+        fprintf(stderr, "failed to load '%s' (must be %d bytes)\n", path, (int)sizeof(rom));
+        return 10;
+    }
+    memcpy(rom, rom_data, sizeof(rom));
+    free(rom_data);
+
+    FILE* fp = fopen(json_path, "w");
+    if (!fp) {
+        fprintf(stderr, "failed to write '%s'\n", json_path);
+        return 10;
+    }
+    fprintf(fp, "{\n  \"repeat\": %d,\n  \"block_cache\": %s,\n  \"jit\": \"%s\",\n  \"workloads\": [",
+        repeat, block_cache ? "true" : "false", jit_verify ? "verify" : (jit ? "on" : "off"));
+
+    if (verify) {
+        printf("%-12s %8s   %s\n", "workload", "frames", "fast path vs. interpreter");
+    }
+    else if (num_instances > 0) {
+        printf("%-12s %9s %8s %10s %10s %8s\n", "workload", "instances", "threads", "MHz(1)", "MHz(n)", "scaling");
+    }
+    else {
+        printf("%-12s %8s %10s %8s %8s   %s\n", "workload", "frames", "MHz", "fps", "ns/tick", "cpu/vdg/ay/beeper/tape/other ns/tick");
+    }
+    int num_runs = 0;
+    int num_failed = 0;
+    for (int wi = 0; wi < NUM_WORKLOADS; wi++) {
+        const bench_workload_t* wl = &workloads[wi];
+        if (only && (0 != strcmp(only, wl->name))) {
+            continue;
+        }
+        spc1000_tape_t* tape = 0;
+        if (wl->tape) {
+            snprintf(path, sizeof(path), "%s/%s", roms_dir, wl->tape);
+            int tape_size = 0;
+            uint8_t* tape_data = load_file(path, &tape_size);
+            tape = tape_data ? spc1000_tape_create(tape_data, tape_size) : 0;
+            free(tape_data);
+            if (!tape) {
+                fprintf(stderr, "failed to load tape '%s'\n", path);
+                return 10;
+            }
+        }
+
+        if (verify) {
+            const char* what = 0;
+            const int bad_frame = run_verify(wl, tape, devices_off, &what);
+            if (tape) {
+                spc1000_tape_destroy(tape);
+            }
+            if (bad_frame < 0) {
+                printf("%-12s %8d   ok\n", wl->name, wl->num_frames);
+            }
+            else {
+                printf("%-12s %8d   %s differs after frame %d\n", wl->name, wl->num_frames, what, bad_frame);
+                num_failed++;
+            }
+            fprintf(fp, "%s\n    {\n", (num_runs++ > 0) ? "," : "");
+            fprintf(fp, "      \"name\": \"%s\",\n", wl->name);
+            fprintf(fp, "      \"frames\": %d,\n", wl->num_frames);
+            fprintf(fp, "      \"verified\": %s", (bad_frame < 0) ? "true" : "false");
+            if (bad_frame >= 0) {
+                fprintf(fp, ",\n      \"differs\": \"%s\",\n", what);
+                fprintf(fp, "      \"frame\": %d", bad_frame);
+            }
+            fprintf(fp, "\n    }");
+            continue;
+        }
+
+        if (num_instances > 0) {
+            /* best of n for one thread and for all threads */
+            bench_result_t single = {0}, multi = {0};
+            bool same = true;
+            for (int i = 0; i < repeat; i++) {
+                bench_result_t r;
+                same &= run_farm(wl, tape, devices_off, num_instances, 1, &r);
+                if ((i == 0) || (r.wall < single.wall)) {
+                    single = r;
+                }
+                same &= run_farm(wl, tape, devices_off, num_instances, num_threads, &r);
+                if ((i == 0) || (r.wall < multi.wall)) {
+                    multi = r;
+                }
+            }
+            if (tape) {
+                spc1000_tape_destroy(tape);
+            }
+            const double mhz_single = single.ticks / single.wall / 1e6;
+            const double mhz = multi.ticks / multi.wall / 1e6;
+            printf("%-12s %9d %8d %10.2f %10.2f %7.2fx%s\n",
+                wl->name, num_instances, num_threads, mhz_single, mhz, mhz / mhz_single,
+                same ? "" : "   (instances differ!)");
+            fprintf(fp, "%s\n    {\n", (num_runs++ > 0) ? "," : "");
+            fprintf(fp, "      \"name\": \"%s\",\n", wl->name);
+            fprintf(fp, "      \"instances\": %d,\n", num_instances);
+            fprintf(fp, "      \"threads\": %d,\n", num_threads);
+            fprintf(fp, "      \"frames\": %d,\n", multi.frames);
+            fprintf(fp, "      \"ticks\": %llu,\n", (unsigned long long)multi.ticks);
+            fprintf(fp, "      \"wall_sec_single\": %.6f,\n", single.wall);
+            fprintf(fp, "      \"wall_sec\": %.6f,\n", multi.wall);
+            fprintf(fp, "      \"mhz_single\": %.3f,\n", mhz_single);
+            fprintf(fp, "      \"mhz\": %.3f,\n", mhz);
+            fprintf(fp, "      \"scaling\": %.3f,\n", mhz / mhz_single);
+            fprintf(fp, "      \"deterministic\": %s,\n", same ? "true" : "false");
+            fprintf(fp, "      \"fb_hash\": \"%016llx\",\n", (unsigned long long)multi.fb_hash);
+            fprintf(fp, "      \"ram_hash\": \"%016llx\"\n    }", (unsigned long long)multi.ram_hash);
+            continue;
+        }
+
+        bench_result_t res;
+        run_best(wl, tape, devices_off, repeat, &res);
+        const double ns = ns_per_tick(&res);
+
+        /* device costs are the difference to the run with that device switched off */
+        double cost[NUM_DEVICES] = { 0 };
+        double cpu = ns;
+        if (breakdown) {
+            bench_result_t r;
+            run_best(wl, tape, ALL_DEVICES, repeat, &r);
+            cpu = ns_per_tick(&r);
+            for (int di = 0; di < NUM_DEVICES; di++) {
+                if (0 == (devices_off & devices[di].mask)) {
+                    run_best(wl, tape, devices_off | devices[di].mask, repeat, &r);
+                    cost[di] = ns - ns_per_tick(&r);
+                }
+            }
+        }
+        double other = ns - cpu;
+        for (int di = 0; di < NUM_DEVICES; di++) {
+            other -= cost[di];
+        }
+        if (tape) {
+            spc1000_tape_destroy(tape);
+        }
+
+        const double mhz = res.ticks / res.wall / 1e6;
+        const double fps = res.frames / res.wall;
+        printf("%-12s %8d %10.2f %8.1f %8.3f   %.3f/%.3f/%.3f/%.3f/%.3f/%.3f\n",
+            wl->name, res.frames, mhz, fps, ns, cpu, cost[0], cost[1], cost[2], cost[3], other);
+
+        fprintf(fp, "%s\n    {\n", (num_runs++ > 0) ? "," : "");
+        fprintf(fp, "      \"name\": \"%s\",\n", wl->name);
+        fprintf(fp, "      \"frames\": %d,\n", res.frames);
+        fprintf(fp, "      \"ticks\": %llu,\n", (unsigned long long)res.ticks);
+        fprintf(fp, "      \"wall_sec\": %.6f,\n", res.wall);
+        fprintf(fp, "      \"mhz\": %.3f,\n", mhz);
+        fprintf(fp, "      \"fps\": %.3f,\n", fps);
+        fprintf(fp, "      \"ns_per_tick\": %.4f,\n", ns);
+        fprintf(fp, "      \"fb_hash\": \"%016llx\",\n", (unsigned long long)res.fb_hash);
+        fprintf(fp, "      \"ram_hash\": \"%016llx\",\n", (unsigned long long)res.ram_hash);
+        fprintf(fp, "      \"devices\": {");
+        for (int di = 0; di < NUM_DEVICES; di++) {
+            fprintf(fp, "%s \"%s\": %s", di ? "," : "", devices[di].name, (devices_off & devices[di].mask) ? "false" : "true");
+        }
+        fprintf(fp, " }");
+        if (breakdown) {
+            fprintf(fp, ",\n      \"breakdown_ns_per_tick\": { \"cpu\": %.4f", cpu);
+            for (int di = 0; di < NUM_DEVICES; di++) {
+                fprintf(fp, ", \"%s\": %.4f", devices[di].name, cost[di]);
+            }
+            fprintf(fp, ", \"other\": %.4f }", other);
+        }
+        fprintf(fp, "\n    }");
+    }
+    fprintf(fp, "\n  ]");
+    if (jit_verify) {
+        fprintf(fp, ",\n  \"jit_checked\": %u,\n  \"jit_mismatches\": %u", jit_checked, jit_mismatches);
+    }
+    fprintf(fp, "\n}\n");
+    fclose(fp);
+    if (0 == num_runs) {
+        fprintf(stderr, "unknown workload '%s'\n", only);
+        return 10;
+    }
+    if (jit_unsupported) {
+        fprintf(stderr, "the recompiler isn't supported on this host, the runs used the interpreter\n");
+    }
+    if (jit_verify) {
+        printf("jit: %u blocks checked, %u mismatches\n", jit_checked, jit_mismatches);
+        if (jit_mismatches > 0) {
+            fprintf(stderr, "first mismatch in the block at %04X\n", jit_mismatch_pc);
+            num_failed++;
+        }
+    }
+    return (num_failed > 0) ? 1 : 0;
+}
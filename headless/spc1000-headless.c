@@ -0,0 +1,369 @@
+/*
+    spc1000-headless.c
+
+    Runs the SPC-1000 emulation without any display, audio or input
+    backend, as fast as the host allows. Only depends on the chips
+    headers and systems/spc1000.h.
+
+    Usage:
+        spc1000-headless [rom=file] [file=tape] [frames=n] [ticks=n]
+                         [input=text] [fastload=on] [ppm=file] [wav=file]
+                         [load=file] [save=file] [idle=skip] [blocks=on]
+                         [jit=on|verify]
+                         [video=indexed|external]
+                         [capture=file] [capture_format=y4m|raw]
+                         [capture_audio=file] [capture_buffers=n]
+
+        rom         the system ROM (default: roms/spc1000/spcall.rom)
+        file        a TAP or CAS tape image to insert
+        frames      number of 60 Hz frames to run (default: 600)
+        ticks       run for this many CPU ticks instead of a frame count
+        input       text typed into the keyboard after boot, '\n' is Return
+        fastload    load tape blocks instantly through the ROM traps
+        ppm         write the final framebuffer as PPM image
+        wav         write the generated audio as 16-bit mono WAV
+        load        resume from a save state (insert the same tape)
+        save        write a save state at the end of the run
+        idle        skip ahead to the next frame while BASIC waits for a key
+        blocks      run the CPU from predecoded basic blocks
+        jit         translate the blocks into native code (x86-64 only),
+                    verify compares each block run with the interpreter
+        video       decode 8-bit color indices instead of RGBA8 pixels, or
+                    only track the line modes for an external decoder
+                    (like video=gpu in the emulator, no ppm output)
+        capture     record every frame into a Y4M file, or as raw RGBA8
+                    frames (capture_format=raw) into a file or named pipe,
+                    written on a background thread (RGBA8 video only)
+        capture_audio   record the audio into a WAV file while running
+        capture_buffers number of queued capture frames before frames
+                    are dropped (default: 16)
+
+    Timing stats are written to stdout.
+*/
+#define CHIPS_IMPL
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "chips/z80.h"
+#include "chips/mc6847.h"
+#include "chips/beeper.h"
+#include "chips/ay38910.h"
+#include "chips/kbd.h"
+#include "chips/clk.h"
+#include "chips/mem.h"
+#include "systems/spc1000.h"
+#include "util/audio_ring.h"
+#include "util/capture.h"
+
+#define CPU_FREQUENCY (4000000)
+#define FRAME_US (16667)
+#define AUDIO_SAMPLE_RATE (44100)
+#define INPUT_START_FRAME (120)     /* wait for the BASIC prompt before typing */
+#define INPUT_KEY_FRAMES (6)        /* frames between two typed keys */
+
+static spc1000_t spc1000;
+static uint32_t pixels[MC6847_DISPLAY_WIDTH * MC6847_DISPLAY_HEIGHT];
+static uint8_t rom[0x8000];
+static capture_t capture;
+static bool capturing;
+
+/* audio samples collected from the audio callback */
+static struct {
+    float* samples;
+    int num;
+    int cap;
+} audio;
+
+static void push_audio(const float* samples, int num_samples, void* user_data) {
+    (void)user_data;
+    if ((audio.num + num_samples) > audio.cap) {
+        audio.cap = (audio.cap == 0) ? (1<<20) : (audio.cap * 2);
+        audio.samples = (float*) realloc(audio.samples, audio.cap * sizeof(float));
+    }
+    memcpy(audio.samples + audio.num, samples, num_samples * sizeof(float));
+    audio.num += num_samples;
+    if (capturing) {
+        capture_audio(&capture, samples, num_samples);
+    }
+}
+
+/* key=value command line arguments, like sokol_args in the frontend */
+static const char* arg(int argc, char* argv[], const char* key) {
+    const size_t len = strlen(key);
+    for (int i = 1; i < argc; i++) {
+        if ((0 == strncmp(argv[i], key, len)) && (argv[i][len] == '=')) {
+            return &argv[i][len+1];
+        }
+    }
+    return 0;
+}
+
+static uint8_t* load_file(const char* path, int* out_size) {
+    FILE* fp = fopen(path, "rb");
+    if (!fp) {
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    int size = (int) ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uint8_t* buf = (uint8_t*) malloc(size > 0 ? size : 1);
+    if (fread(buf, 1, size, fp) != (size_t)size) {
+        free(buf);
+        buf = 0;
+    }
+    fclose(fp);
+    *out_size = size;
+    return buf;
+}
+
+static bool write_ppm(const char* path) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    const int w = spc1000_display_width(&spc1000);
+    const int h = spc1000_display_height(&spc1000);
+    fprintf(fp, "P6\n%d %d\n255\n", w, h);
+    uint32_t colors[MC6847_NUM_COLORS];
+    mc6847_colors(&spc1000.vdg, colors);
+    for (int i = 0; i < w * h; i++) {
+        /* RGBA8 framebuffer, R in the lowest byte */
+        const uint32_t c = spc1000.vdg.index8_buffer ? colors[spc1000.vdg.index8_buffer[i]] : pixels[i];
+        const uint8_t rgb[3] = { (uint8_t)c, (uint8_t)(c>>8), (uint8_t)(c>>16) };
+        fwrite(rgb, 1, 3, fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+static void put_u32(FILE* fp, uint32_t v) {
+    const uint8_t b[4] = { (uint8_t)v, (uint8_t)(v>>8), (uint8_t)(v>>16), (uint8_t)(v>>24) };
+    fwrite(b, 1, 4, fp);
+}
+
+static void put_u16(FILE* fp, uint16_t v) {
+    const uint8_t b[2] = { (uint8_t)v, (uint8_t)(v>>8) };
+    fwrite(b, 1, 2, fp);
+}
+
+static bool write_wav(const char* path) {
+    FILE* fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    const uint32_t data_size = audio.num * 2;
+    fwrite("RIFF", 1, 4, fp); put_u32(fp, 36 + data_size);
+    fwrite("WAVEfmt ", 1, 8, fp); put_u32(fp, 16);
+    put_u16(fp, 1);                         /* PCM */
+    put_u16(fp, 1);                         /* mono */
+    put_u32(fp, AUDIO_SAMPLE_RATE);
+    put_u32(fp, AUDIO_SAMPLE_RATE * 2);     /* bytes per second */
+    put_u16(fp, 2);                         /* block align */
+    put_u16(fp, 16);                        /* bits per sample */
+    fwrite("data", 1, 4, fp); put_u32(fp, data_size);
+    for (int i = 0; i < audio.num; i++) {
+        float s = audio.samples[i];
+        s = (s > 1.0f) ? 1.0f : ((s < -1.0f) ? -1.0f : s);
+        put_u16(fp, (uint16_t)(int16_t)(s * 32767.0f));
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool write_state(const char* path) {
+    const int size = spc1000_save_state(&spc1000, 0, 0);
+    uint8_t* buf = (uint8_t*) malloc(size);
+    spc1000_save_state(&spc1000, buf, size);
+    FILE* fp = fopen(path, "wb");
+    const bool ok = fp && (fwrite(buf, 1, size, fp) == (size_t)size);
+    if (fp) {
+        fclose(fp);
+    }
+    free(buf);
+    return ok;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[]) {
+    const char* rom_path = arg(argc, argv, "rom");
+    const char* tape_path = arg(argc, argv, "file");
+    const char* frames_arg = arg(argc, argv, "frames");
+    const char* ticks_arg = arg(argc, argv, "ticks");
+    const char* input = arg(argc, argv, "input");
+    const char* fastload = arg(argc, argv, "fastload");
+    const char* ppm_path = arg(argc, argv, "ppm");
+    const char* wav_path = arg(argc, argv, "wav");
+    const char* load_path = arg(argc, argv, "load");
+    const char* save_path = arg(argc, argv, "save");
+    const char* idle = arg(argc, argv, "idle");
+    const char* blocks = arg(argc, argv, "blocks");
+    const char* jit = arg(argc, argv, "jit");
+    const char* video = arg(argc, argv, "video");
+    const char* capture_path = arg(argc, argv, "capture");
+    const char* capture_format = arg(argc, argv, "capture_format");
+    const char* capture_audio_path = arg(argc, argv, "capture_audio");
+    const char* capture_buffers = arg(argc, argv, "capture_buffers");
+    const int num_frames = frames_arg ? atoi(frames_arg) : 600;
+    const uint64_t num_ticks = ticks_arg ? strtoull(ticks_arg, 0, 10) : 0;
+
+    if (ppm_path && video && (0 == strcmp(video, "external"))) {
+        fprintf(stderr, "video=external doesn't decode pixels, can't write '%s'\n", ppm_path);
+        return 10;
+    }
+    if (capture_path && video) {
+        fprintf(stderr, "capture needs RGBA8 video, can't use video=%s\n", video);
+        return 10;
+    }
+
+    int rom_size = 0;
+    uint8_t* rom_data = load_file(rom_path ? rom_path : "roms/spc1000/spcall.rom", &rom_size);
+    if (!rom_data || (rom_size != sizeof(rom))) {
+        fprintf(stderr, "failed to load ROM (must be %d bytes)\n", (int)sizeof(rom));
+        return 10;
+    }
+    memcpy(rom, rom_data, sizeof(rom));
+    free(rom_data);
+
+    spc1000_init(&spc1000, &(spc1000_desc_t){
+        .type = SPC1000,
+        .pixel_buffer = pixels,
+        .pixel_buffer_size = sizeof(pixels),
+        .pixel_index8 = video && (0 == strcmp(video, "indexed")),
+        .external_decode = video && (0 == strcmp(video, "external")),
+        .audio_cb = push_audio,
+        .audio_sample_rate = AUDIO_SAMPLE_RATE,
+        .rom_spc1000 = rom,
+        .rom_spc1000_size = sizeof(rom),
+        .tape_fastload = fastload && (0 == strcmp(fastload, "on")),
+        .idle_skip = idle && (0 == strcmp(idle, "skip")),
+        .cpu_block_cache = blocks && (0 == strcmp(blocks, "on")),
+    });
+    if (tape_path) {
+        int tape_size = 0;
+        uint8_t* tape_data = load_file(tape_path, &tape_size);
+        if (!tape_data || !spc1000_insert_tape(&spc1000, tape_data, tape_size)) {
+            fprintf(stderr, "failed to load tape '%s'\n", tape_path);
+            return 10;
+        }
+        free(tape_data);
+    }
+    if (load_path) {
+        int state_size = 0;
+        uint8_t* state = load_file(load_path, &state_size);
+        if (!state || !spc1000_load_state(&spc1000, state, state_size)) {
+            fprintf(stderr, "failed to load state '%s'\n", load_path);
+            return 10;
+        }
+        free(state);
+    }
+    if (jit && !spc1000_set_cpu_jit(&spc1000, true, 0 == strcmp(jit, "verify"))) {
+        fprintf(stderr, "the recompiler isn't supported on this host, running the interpreter\n");
+    }
+
+    if (capture_path || capture_audio_path) {
+        capture_start(&capture, &(capture_desc_t){
+            .width = spc1000_display_width(&spc1000),
+            .height = spc1000_display_height(&spc1000),
+            .fps = 60,
+            .format = (capture_format && (0 == strcmp(capture_format, "raw"))) ? CAPTURE_RAW : CAPTURE_Y4M,
+            .video_path = capture_path,
+            .audio_path = capture_audio_path,
+            .sample_rate = AUDIO_SAMPLE_RATE,
+            .num_buffers = capture_buffers ? atoi(capture_buffers) : 0,
+        });
+        capturing = true;
+    }
+
+    /* run as fast as possible, type the input text one key every few frames */
+    uint64_t ticks = 0;
+    int frame = 0;
+    int input_pos = 0;
+    int changed_frames = 0;
+    uint32_t change_count = spc1000.vdg.change_count;
+    const double start = now_sec();
+    while (num_ticks ? (ticks < num_ticks) : (frame < num_frames)) {
+        const uint32_t tick_count = spc1000.tick_count;
+        int key = 0;
+        if (input && input[input_pos] && (frame >= INPUT_START_FRAME) && (0 == (frame % INPUT_KEY_FRAMES))) {
+            key = (input[input_pos] == '\n') ? 0x0D : input[input_pos];
+            input_pos++;
+            spc1000_key_down(&spc1000, key);
+        }
+        spc1000_exec(&spc1000, FRAME_US);
+        if (key) {
+            spc1000_key_up(&spc1000, key);
+        }
+        ticks += (uint32_t)(spc1000.tick_count - tick_count);
+        const bool changed = spc1000.vdg.change_count != change_count;
+        if (changed) {
+            change_count = spc1000.vdg.change_count;
+            changed_frames++;
+        }
+        if (capturing && capture_path) {
+            /* unchanged frames are repeated by the writer without a copy */
+            capture_video(&capture, changed ? pixels : 0);
+        }
+        frame++;
+    }
+    const double wall = now_sec() - start;
+    int res = 0;
+    if (capturing) {
+        capture_stop(&capture);
+        capturing = false;
+    }
+
+    const double emu_sec = (double)ticks / CPU_FREQUENCY;
+    printf("frames:    %d\n", frame);
+    printf("ticks:     %llu\n", (unsigned long long)ticks);
+    printf("emulated:  %.3f s\n", emu_sec);
+    printf("wall:      %.3f s\n", wall);
+    if (wall > 0.0) {
+        printf("speed:     x%.2f (%.2f MHz, %.2f ns/tick)\n", emu_sec / wall, ticks / wall / 1e6, wall * 1e9 / ticks);
+    }
+    printf("changed:   %d frames\n", changed_frames);
+    printf("samples:   %d\n", audio.num);
+    if (spc1000.idle_skip && (ticks > 0)) {
+        printf("idle:      %.1f %% skipped\n", 100.0 * spc1000.idle_ticks / ticks);
+    }
+    if (spc1000.tape) {
+        printf("tape:      %d / %d bits\n", spc1000.tape->pos, spc1000.tape->size);
+    }
+    if (spc1000.cpu_blocks.jit_verify) {
+        printf("jit:       %u blocks checked, %u mismatches\n", spc1000.cpu_blocks.jit_checked, spc1000.cpu_blocks.jit_mismatches);
+        if (spc1000.cpu_blocks.jit_mismatches > 0) {
+            fprintf(stderr, "first mismatch in the block at %04X\n", spc1000.cpu_blocks.jit_mismatch_pc);
+            res = 1;
+        }
+    }
+    if (capture_path || capture_audio_path) {
+        capture_stats_t stats;
+        capture_stats(&capture, &stats);
+        printf("capture:   %u frames, %u dropped, %u samples dropped\n",
+            stats.written_frames, stats.dropped_frames, stats.dropped_samples);
+        if (stats.error) {
+            fprintf(stderr, "failed to write capture output\n");
+            res = 10;
+        }
+    }
+    if (ppm_path && !write_ppm(ppm_path)) {
+        fprintf(stderr, "failed to write '%s'\n", ppm_path);
+        res = 10;
+    }
+    if (wav_path && !write_wav(wav_path)) {
+        fprintf(stderr, "failed to write '%s'\n", wav_path);
+        res = 10;
+    }
+    if (save_path && !write_state(save_path)) {
+        fprintf(stderr, "failed to write '%s'\n", save_path);
+        res = 10;
+    }
+    spc1000_discard(&spc1000);
+    free(audio.samples);
+    return res;
+}
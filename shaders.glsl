@@ -0,0 +1,206 @@
+//------------------------------------------------------------------------------
+//  shaders.glsl
+//
+//  Source for shaders.glsl.h, after changing this file regenerate the
+//  header with 'make shaders' (needs sokol-shdc from sokol-tools in the path).
+//------------------------------------------------------------------------------
+
+//  upscale the emulator framebuffer into an offscreen render target
+@vs upscale_vs
+in vec2 in_pos;
+in vec2 in_uv;
+out vec2 uv;
+void main() {
+    gl_Position = vec4(in_pos*2.0-1.0, 0.5, 1.0);
+    uv = in_uv;
+}
+@end
+
+@fs upscale_fs
+uniform sampler2D tex;
+in vec2 uv;
+out vec4 frag_color;
+void main() {
+    frag_color = texture(tex, uv);
+}
+@end
+
+@program upscale upscale_vs upscale_fs
+
+//  draw the upscaled framebuffer to the display with a scanline mask
+@vs display_vs
+in vec2 in_pos;
+in vec2 in_uv;
+out vec2 uv;
+void main() {
+    gl_Position = vec4(in_pos*2.0-1.0, 0.5, 1.0);
+    uv = in_uv;
+}
+@end
+
+@fs display_fs
+uniform sampler2D tex;
+in vec2 uv;
+out vec4 frag_color;
+
+float fmin = 0.7;
+
+vec3 calc_mask() {
+    return vec3(fmin + (1.0 - fmin) * (mod(gl_FragCoord.y, 0.8) * 2.0));
+}
+
+void main() {
+    frag_color = vec4(texture(tex, uv).xyz * calc_mask(), 2.0);
+}
+@end
+
+@program display display_vs display_fs
+
+//  upscale an 8-bit indexed framebuffer (MC6847 color indices 0..15)
+//  through a 16x1 RGBA8 palette texture
+@vs upscale_indexed_vs
+in vec2 in_pos;
+in vec2 in_uv;
+out vec2 uv;
+void main() {
+    gl_Position = vec4(in_pos*2.0-1.0, 0.5, 1.0);
+    uv = in_uv;
+}
+@end
+
+@fs upscale_indexed_fs
+uniform sampler2D tex;
+uniform sampler2D pal;
+in vec2 uv;
+out vec4 frag_color;
+void main() {
+    // the R8 texel is index/255, sample the center of palette texel 'index'
+    frag_color = texture(pal, vec2(texture(tex, uv).x * (255.0/16.0) + (0.5/16.0), 0.5));
+}
+@end
+
+@program upscale_indexed upscale_indexed_vs upscale_indexed_fs
+
+//  decode a MC6847 field from mc6847_frame_data() (see 'External decoding'
+//  in chips/mc6847.h), uploaded as a 256x38 R8 texture, into color indices
+//  looked up in the palette texture; integer math is done on floats, which
+//  is exact for the small values here, GLSL ES 1.0 has no integer ops
+@vs mc6847_vs
+in vec2 in_pos;
+in vec2 in_uv;
+out vec2 uv;
+void main() {
+    gl_Position = vec4(in_pos*2.0-1.0, 0.5, 1.0);
+    uv = in_uv;
+}
+@end
+
+@fs mc6847_fs
+uniform sampler2D frame;
+uniform sampler2D pal;
+in vec2 uv;
+out vec4 frag_color;
+
+float idiv(float a, float b) {
+    return floor((a + 0.5) / b);
+}
+
+float imod(float a, float b) {
+    return a - b * idiv(a, b);
+}
+
+// test the bit with value p (a power of two)
+float bit(float v, float p) {
+    return imod(idiv(v, p), 2.0);
+}
+
+float pow2(float n) {
+    return floor(exp2(n) + 0.5);
+}
+
+// read a byte of the frame data
+float fetch(float addr) {
+    return floor(texture(frame, vec2((imod(addr, 256.0) + 0.5) * (1.0/256.0), (idiv(addr, 256.0) + 0.5) * (1.0/38.0))).x * 255.0 + 0.5);
+}
+
+void main() {
+    // 320x243 framebuffer, the display area starts at 32,25
+    float x = floor(uv.x * 320.0) - 32.0;
+    float y = floor(uv.y * 243.0);
+    // MC6847_FRAME_LINES: control pins at the start of the line
+    float ctrl = fetch(9472.0 + y);
+    float ag = bit(ctrl, 1.0);
+    float css = bit(ctrl, 128.0);
+    // border color
+    float color = (ag > 0.5) ? css * 4.0 : 8.0;
+    y -= 25.0;
+    if (x >= 0.0 && x < 256.0 && y >= 0.0 && y < 192.0) {
+        if (ag > 0.5) {
+            float gm1 = bit(ctrl, 32.0);
+            float gm2 = bit(ctrl, 64.0);
+            if (bit(ctrl, 16.0) > 0.5) {
+                // GM0 set: 1 bit per pixel (CG1/RG1..RG6)
+                float row_height = (gm2 > 0.5) ? 1.0 : ((gm1 > 0.5) ? 2.0 : 3.0);
+                float wide = (gm1 + gm2 < 1.5) ? 2.0 : 1.0;
+                float m = fetch(idiv(y, row_height) * (32.0 / wide) + idiv(x, 8.0 * wide));
+                color = (bit(m, pow2(7.0 - idiv(imod(x, 8.0 * wide), wide))) > 0.5) ? css * 4.0 : 8.0;
+            }
+            else {
+                // GM0 clear: 2 bits per pixel (CG2..CG6)
+                float row_height = (gm2 > 0.5) ? ((gm1 > 0.5) ? 1.0 : 2.0) : 3.0;
+                float wide = (gm1 + gm2 < 0.5) ? 2.0 : 1.0;
+                float m = fetch(idiv(y, row_height) * (32.0 / wide) + idiv(x, 8.0 * wide));
+                color = css * 4.0 + imod(idiv(m, pow2(6.0 - 2.0 * idiv(imod(x, 8.0 * wide), 2.0 * wide))), 4.0);
+            }
+        }
+        else {
+            // alphanumeric and semigraphics cells of 8x12 pixels
+            float chr_y = imod(y, 12.0);
+            float addr = idiv(y, 12.0) * 32.0 + idiv(x, 8.0);
+            float cx = imod(x, 8.0);
+            float chr = fetch(addr);
+            // MC6847_FRAME_CELLS: the cell's INV, CSS, INT/EXT and AS pins
+            float cell = fetch(8192.0 + addr);
+            float intext = bit(cell, 4.0);
+            if (bit(cell, 2.0) > 0.5) {
+                // semigraphics 6 (INT/EXT set) or 4
+                float m;
+                float fg;
+                if (intext > 0.5) {
+                    m = imod(idiv(chr, (chr_y < 3.5) ? 16.0 : ((chr_y < 7.5) ? 4.0 : 1.0)), 4.0);
+                    fg = idiv(chr, 64.0) + bit(cell, 128.0) * 4.0;
+                }
+                else {
+                    m = imod(idiv(chr, (chr_y < 5.5) ? 4.0 : 1.0), 4.0);
+                    fg = imod(idiv(chr, 16.0), 8.0);
+                }
+                color = (bit(m, (cx < 3.5) ? 2.0 : 1.0) > 0.5) ? fg : 8.0;
+            }
+            else {
+                // external font at VRAM 0x1000 (codes above 223 are used as pixels),
+                // or the internal font at MC6847_FRAME_FONT
+                float m;
+                if (intext > 0.5) {
+                    m = (chr > 223.5) ? chr : fetch(4096.0 + imod(chr, 128.0) * 16.0 + chr_y);
+                }
+                else {
+                    m = fetch(8704.0 + imod(chr, 64.0) * 12.0 + chr_y);
+                }
+                if (bit(cell, 8.0) > 0.5) {
+                    m = 255.0 - m;
+                }
+                if (bit(m, pow2(7.0 - cx)) > 0.5) {
+                    color = (css > 0.5) ? 11.0 : 9.0;
+                }
+                else {
+                    color = (css > 0.5) ? 12.0 : 10.0;
+                }
+            }
+        }
+    }
+    // 16x1 palette texture, MC6847_COLOR_* indices
+    frag_color = texture(pal, vec2(color * (1.0/16.0) + (0.5/16.0), 0.5));
+}
+@end
+
+@program mc6847 mc6847_vs mc6847_fs
@@ -28,11 +28,41 @@
                     Type: SG_IMAGETYPE_2D
                     Bind slot: SLOT_tex = 0
 
+        Shader program 'upscale_indexed':
+            Get shader desc: upscale_indexed_shader_desc()
+            Vertex shader: upscale_indexed_vs
+                Attribute slots:
+                    ATTR_upscale_indexed_vs_in_pos = 0
+                    ATTR_upscale_indexed_vs_in_uv = 1
+            Fragment shader: upscale_indexed_fs
+                Image 'tex':
+                    Type: SG_IMAGETYPE_2D
+                    Bind slot: SLOT_tex = 0
+                Image 'pal':
+                    Type: SG_IMAGETYPE_2D
+                    Bind slot: SLOT_pal = 1
+
+        Shader program 'mc6847':
+            Get shader desc: mc6847_shader_desc()
+            Vertex shader: mc6847_vs
+                Attribute slots:
+                    ATTR_mc6847_vs_in_pos = 0
+                    ATTR_mc6847_vs_in_uv = 1
+            Fragment shader: mc6847_fs
+                Image 'frame':
+                    Type: SG_IMAGETYPE_2D
+                    Bind slot: SLOT_frame = 0
+                Image 'pal':
+                    Type: SG_IMAGETYPE_2D
+                    Bind slot: SLOT_pal = 1
+
 
     Shader descriptor structs:
 
         sg_shader display = sg_make_shader(display_shader_desc());
         sg_shader upscale = sg_make_shader(upscale_shader_desc());
+        sg_shader upscale_indexed = sg_make_shader(upscale_indexed_shader_desc());
+        sg_shader mc6847 = sg_make_shader(mc6847_shader_desc());
 
     Vertex attribute locations for vertex shader 'upscale_vs':
 
@@ -56,9 +86,33 @@
             },
             ...});
 
+    Vertex attribute locations for vertex shader 'upscale_indexed_vs':
+
+        sg_pipeline pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .layout = {
+                .attrs = {
+                    [ATTR_upscale_indexed_vs_in_pos] = { ... },
+                    [ATTR_upscale_indexed_vs_in_uv] = { ... },
+                },
+            },
+            ...});
+
+    Vertex attribute locations for vertex shader 'mc6847_vs':
+
+        sg_pipeline pip = sg_make_pipeline(&(sg_pipeline_desc){
+            .layout = {
+                .attrs = {
+                    [ATTR_mc6847_vs_in_pos] = { ... },
+                    [ATTR_mc6847_vs_in_uv] = { ... },
+                },
+            },
+            ...});
+
     Image bind slots, use as index in sg_bindings.vs_images[] or .fs_images[]
 
         SLOT_tex = 0;
+        SLOT_pal = 1;
+        SLOT_frame = 0;
 
 */
 #include <stdint.h>
@@ -74,7 +128,13 @@
 #define ATTR_upscale_vs_in_uv (1)
 #define ATTR_display_vs_in_pos (0)
 #define ATTR_display_vs_in_uv (1)
+#define ATTR_upscale_indexed_vs_in_pos (0)
+#define ATTR_upscale_indexed_vs_in_uv (1)
+#define ATTR_mc6847_vs_in_pos (0)
+#define ATTR_mc6847_vs_in_uv (1)
 #define SLOT_tex (0)
+#define SLOT_pal (1)
+#define SLOT_frame (0)
 /*
     #version 100
     
@@ -206,6 +266,454 @@ static const char display_fs_source_glsl100[385] = {
     0x61,0x73,0x6b,0x28,0x29,0x2c,0x20,0x32,0x2e,0x30,0x29,0x3b,0x0a,0x7d,0x0a,0x0a,
     0x00,
 };
+/*
+    #version 100
+    
+    attribute vec2 in_pos;
+    varying vec2 uv;
+    attribute vec2 in_uv;
+    
+    void main()
+    {
+        gl_Position = vec4((in_pos * 2.0) - vec2(1.0), 0.5, 1.0);
+        uv = in_uv;
+    }
+    
+*/
+static const char upscale_indexed_vs_source_glsl100[173] = {
+    0x23,0x76,0x65,0x72,0x73,0x69,0x6f,0x6e,0x20,0x31,0x30,0x30,0x0a,0x0a,0x61,0x74,
+    0x74,0x72,0x69,0x62,0x75,0x74,0x65,0x20,0x76,0x65,0x63,0x32,0x20,0x69,0x6e,0x5f,
+    0x70,0x6f,0x73,0x3b,0x0a,0x76,0x61,0x72,0x79,0x69,0x6e,0x67,0x20,0x76,0x65,0x63,
+    0x32,0x20,0x75,0x76,0x3b,0x0a,0x61,0x74,0x74,0x72,0x69,0x62,0x75,0x74,0x65,0x20,
+    0x76,0x65,0x63,0x32,0x20,0x69,0x6e,0x5f,0x75,0x76,0x3b,0x0a,0x0a,0x76,0x6f,0x69,
+    0x64,0x20,0x6d,0x61,0x69,0x6e,0x28,0x29,0x0a,0x7b,0x0a,0x20,0x20,0x20,0x20,0x67,
+    0x6c,0x5f,0x50,0x6f,0x73,0x69,0x74,0x69,0x6f,0x6e,0x20,0x3d,0x20,0x76,0x65,0x63,
+    0x34,0x28,0x28,0x69,0x6e,0x5f,0x70,0x6f,0x73,0x20,0x2a,0x20,0x32,0x2e,0x30,0x29,
+    0x20,0x2d,0x20,0x76,0x65,0x63,0x32,0x28,0x31,0x2e,0x30,0x29,0x2c,0x20,0x30,0x2e,
+    0x35,0x2c,0x20,0x31,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x75,0x76,0x20,
+    0x3d,0x20,0x69,0x6e,0x5f,0x75,0x76,0x3b,0x0a,0x7d,0x0a,0x0a,0x00,
+};
+/*
+    #version 100
+    precision mediump float;
+    precision highp int;
+    
+    uniform highp sampler2D pal;
+    uniform highp sampler2D tex;
+    
+    varying highp vec2 uv;
+    
+    void main()
+    {
+        gl_FragData[0] = texture2D(pal, vec2((texture2D(tex, uv).x * 15.9375) + 0.03125, 0.5));
+    }
+    
+*/
+static const char upscale_indexed_fs_source_glsl100[253] = {
+    0x23,0x76,0x65,0x72,0x73,0x69,0x6f,0x6e,0x20,0x31,0x30,0x30,0x0a,0x70,0x72,0x65,
+    0x63,0x69,0x73,0x69,0x6f,0x6e,0x20,0x6d,0x65,0x64,0x69,0x75,0x6d,0x70,0x20,0x66,
+    0x6c,0x6f,0x61,0x74,0x3b,0x0a,0x70,0x72,0x65,0x63,0x69,0x73,0x69,0x6f,0x6e,0x20,
+    0x68,0x69,0x67,0x68,0x70,0x20,0x69,0x6e,0x74,0x3b,0x0a,0x0a,0x75,0x6e,0x69,0x66,
+    0x6f,0x72,0x6d,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x73,0x61,0x6d,0x70,0x6c,0x65,
+    0x72,0x32,0x44,0x20,0x70,0x61,0x6c,0x3b,0x0a,0x75,0x6e,0x69,0x66,0x6f,0x72,0x6d,
+    0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x73,0x61,0x6d,0x70,0x6c,0x65,0x72,0x32,0x44,
+    0x20,0x74,0x65,0x78,0x3b,0x0a,0x0a,0x76,0x61,0x72,0x79,0x69,0x6e,0x67,0x20,0x68,
+    0x69,0x67,0x68,0x70,0x20,0x76,0x65,0x63,0x32,0x20,0x75,0x76,0x3b,0x0a,0x0a,0x76,
+    0x6f,0x69,0x64,0x20,0x6d,0x61,0x69,0x6e,0x28,0x29,0x0a,0x7b,0x0a,0x20,0x20,0x20,
+    0x20,0x67,0x6c,0x5f,0x46,0x72,0x61,0x67,0x44,0x61,0x74,0x61,0x5b,0x30,0x5d,0x20,
+    0x3d,0x20,0x74,0x65,0x78,0x74,0x75,0x72,0x65,0x32,0x44,0x28,0x70,0x61,0x6c,0x2c,
+    0x20,0x76,0x65,0x63,0x32,0x28,0x28,0x74,0x65,0x78,0x74,0x75,0x72,0x65,0x32,0x44,
+    0x28,0x74,0x65,0x78,0x2c,0x20,0x75,0x76,0x29,0x2e,0x78,0x20,0x2a,0x20,0x31,0x35,
+    0x2e,0x39,0x33,0x37,0x35,0x29,0x20,0x2b,0x20,0x30,0x2e,0x30,0x33,0x31,0x32,0x35,
+    0x2c,0x20,0x30,0x2e,0x35,0x29,0x29,0x3b,0x0a,0x7d,0x0a,0x0a,0x00,
+};
+/*
+    #version 100
+    
+    attribute vec2 in_pos;
+    varying vec2 uv;
+    attribute vec2 in_uv;
+    
+    void main()
+    {
+        gl_Position = vec4((in_pos * 2.0) - vec2(1.0), 0.5, 1.0);
+        uv = in_uv;
+    }
+    
+*/
+static const char mc6847_vs_source_glsl100[173] = {
+    0x23,0x76,0x65,0x72,0x73,0x69,0x6f,0x6e,0x20,0x31,0x30,0x30,0x0a,0x0a,0x61,0x74,
+    0x74,0x72,0x69,0x62,0x75,0x74,0x65,0x20,0x76,0x65,0x63,0x32,0x20,0x69,0x6e,0x5f,
+    0x70,0x6f,0x73,0x3b,0x0a,0x76,0x61,0x72,0x79,0x69,0x6e,0x67,0x20,0x76,0x65,0x63,
+    0x32,0x20,0x75,0x76,0x3b,0x0a,0x61,0x74,0x74,0x72,0x69,0x62,0x75,0x74,0x65,0x20,
+    0x76,0x65,0x63,0x32,0x20,0x69,0x6e,0x5f,0x75,0x76,0x3b,0x0a,0x0a,0x76,0x6f,0x69,
+    0x64,0x20,0x6d,0x61,0x69,0x6e,0x28,0x29,0x0a,0x7b,0x0a,0x20,0x20,0x20,0x20,0x67,
+    0x6c,0x5f,0x50,0x6f,0x73,0x69,0x74,0x69,0x6f,0x6e,0x20,0x3d,0x20,0x76,0x65,0x63,
+    0x34,0x28,0x28,0x69,0x6e,0x5f,0x70,0x6f,0x73,0x20,0x2a,0x20,0x32,0x2e,0x30,0x29,
+    0x20,0x2d,0x20,0x76,0x65,0x63,0x32,0x28,0x31,0x2e,0x30,0x29,0x2c,0x20,0x30,0x2e,
+    0x35,0x2c,0x20,0x31,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x75,0x76,0x20,
+    0x3d,0x20,0x69,0x6e,0x5f,0x75,0x76,0x3b,0x0a,0x7d,0x0a,0x0a,0x00,
+};
+/*
+    #version 100
+    precision mediump float;
+    precision highp int;
+    
+    uniform highp sampler2D frame;
+    uniform highp sampler2D pal;
+    
+    varying highp vec2 uv;
+    
+    highp float idiv(highp float a, highp float b)
+    {
+        return floor((a + 0.5) / b);
+    }
+    
+    highp float imod(highp float a, highp float b)
+    {
+        return a - (b * idiv(a, b));
+    }
+    
+    highp float bit(highp float v, highp float p)
+    {
+        return imod(idiv(v, p), 2.0);
+    }
+    
+    highp float pow2(highp float n)
+    {
+        return floor(exp2(n) + 0.5);
+    }
+    
+    highp float fetch(highp float addr)
+    {
+        return floor((texture2D(frame, vec2((imod(addr, 256.0) + 0.5) * 0.00390625, (idiv(addr, 256.0) + 0.5) * 0.0263157896697521209716796875)).x * 255.0) + 0.5);
+    }
+    
+    void main()
+    {
+        highp float x = floor(uv.x * 320.0) - 32.0;
+        highp float y = floor(uv.y * 243.0);
+        highp float ctrl = fetch(9472.0 + y);
+        highp float ag = bit(ctrl, 1.0);
+        highp float css = bit(ctrl, 128.0);
+        highp float color = (ag > 0.5) ? (css * 4.0) : 8.0;
+        y -= 25.0;
+        if ((((x >= 0.0) && (x < 256.0)) && (y >= 0.0)) && (y < 192.0))
+        {
+            if (ag > 0.5)
+            {
+                highp float gm1 = bit(ctrl, 32.0);
+                highp float gm2 = bit(ctrl, 64.0);
+                if (bit(ctrl, 16.0) > 0.5)
+                {
+                    highp float row_height = (gm2 > 0.5) ? 1.0 : ((gm1 > 0.5) ? 2.0 : 3.0);
+                    highp float wide = ((gm1 + gm2) < 1.5) ? 2.0 : 1.0;
+                    highp float m = fetch((idiv(y, row_height) * (32.0 / wide)) + idiv(x, 8.0 * wide));
+                    color = (bit(m, pow2(7.0 - idiv(imod(x, 8.0 * wide), wide))) > 0.5) ? (css * 4.0) : 8.0;
+                }
+                else
+                {
+                    highp float row_height = (gm2 > 0.5) ? ((gm1 > 0.5) ? 1.0 : 2.0) : 3.0;
+                    highp float wide = ((gm1 + gm2) < 0.5) ? 2.0 : 1.0;
+                    highp float m = fetch((idiv(y, row_height) * (32.0 / wide)) + idiv(x, 8.0 * wide));
+                    color = (css * 4.0) + imod(idiv(m, pow2(6.0 - (2.0 * idiv(imod(x, 8.0 * wide), 2.0 * wide)))), 4.0);
+                }
+            }
+            else
+            {
+                highp float chr_y = imod(y, 12.0);
+                highp float addr = (idiv(y, 12.0) * 32.0) + idiv(x, 8.0);
+                highp float cx = imod(x, 8.0);
+                highp float chr = fetch(addr);
+                highp float cell = fetch(8192.0 + addr);
+                highp float intext = bit(cell, 4.0);
+                if (bit(cell, 2.0) > 0.5)
+                {
+                    highp float m;
+                    highp float fg;
+                    if (intext > 0.5)
+                    {
+                        m = imod(idiv(chr, (chr_y < 3.5) ? 16.0 : ((chr_y < 7.5) ? 4.0 : 1.0)), 4.0);
+                        fg = idiv(chr, 64.0) + (bit(cell, 128.0) * 4.0);
+                    }
+                    else
+                    {
+                        m = imod(idiv(chr, (chr_y < 5.5) ? 4.0 : 1.0), 4.0);
+                        fg = imod(idiv(chr, 16.0), 8.0);
+                    }
+                    color = (bit(m, (cx < 3.5) ? 2.0 : 1.0) > 0.5) ? fg : 8.0;
+                }
+                else
+                {
+                    highp float m;
+                    if (intext > 0.5)
+                    {
+                        m = (chr > 223.5) ? chr : fetch((4096.0 + (imod(chr, 128.0) * 16.0)) + chr_y);
+                    }
+                    else
+                    {
+                        m = fetch((8704.0 + (imod(chr, 64.0) * 12.0)) + chr_y);
+                    }
+                    if (bit(cell, 8.0) > 0.5)
+                    {
+                        m = 255.0 - m;
+                    }
+                    if (bit(m, pow2(7.0 - cx)) > 0.5)
+                    {
+                        color = (css > 0.5) ? 11.0 : 9.0;
+                    }
+                    else
+                    {
+                        color = (css > 0.5) ? 12.0 : 10.0;
+                    }
+                }
+            }
+        }
+        gl_FragData[0] = texture2D(pal, vec2((color * 0.0625) + 0.03125, 0.5));
+    }
+    
+*/
+static const char mc6847_fs_source_glsl100[3811] = {
+    0x23,0x76,0x65,0x72,0x73,0x69,0x6f,0x6e,0x20,0x31,0x30,0x30,0x0a,0x70,0x72,0x65,
+    0x63,0x69,0x73,0x69,0x6f,0x6e,0x20,0x6d,0x65,0x64,0x69,0x75,0x6d,0x70,0x20,0x66,
+    0x6c,0x6f,0x61,0x74,0x3b,0x0a,0x70,0x72,0x65,0x63,0x69,0x73,0x69,0x6f,0x6e,0x20,
+    0x68,0x69,0x67,0x68,0x70,0x20,0x69,0x6e,0x74,0x3b,0x0a,0x0a,0x75,0x6e,0x69,0x66,
+    0x6f,0x72,0x6d,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x73,0x61,0x6d,0x70,0x6c,0x65,
+    0x72,0x32,0x44,0x20,0x66,0x72,0x61,0x6d,0x65,0x3b,0x0a,0x75,0x6e,0x69,0x66,0x6f,
+    0x72,0x6d,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x73,0x61,0x6d,0x70,0x6c,0x65,0x72,
+    0x32,0x44,0x20,0x70,0x61,0x6c,0x3b,0x0a,0x0a,0x76,0x61,0x72,0x79,0x69,0x6e,0x67,
+    0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x76,0x65,0x63,0x32,0x20,0x75,0x76,0x3b,0x0a,
+    0x0a,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x69,0x64,0x69,
+    0x76,0x28,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x61,0x2c,
+    0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x62,0x29,0x0a,
+    0x7b,0x0a,0x20,0x20,0x20,0x20,0x72,0x65,0x74,0x75,0x72,0x6e,0x20,0x66,0x6c,0x6f,
+    0x6f,0x72,0x28,0x28,0x61,0x20,0x2b,0x20,0x30,0x2e,0x35,0x29,0x20,0x2f,0x20,0x62,
+    0x29,0x3b,0x0a,0x7d,0x0a,0x0a,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,
+    0x74,0x20,0x69,0x6d,0x6f,0x64,0x28,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,
+    0x61,0x74,0x20,0x61,0x2c,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,
+    0x74,0x20,0x62,0x29,0x0a,0x7b,0x0a,0x20,0x20,0x20,0x20,0x72,0x65,0x74,0x75,0x72,
+    0x6e,0x20,0x61,0x20,0x2d,0x20,0x28,0x62,0x20,0x2a,0x20,0x69,0x64,0x69,0x76,0x28,
+    0x61,0x2c,0x20,0x62,0x29,0x29,0x3b,0x0a,0x7d,0x0a,0x0a,0x68,0x69,0x67,0x68,0x70,
+    0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x62,0x69,0x74,0x28,0x68,0x69,0x67,0x68,0x70,
+    0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x76,0x2c,0x20,0x68,0x69,0x67,0x68,0x70,0x20,
+    0x66,0x6c,0x6f,0x61,0x74,0x20,0x70,0x29,0x0a,0x7b,0x0a,0x20,0x20,0x20,0x20,0x72,
+    0x65,0x74,0x75,0x72,0x6e,0x20,0x69,0x6d,0x6f,0x64,0x28,0x69,0x64,0x69,0x76,0x28,
+    0x76,0x2c,0x20,0x70,0x29,0x2c,0x20,0x32,0x2e,0x30,0x29,0x3b,0x0a,0x7d,0x0a,0x0a,
+    0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x70,0x6f,0x77,0x32,
+    0x28,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x6e,0x29,0x0a,
+    0x7b,0x0a,0x20,0x20,0x20,0x20,0x72,0x65,0x74,0x75,0x72,0x6e,0x20,0x66,0x6c,0x6f,
+    0x6f,0x72,0x28,0x65,0x78,0x70,0x32,0x28,0x6e,0x29,0x20,0x2b,0x20,0x30,0x2e,0x35,
+    0x29,0x3b,0x0a,0x7d,0x0a,0x0a,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,
+    0x74,0x20,0x66,0x65,0x74,0x63,0x68,0x28,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,
+    0x6f,0x61,0x74,0x20,0x61,0x64,0x64,0x72,0x29,0x0a,0x7b,0x0a,0x20,0x20,0x20,0x20,
+    0x72,0x65,0x74,0x75,0x72,0x6e,0x20,0x66,0x6c,0x6f,0x6f,0x72,0x28,0x28,0x74,0x65,
+    0x78,0x74,0x75,0x72,0x65,0x32,0x44,0x28,0x66,0x72,0x61,0x6d,0x65,0x2c,0x20,0x76,
+    0x65,0x63,0x32,0x28,0x28,0x69,0x6d,0x6f,0x64,0x28,0x61,0x64,0x64,0x72,0x2c,0x20,
+    0x32,0x35,0x36,0x2e,0x30,0x29,0x20,0x2b,0x20,0x30,0x2e,0x35,0x29,0x20,0x2a,0x20,
+    0x30,0x2e,0x30,0x30,0x33,0x39,0x30,0x36,0x32,0x35,0x2c,0x20,0x28,0x69,0x64,0x69,
+    0x76,0x28,0x61,0x64,0x64,0x72,0x2c,0x20,0x32,0x35,0x36,0x2e,0x30,0x29,0x20,0x2b,
+    0x20,0x30,0x2e,0x35,0x29,0x20,0x2a,0x20,0x30,0x2e,0x30,0x32,0x36,0x33,0x31,0x35,
+    0x37,0x38,0x39,0x36,0x36,0x39,0x37,0x35,0x32,0x31,0x32,0x30,0x39,0x37,0x31,0x36,
+    0x37,0x39,0x36,0x38,0x37,0x35,0x29,0x29,0x2e,0x78,0x20,0x2a,0x20,0x32,0x35,0x35,
+    0x2e,0x30,0x29,0x20,0x2b,0x20,0x30,0x2e,0x35,0x29,0x3b,0x0a,0x7d,0x0a,0x0a,0x76,
+    0x6f,0x69,0x64,0x20,0x6d,0x61,0x69,0x6e,0x28,0x29,0x0a,0x7b,0x0a,0x20,0x20,0x20,
+    0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x78,0x20,0x3d,
+    0x20,0x66,0x6c,0x6f,0x6f,0x72,0x28,0x75,0x76,0x2e,0x78,0x20,0x2a,0x20,0x33,0x32,
+    0x30,0x2e,0x30,0x29,0x20,0x2d,0x20,0x33,0x32,0x2e,0x30,0x3b,0x0a,0x20,0x20,0x20,
+    0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x79,0x20,0x3d,
+    0x20,0x66,0x6c,0x6f,0x6f,0x72,0x28,0x75,0x76,0x2e,0x79,0x20,0x2a,0x20,0x32,0x34,
+    0x33,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,
+    0x66,0x6c,0x6f,0x61,0x74,0x20,0x63,0x74,0x72,0x6c,0x20,0x3d,0x20,0x66,0x65,0x74,
+    0x63,0x68,0x28,0x39,0x34,0x37,0x32,0x2e,0x30,0x20,0x2b,0x20,0x79,0x29,0x3b,0x0a,
+    0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,
+    0x61,0x67,0x20,0x3d,0x20,0x62,0x69,0x74,0x28,0x63,0x74,0x72,0x6c,0x2c,0x20,0x31,
+    0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,
+    0x6c,0x6f,0x61,0x74,0x20,0x63,0x73,0x73,0x20,0x3d,0x20,0x62,0x69,0x74,0x28,0x63,
+    0x74,0x72,0x6c,0x2c,0x20,0x31,0x32,0x38,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,
+    0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x63,0x6f,0x6c,
+    0x6f,0x72,0x20,0x3d,0x20,0x28,0x61,0x67,0x20,0x3e,0x20,0x30,0x2e,0x35,0x29,0x20,
+    0x3f,0x20,0x28,0x63,0x73,0x73,0x20,0x2a,0x20,0x34,0x2e,0x30,0x29,0x20,0x3a,0x20,
+    0x38,0x2e,0x30,0x3b,0x0a,0x20,0x20,0x20,0x20,0x79,0x20,0x2d,0x3d,0x20,0x32,0x35,
+    0x2e,0x30,0x3b,0x0a,0x20,0x20,0x20,0x20,0x69,0x66,0x20,0x28,0x28,0x28,0x28,0x78,
+    0x20,0x3e,0x3d,0x20,0x30,0x2e,0x30,0x29,0x20,0x26,0x26,0x20,0x28,0x78,0x20,0x3c,
+    0x20,0x32,0x35,0x36,0x2e,0x30,0x29,0x29,0x20,0x26,0x26,0x20,0x28,0x79,0x20,0x3e,
+    0x3d,0x20,0x30,0x2e,0x30,0x29,0x29,0x20,0x26,0x26,0x20,0x28,0x79,0x20,0x3c,0x20,
+    0x31,0x39,0x32,0x2e,0x30,0x29,0x29,0x0a,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x69,0x66,0x20,0x28,0x61,0x67,0x20,0x3e,0x20,0x30,
+    0x2e,0x35,0x29,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,
+    0x66,0x6c,0x6f,0x61,0x74,0x20,0x67,0x6d,0x31,0x20,0x3d,0x20,0x62,0x69,0x74,0x28,
+    0x63,0x74,0x72,0x6c,0x2c,0x20,0x33,0x32,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,
+    0x6c,0x6f,0x61,0x74,0x20,0x67,0x6d,0x32,0x20,0x3d,0x20,0x62,0x69,0x74,0x28,0x63,
+    0x74,0x72,0x6c,0x2c,0x20,0x36,0x34,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x69,0x66,0x20,0x28,0x62,0x69,0x74,0x28,
+    0x63,0x74,0x72,0x6c,0x2c,0x20,0x31,0x36,0x2e,0x30,0x29,0x20,0x3e,0x20,0x30,0x2e,
+    0x35,0x29,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,
+    0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x72,0x6f,0x77,
+    0x5f,0x68,0x65,0x69,0x67,0x68,0x74,0x20,0x3d,0x20,0x28,0x67,0x6d,0x32,0x20,0x3e,
+    0x20,0x30,0x2e,0x35,0x29,0x20,0x3f,0x20,0x31,0x2e,0x30,0x20,0x3a,0x20,0x28,0x28,
+    0x67,0x6d,0x31,0x20,0x3e,0x20,0x30,0x2e,0x35,0x29,0x20,0x3f,0x20,0x32,0x2e,0x30,
+    0x20,0x3a,0x20,0x33,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,
+    0x6c,0x6f,0x61,0x74,0x20,0x77,0x69,0x64,0x65,0x20,0x3d,0x20,0x28,0x28,0x67,0x6d,
+    0x31,0x20,0x2b,0x20,0x67,0x6d,0x32,0x29,0x20,0x3c,0x20,0x31,0x2e,0x35,0x29,0x20,
+    0x3f,0x20,0x32,0x2e,0x30,0x20,0x3a,0x20,0x31,0x2e,0x30,0x3b,0x0a,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,
+    0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x6d,0x20,0x3d,0x20,0x66,0x65,0x74,
+    0x63,0x68,0x28,0x28,0x69,0x64,0x69,0x76,0x28,0x79,0x2c,0x20,0x72,0x6f,0x77,0x5f,
+    0x68,0x65,0x69,0x67,0x68,0x74,0x29,0x20,0x2a,0x20,0x28,0x33,0x32,0x2e,0x30,0x20,
+    0x2f,0x20,0x77,0x69,0x64,0x65,0x29,0x29,0x20,0x2b,0x20,0x69,0x64,0x69,0x76,0x28,
+    0x78,0x2c,0x20,0x38,0x2e,0x30,0x20,0x2a,0x20,0x77,0x69,0x64,0x65,0x29,0x29,0x3b,
+    0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x63,0x6f,0x6c,0x6f,0x72,0x20,0x3d,0x20,0x28,0x62,0x69,0x74,0x28,0x6d,0x2c,
+    0x20,0x70,0x6f,0x77,0x32,0x28,0x37,0x2e,0x30,0x20,0x2d,0x20,0x69,0x64,0x69,0x76,
+    0x28,0x69,0x6d,0x6f,0x64,0x28,0x78,0x2c,0x20,0x38,0x2e,0x30,0x20,0x2a,0x20,0x77,
+    0x69,0x64,0x65,0x29,0x2c,0x20,0x77,0x69,0x64,0x65,0x29,0x29,0x29,0x20,0x3e,0x20,
+    0x30,0x2e,0x35,0x29,0x20,0x3f,0x20,0x28,0x63,0x73,0x73,0x20,0x2a,0x20,0x34,0x2e,
+    0x30,0x29,0x20,0x3a,0x20,0x38,0x2e,0x30,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x65,0x6c,0x73,0x65,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,
+    0x61,0x74,0x20,0x72,0x6f,0x77,0x5f,0x68,0x65,0x69,0x67,0x68,0x74,0x20,0x3d,0x20,
+    0x28,0x67,0x6d,0x32,0x20,0x3e,0x20,0x30,0x2e,0x35,0x29,0x20,0x3f,0x20,0x28,0x28,
+    0x67,0x6d,0x31,0x20,0x3e,0x20,0x30,0x2e,0x35,0x29,0x20,0x3f,0x20,0x31,0x2e,0x30,
+    0x20,0x3a,0x20,0x32,0x2e,0x30,0x29,0x20,0x3a,0x20,0x33,0x2e,0x30,0x3b,0x0a,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,
+    0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x77,0x69,0x64,0x65,0x20,
+    0x3d,0x20,0x28,0x28,0x67,0x6d,0x31,0x20,0x2b,0x20,0x67,0x6d,0x32,0x29,0x20,0x3c,
+    0x20,0x30,0x2e,0x35,0x29,0x20,0x3f,0x20,0x32,0x2e,0x30,0x20,0x3a,0x20,0x31,0x2e,
+    0x30,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x6d,
+    0x20,0x3d,0x20,0x66,0x65,0x74,0x63,0x68,0x28,0x28,0x69,0x64,0x69,0x76,0x28,0x79,
+    0x2c,0x20,0x72,0x6f,0x77,0x5f,0x68,0x65,0x69,0x67,0x68,0x74,0x29,0x20,0x2a,0x20,
+    0x28,0x33,0x32,0x2e,0x30,0x20,0x2f,0x20,0x77,0x69,0x64,0x65,0x29,0x29,0x20,0x2b,
+    0x20,0x69,0x64,0x69,0x76,0x28,0x78,0x2c,0x20,0x38,0x2e,0x30,0x20,0x2a,0x20,0x77,
+    0x69,0x64,0x65,0x29,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x63,0x6f,0x6c,0x6f,0x72,0x20,0x3d,0x20,0x28,
+    0x63,0x73,0x73,0x20,0x2a,0x20,0x34,0x2e,0x30,0x29,0x20,0x2b,0x20,0x69,0x6d,0x6f,
+    0x64,0x28,0x69,0x64,0x69,0x76,0x28,0x6d,0x2c,0x20,0x70,0x6f,0x77,0x32,0x28,0x36,
+    0x2e,0x30,0x20,0x2d,0x20,0x28,0x32,0x2e,0x30,0x20,0x2a,0x20,0x69,0x64,0x69,0x76,
+    0x28,0x69,0x6d,0x6f,0x64,0x28,0x78,0x2c,0x20,0x38,0x2e,0x30,0x20,0x2a,0x20,0x77,
+    0x69,0x64,0x65,0x29,0x2c,0x20,0x32,0x2e,0x30,0x20,0x2a,0x20,0x77,0x69,0x64,0x65,
+    0x29,0x29,0x29,0x29,0x2c,0x20,0x34,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x65,0x6c,0x73,0x65,
+    0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,
+    0x61,0x74,0x20,0x63,0x68,0x72,0x5f,0x79,0x20,0x3d,0x20,0x69,0x6d,0x6f,0x64,0x28,
+    0x79,0x2c,0x20,0x31,0x32,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,
+    0x74,0x20,0x61,0x64,0x64,0x72,0x20,0x3d,0x20,0x28,0x69,0x64,0x69,0x76,0x28,0x79,
+    0x2c,0x20,0x31,0x32,0x2e,0x30,0x29,0x20,0x2a,0x20,0x33,0x32,0x2e,0x30,0x29,0x20,
+    0x2b,0x20,0x69,0x64,0x69,0x76,0x28,0x78,0x2c,0x20,0x38,0x2e,0x30,0x29,0x3b,0x0a,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,
+    0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x63,0x78,0x20,0x3d,0x20,0x69,0x6d,0x6f,
+    0x64,0x28,0x78,0x2c,0x20,0x38,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,
+    0x61,0x74,0x20,0x63,0x68,0x72,0x20,0x3d,0x20,0x66,0x65,0x74,0x63,0x68,0x28,0x61,
+    0x64,0x64,0x72,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x63,0x65,
+    0x6c,0x6c,0x20,0x3d,0x20,0x66,0x65,0x74,0x63,0x68,0x28,0x38,0x31,0x39,0x32,0x2e,
+    0x30,0x20,0x2b,0x20,0x61,0x64,0x64,0x72,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,
+    0x61,0x74,0x20,0x69,0x6e,0x74,0x65,0x78,0x74,0x20,0x3d,0x20,0x62,0x69,0x74,0x28,
+    0x63,0x65,0x6c,0x6c,0x2c,0x20,0x34,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x69,0x66,0x20,0x28,0x62,0x69,0x74,0x28,
+    0x63,0x65,0x6c,0x6c,0x2c,0x20,0x32,0x2e,0x30,0x29,0x20,0x3e,0x20,0x30,0x2e,0x35,
+    0x29,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x68,0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x6d,0x3b,0x0a,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,
+    0x69,0x67,0x68,0x70,0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x66,0x67,0x3b,0x0a,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x69,
+    0x66,0x20,0x28,0x69,0x6e,0x74,0x65,0x78,0x74,0x20,0x3e,0x20,0x30,0x2e,0x35,0x29,
+    0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x6d,0x20,0x3d,0x20,0x69,0x6d,0x6f,0x64,0x28,
+    0x69,0x64,0x69,0x76,0x28,0x63,0x68,0x72,0x2c,0x20,0x28,0x63,0x68,0x72,0x5f,0x79,
+    0x20,0x3c,0x20,0x33,0x2e,0x35,0x29,0x20,0x3f,0x20,0x31,0x36,0x2e,0x30,0x20,0x3a,
+    0x20,0x28,0x28,0x63,0x68,0x72,0x5f,0x79,0x20,0x3c,0x20,0x37,0x2e,0x35,0x29,0x20,
+    0x3f,0x20,0x34,0x2e,0x30,0x20,0x3a,0x20,0x31,0x2e,0x30,0x29,0x29,0x2c,0x20,0x34,
+    0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x66,0x67,0x20,0x3d,0x20,0x69,0x64,
+    0x69,0x76,0x28,0x63,0x68,0x72,0x2c,0x20,0x36,0x34,0x2e,0x30,0x29,0x20,0x2b,0x20,
+    0x28,0x62,0x69,0x74,0x28,0x63,0x65,0x6c,0x6c,0x2c,0x20,0x31,0x32,0x38,0x2e,0x30,
+    0x29,0x20,0x2a,0x20,0x34,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x65,0x6c,0x73,0x65,
+    0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x6d,0x20,0x3d,0x20,0x69,0x6d,0x6f,0x64,0x28,
+    0x69,0x64,0x69,0x76,0x28,0x63,0x68,0x72,0x2c,0x20,0x28,0x63,0x68,0x72,0x5f,0x79,
+    0x20,0x3c,0x20,0x35,0x2e,0x35,0x29,0x20,0x3f,0x20,0x34,0x2e,0x30,0x20,0x3a,0x20,
+    0x31,0x2e,0x30,0x29,0x2c,0x20,0x34,0x2e,0x30,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x66,0x67,0x20,0x3d,0x20,0x69,0x6d,0x6f,0x64,0x28,0x69,0x64,0x69,0x76,0x28,0x63,
+    0x68,0x72,0x2c,0x20,0x31,0x36,0x2e,0x30,0x29,0x2c,0x20,0x38,0x2e,0x30,0x29,0x3b,
+    0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x63,0x6f,0x6c,0x6f,0x72,0x20,0x3d,0x20,0x28,0x62,0x69,0x74,0x28,
+    0x6d,0x2c,0x20,0x28,0x63,0x78,0x20,0x3c,0x20,0x33,0x2e,0x35,0x29,0x20,0x3f,0x20,
+    0x32,0x2e,0x30,0x20,0x3a,0x20,0x31,0x2e,0x30,0x29,0x20,0x3e,0x20,0x30,0x2e,0x35,
+    0x29,0x20,0x3f,0x20,0x66,0x67,0x20,0x3a,0x20,0x38,0x2e,0x30,0x3b,0x0a,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x65,0x6c,0x73,0x65,0x0a,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x68,0x69,0x67,0x68,0x70,
+    0x20,0x66,0x6c,0x6f,0x61,0x74,0x20,0x6d,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x69,0x66,0x20,0x28,0x69,0x6e,
+    0x74,0x65,0x78,0x74,0x20,0x3e,0x20,0x30,0x2e,0x35,0x29,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x6d,0x20,0x3d,0x20,0x28,0x63,0x68,0x72,0x20,0x3e,0x20,0x32,0x32,0x33,
+    0x2e,0x35,0x29,0x20,0x3f,0x20,0x63,0x68,0x72,0x20,0x3a,0x20,0x66,0x65,0x74,0x63,
+    0x68,0x28,0x28,0x34,0x30,0x39,0x36,0x2e,0x30,0x20,0x2b,0x20,0x28,0x69,0x6d,0x6f,
+    0x64,0x28,0x63,0x68,0x72,0x2c,0x20,0x31,0x32,0x38,0x2e,0x30,0x29,0x20,0x2a,0x20,
+    0x31,0x36,0x2e,0x30,0x29,0x29,0x20,0x2b,0x20,0x63,0x68,0x72,0x5f,0x79,0x29,0x3b,
+    0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x65,0x6c,0x73,0x65,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x6d,0x20,
+    0x3d,0x20,0x66,0x65,0x74,0x63,0x68,0x28,0x28,0x38,0x37,0x30,0x34,0x2e,0x30,0x20,
+    0x2b,0x20,0x28,0x69,0x6d,0x6f,0x64,0x28,0x63,0x68,0x72,0x2c,0x20,0x36,0x34,0x2e,
+    0x30,0x29,0x20,0x2a,0x20,0x31,0x32,0x2e,0x30,0x29,0x29,0x20,0x2b,0x20,0x63,0x68,
+    0x72,0x5f,0x79,0x29,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x69,0x66,0x20,0x28,0x62,0x69,0x74,0x28,
+    0x63,0x65,0x6c,0x6c,0x2c,0x20,0x38,0x2e,0x30,0x29,0x20,0x3e,0x20,0x30,0x2e,0x35,
+    0x29,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x6d,0x20,0x3d,0x20,0x32,0x35,0x35,0x2e,
+    0x30,0x20,0x2d,0x20,0x6d,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x69,0x66,0x20,0x28,0x62,0x69,0x74,
+    0x28,0x6d,0x2c,0x20,0x70,0x6f,0x77,0x32,0x28,0x37,0x2e,0x30,0x20,0x2d,0x20,0x63,
+    0x78,0x29,0x29,0x20,0x3e,0x20,0x30,0x2e,0x35,0x29,0x0a,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x63,0x6f,0x6c,0x6f,0x72,0x20,0x3d,0x20,0x28,0x63,0x73,0x73,0x20,0x3e,0x20,
+    0x30,0x2e,0x35,0x29,0x20,0x3f,0x20,0x31,0x31,0x2e,0x30,0x20,0x3a,0x20,0x39,0x2e,
+    0x30,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x65,0x6c,0x73,0x65,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7b,0x0a,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x63,0x6f,0x6c,0x6f,0x72,0x20,0x3d,0x20,0x28,0x63,0x73,0x73,0x20,0x3e,0x20,0x30,
+    0x2e,0x35,0x29,0x20,0x3f,0x20,0x31,0x32,0x2e,0x30,0x20,0x3a,0x20,0x31,0x30,0x2e,
+    0x30,0x3b,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,
+    0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x7d,0x0a,0x20,0x20,0x20,
+    0x20,0x7d,0x0a,0x20,0x20,0x20,0x20,0x67,0x6c,0x5f,0x46,0x72,0x61,0x67,0x44,0x61,
+    0x74,0x61,0x5b,0x30,0x5d,0x20,0x3d,0x20,0x74,0x65,0x78,0x74,0x75,0x72,0x65,0x32,
+    0x44,0x28,0x70,0x61,0x6c,0x2c,0x20,0x76,0x65,0x63,0x32,0x28,0x28,0x63,0x6f,0x6c,
+    0x6f,0x72,0x20,0x2a,0x20,0x30,0x2e,0x30,0x36,0x32,0x35,0x29,0x20,0x2b,0x20,0x30,
+    0x2e,0x30,0x33,0x31,0x32,0x35,0x2c,0x20,0x30,0x2e,0x35,0x29,0x29,0x3b,0x0a,0x7d,
+    0x0a,0x0a,0x00,
+};
 static const sg_shader_desc display_shader_desc_glsl100 = {
   0, /* _start_canary */
   { /*attrs*/{"in_pos","TEXCOORD",0},{"in_uv","TEXCOORD",1},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0}, },
@@ -318,6 +826,118 @@ static const sg_shader_desc upscale_shader_desc_glsl100 = {
   "upscale_shader", /* label */
   0, /* _end_canary */
 };
+static const sg_shader_desc upscale_indexed_shader_desc_glsl100 = {
+  0, /* _start_canary */
+  { /*attrs*/{"in_pos","TEXCOORD",0},{"in_uv","TEXCOORD",1},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0}, },
+  { /* vs */
+    upscale_indexed_vs_source_glsl100, /* source */
+    0,  /* bytecode */
+    0,  /* bytecode_size */
+    "main", /* entry */
+    { /* uniform blocks */
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+    },
+    { /* images */ {0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT}, },
+  },
+  { /* fs */
+    upscale_indexed_fs_source_glsl100, /* source */
+    0,  /* bytecode */
+    0,  /* bytecode_size */
+    "main", /* entry */
+    { /* uniform blocks */
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+    },
+    { /* images */ {"tex",SG_IMAGETYPE_2D},{"pal",SG_IMAGETYPE_2D},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT}, },
+  },
+  "upscale_indexed_shader", /* label */
+  0, /* _end_canary */
+};
+static const sg_shader_desc mc6847_shader_desc_glsl100 = {
+  0, /* _start_canary */
+  { /*attrs*/{"in_pos","TEXCOORD",0},{"in_uv","TEXCOORD",1},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0},{0,0,0}, },
+  { /* vs */
+    mc6847_vs_source_glsl100, /* source */
+    0,  /* bytecode */
+    0,  /* bytecode_size */
+    "main", /* entry */
+    { /* uniform blocks */
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+    },
+    { /* images */ {0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT}, },
+  },
+  { /* fs */
+    mc6847_fs_source_glsl100, /* source */
+    0,  /* bytecode */
+    0,  /* bytecode_size */
+    "main", /* entry */
+    { /* uniform blocks */
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+      {
+        0, /* size */
+        { /* uniforms */{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0},{0,SG_UNIFORMTYPE_INVALID,0}, },
+      },
+    },
+    { /* images */ {"frame",SG_IMAGETYPE_2D},{"pal",SG_IMAGETYPE_2D},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT},{0,_SG_IMAGETYPE_DEFAULT}, },
+  },
+  "mc6847_shader", /* label */
+  0, /* _end_canary */
+};
 #if !defined(SOKOL_GFX_INCLUDED)
   #error "Please include sokol_gfx.h before shaders.glsl.h"
 #endif
@@ -333,3 +953,15 @@ static inline const sg_shader_desc* upscale_shader_desc(void) {
     }
     return 0; /* can't happen */
 }
+static inline const sg_shader_desc* upscale_indexed_shader_desc(void) {
+    if (sg_query_backend() == SG_BACKEND_GLES2) {
+        return &upscale_indexed_shader_desc_glsl100;
+    }
+    return 0; /* can't happen */
+}
+static inline const sg_shader_desc* mc6847_shader_desc(void) {
+    if (sg_query_backend() == SG_BACKEND_GLES2) {
+        return &mc6847_shader_desc_glsl100;
+    }
+    return 0; /* can't happen */
+}
@@ -44,21 +44,25 @@ extern "C" {
 extern "C" {
 
 extern spc1000_desc_t spc1000_desc(spc1000_type_t type, spc1000_joystick_type_t joy_type);
+extern int app_rewind(spc1000_t* sys, int num_frames);
+extern void app_boot(spc1000_t* sys, spc1000_type_t type);
+extern void app_reset(spc1000_t* sys);
+extern void app_set_speed(spc1000_t* sys, float speed, bool skip_audio);
+extern void app_set_tape_fastload(spc1000_t* sys, bool enabled);
+extern void app_set_tape_num(spc1000_t* sys, int num);
+extern bool app_insert_tape(spc1000_t* sys, const uint8_t* ptr, int num_bytes);
+extern void app_mem_write(spc1000_t* sys, int layer, uint16_t addr, uint8_t data);
 
 static double exec_time;
 static ui_spc1000_t ui_spc1000;
+static keybuf_state* ui_keybuf;
 
-/* reboot callback */
-static void boot_cb(spc1000_t* sys, spc1000_type_t type) {
-    spc1000_desc_t desc = spc1000_desc(type, sys->joystick_type);
-    spc1000_init(sys, &desc);
-}
 
 void keybutton(const char *key, int space)
 {
     if (ImGui::Button(key))
     {
-        keybuf_put(key);
+        keybuf_put(ui_keybuf, key);
     }
     ImGui::SameLine();
     ImGui::SetCursorPos(ImVec2(ImGui::GetCursorPos().x + space, ImGui::GetCursorPos().y));    
@@ -106,14 +110,23 @@ void spc1000ui_draw(void) {
 #endif
 }
 
-void spc1000ui_init(spc1000_t* spc1000) {
+void spc1000ui_init(spc1000_t* spc1000, keybuf_state* keybuf, bool threaded) {
+    ui_keybuf = keybuf;
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     ImFont *font = io.Fonts->AddFontFromMemoryTTF(dump_namyangju_godic_otf, 2420460, 16.0f, NULL, io.Fonts->GetGlyphRangesKorean());
     ui_init(spc1000ui_draw);
     ui_spc1000_desc_t desc = {0};
     desc.spc1000 = spc1000;
-    desc.boot_cb = boot_cb;
+    desc.boot_cb = app_boot;
+    desc.rewind_cb = app_rewind;
+    desc.reset_cb = app_reset;
+    desc.set_speed_cb = app_set_speed;
+    desc.set_tape_fastload_cb = app_set_tape_fastload;
+    desc.set_tape_num_cb = app_set_tape_num;
+    desc.insert_tape_cb = app_insert_tape;
+    desc.mem_write_cb = app_mem_write;
+    desc.threaded = threaded;
     desc.create_texture_cb = gfx_create_texture;
     desc.update_texture_cb = gfx_update_texture;
     desc.destroy_texture_cb = gfx_destroy_texture;
@@ -134,6 +147,10 @@ void spc1000ui_discard(void) {
     ui_spc1000_discard(&ui_spc1000);
 }
 
+void spc1000ui_set_speed(float achieved_speed) {
+    ui_spc1000.achieved_speed = achieved_speed;
+}
+
 void spc1000ui_exec(spc1000_t* spc1000, uint32_t frame_time_us) {
     if (ui_spc1000_before_exec(&ui_spc1000)) {
         uint64_t start = stm_now();
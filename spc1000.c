@@ -25,37 +25,138 @@
 #include "chips/clk.h"
 #include "chips/mem.h"
 #include "systems/spc1000.h"
+#include "util/rewind.h"
+#include "util/audio_ring.h"
 #include "roms/spc1000-roms.h"
+#ifndef __EMSCRIPTEN__
+#define APP_USE_THREAD (1)
+#include <pthread.h>
+#include <time.h>
+#include "util/capture.h"
+#endif
 
 /* imports from spc1000-ui.cc */
 #ifdef CHIPS_USE_UI
 #include "ui.h"
-void spc1000ui_init(spc1000_t* spc1000);
+void spc1000ui_init(spc1000_t* spc1000, keybuf_state* keybuf, bool threaded);
 void spc1000ui_discard(void);
 void spc1000ui_draw(void);
 void spc1000ui_exec(spc1000_t* spc1000, uint32_t frame_time_us);
+void spc1000ui_set_speed(float achieved_speed);
 static const int ui_extra_height = 16;
 #else
 static const int ui_extra_height = 0;
 #endif
 
-static spc1000_t spc1000;
+#define APP_FRAME_US (16667)
+#define APP_NUM_FRAMES (3)
+#define APP_FRAME_NEW (0x80)    /* set in ready_frame until the frame is taken for drawing */
+#define APP_NUM_EVENTS (256)
+#define APP_MAX_RATE_ADJUST (0.005f)    /* max audio rate change for pacing=audio */
+
+/* input for the emulator thread */
+typedef enum {
+    APP_EVENT_KEY_DOWN,
+    APP_EVENT_KEY_UP,
+    APP_EVENT_REWIND_KEY,
+    APP_EVENT_REWIND,
+    APP_EVENT_BOOT,
+    APP_EVENT_RESET,
+    APP_EVENT_SPEED,
+    APP_EVENT_TAPE_FASTLOAD,
+    APP_EVENT_TAPE_NUM,
+    APP_EVENT_INSERT_TAPE,
+    APP_EVENT_MEM_WRITE,
+} app_event_type_t;
+
+typedef struct {
+    app_event_type_t type;
+    int val;
+    float speed;            /* APP_EVENT_SPEED */
+    const uint8_t* ptr;     /* APP_EVENT_INSERT_TAPE, val is the size */
+    int layer;              /* APP_EVENT_MEM_WRITE, val is the byte */
+    uint16_t addr;
+} app_event_t;
+
+/*  all application state, allocated in sokol_main() and handed to the
+    sokol-app callbacks as user data, so no emulator state lives in globals
+*/
+typedef struct {
+    spc1000_t spc1000;
+    fs_state fs;
+    keybuf_state keybuf;
+    clock_state clock;
+    /* emulator audio output, drained by the sokol-audio stream callback */
+    audio_ring_t audio;
+    /* pacing=audio: follow the audio clock instead of the frame clock */
+    bool audio_pacing;
+    /* video=indexed: decode 8-bit color indices, the upscale shader looks up the colors */
+    bool indexed;
+    /* video=gpu: only pack the video memory and line modes, the MC6847 modes are decoded in a shader */
+    bool gpu_decode;
+    /* the MC6847 change count of the last drawn or published frame, unchanged frames aren't uploaded */
+    uint32_t frame_change_count;
+    #ifdef APP_USE_THREAD
+    /* capture=file records the video and audio on a background thread, see util/capture.h */
+    capture_t capture;
+    bool capturing;
+    uint32_t capture_change_count;
+    #endif
+    /* fast-forward, with speed=max the speed multiplier follows the host performance */
+    bool unthrottled;
+    float achieved_speed;
+    uint64_t last_frame_time;
+    /* rewind buffer with one save state per frame, rewinds while F12 is held */
+    rewind_t rewind;
+    uint8_t* rewind_state;
+    int rewind_state_size;
+    bool rewind_key;
+    /*  thread=on runs the emulator on its own thread: it decodes into one of
+        three pixel buffers and publishes each changed frame by swapping its
+        buffer index with ready_frame, the render thread swaps the newest frame
+        out of ready_frame for drawing; input reaches the emulator thread
+        through a single-producer/single-consumer event queue; the render
+        thread holds 'lock' while it draws (the UI reads the emulator state),
+        the emulator thread while it reboots or replaces the tape; the
+        debugger, hardware and memory windows are disabled, since they
+        would read the emulator state while it runs
+    */
+    bool threaded;
+    #ifdef APP_USE_THREAD
+    pthread_t thread;
+    pthread_mutex_t lock;
+    #endif
+    bool quit;
+    uint32_t* frames[APP_NUM_FRAMES];
+    int emu_frame;
+    int draw_frame;
+    int ready_frame;
+    app_event_t events[APP_NUM_EVENTS];
+    uint32_t event_write;
+    uint32_t event_read;
+    clock_state emu_clock;
+} app_t;
 
 /* sokol-app entry, configure application callbacks and window */
-static void app_init(void);
-static void app_frame(void);
-static void app_input(const sapp_event*);
-static void app_cleanup(void);
+static void app_init(void* user_data);
+static void app_frame(void* user_data);
+static void app_input(const sapp_event*, void* user_data);
+static void app_cleanup(void* user_data);
+#ifdef APP_USE_THREAD
+static void* emu_thread(void* arg);
+#endif
 
 sapp_desc sokol_main(int argc, char* argv[]) {
     sargs_setup(&(sargs_desc){ .argc=argc, .argv=argv });
     //printf("sargs_setup...ok\n");
     // fflush(stdout);
+    app_t* app = (app_t*) calloc(1, sizeof(app_t));
     return (sapp_desc) {
-        .init_cb = app_init,
-        .frame_cb = app_frame,
-        .event_cb = app_input,
-        .cleanup_cb = app_cleanup,
+        .user_data = app,
+        .init_userdata_cb = app_init,
+        .frame_userdata_cb = app_frame,
+        .event_userdata_cb = app_input,
+        .cleanup_userdata_cb = app_cleanup,
 //        .width = 3 * spc1000_std_display_width(),
 //        .height = 3 * spc1000_std_display_height() + ui_extra_height,
         .window_title = "SPC-1000 Samsung Electronics 1982",
@@ -63,40 +164,88 @@ sapp_desc sokol_main(int argc, char* argv[]) {
     };
 }
 
-/* audio-streaming callback */
+/* audio callback of the emulator, runs on the emulator thread */
 static void push_audio(const float* samples, int num_samples, void* user_data) {
-    saudio_push(samples, num_samples);
+    app_t* app = (app_t*) user_data;
+    audio_ring_push(&app->audio, samples, num_samples);
+    #ifdef APP_USE_THREAD
+    if (app->capturing) {
+        capture_audio(&app->capture, samples, num_samples);
+    }
+    #endif
+}
+
+/* sokol-audio stream callback, runs on the audio thread */
+static void stream_audio(float* buffer, int num_frames, int num_channels, void* user_data) {
+    audio_ring_pull((audio_ring_t*) user_data, buffer, num_frames);
+    /* the emulator output is mono, duplicate it for all channels */
+    for (int i = num_frames - 1; (num_channels > 1) && (i >= 0); i--) {
+        const float sample = buffer[i];
+        for (int c = 0; c < num_channels; c++) {
+            buffer[i * num_channels + c] = sample;
+        }
+    }
 }
 
 /* get spc1000_desc_t struct for given SPC1000 type and joystick type */
 spc1000_desc_t spc1000_desc(spc1000_type_t type, spc1000_joystick_type_t joy_type) {
+    app_t* app = (app_t*) sapp_userdata();
     return (spc1000_desc_t){
         .type = type,
         .joystick_type = joy_type,
-        .pixel_buffer = gfx_framebuffer(),
-        .pixel_buffer_size = gfx_framebuffer_size(),
+        .pixel_buffer = app->threaded ? app->frames[app->emu_frame] : gfx_framebuffer(),
+        .pixel_buffer_size = app->threaded ? spc1000_max_display_size() : gfx_framebuffer_size(),
+        .pixel_index8 = app->indexed,
+        .external_decode = app->gpu_decode,
         .audio_cb = push_audio,
+        .user_data = app,
         .audio_sample_rate = saudio_sample_rate(),
         .rom_spc1000 = dump_spcall_rom,
         .rom_spc1000_size = sizeof(dump_spcall_rom),
         .tap_spc1000 = dump_demo_tap,
-        .tap_spc1000_size = sizeof(dump_demo_tap)
+        .tap_spc1000_size = sizeof(dump_demo_tap),
+        .tape_fastload = !sargs_equals("fastload", "off"),
+        .idle_skip = sargs_equals("idle", "skip"),
+        .cpu_block_cache = sargs_equals("blocks", "on"),
+        .cpu_jit = sargs_equals("jit", "on")
         };
 }
 
-uint8_t tape_bytes[20*1024*1024];
 #include <stdio.h>
 /* one-time application init */
-void app_init() {
+void app_init(void* user_data) {
+    app_t* app = (app_t*) user_data;
     gfx_init(&(gfx_desc_t){
         #ifdef CHIPS_USE_UI
         .draw_extra_cb = ui_draw,
         #endif
     });
-    keybuf_init(6);
-    clock_init();
-    saudio_setup(&(saudio_desc){0});
-    fs_init();
+    keybuf_init(&app->keybuf, 6);
+    clock_init(&app->clock);
+    /* audio=n sets the audio buffer size in frames */
+    const int audio_frames = sargs_exists("audio") ? atoi(sargs_value("audio")) : 1024;
+    audio_ring_init(&app->audio, 4 * audio_frames);
+    saudio_setup(&(saudio_desc){
+        .num_channels = 1,
+        .buffer_frames = audio_frames,
+        .stream_userdata_cb = stream_audio,
+        .user_data = &app->audio,
+    });
+    fs_init(&app->fs);
+    app->audio_pacing = sargs_equals("pacing", "audio");
+    app->indexed = sargs_equals("video", "indexed");
+    app->gpu_decode = sargs_equals("video", "gpu");
+    #ifdef APP_USE_THREAD
+    if (sargs_equals("thread", "on")) {
+        app->threaded = true;
+        for (int i = 0; i < APP_NUM_FRAMES; i++) {
+            app->frames[i] = (uint32_t*) calloc(1, spc1000_max_display_size());
+        }
+        app->emu_frame = 0;
+        app->ready_frame = 1;
+        app->draw_frame = 2;
+    }
+    #endif
     spc1000_type_t type = SPC1000;
     if (sargs_exists("type")) {
         if (sargs_equals("type", "spc1000")) {
@@ -105,74 +254,502 @@ void app_init() {
     }
     spc1000_joystick_type_t joy_type = SPC1K_JOYSTICKTYPE_NONE;
     spc1000_desc_t desc = spc1000_desc(type, joy_type);
-    spc1000_init(&spc1000, &desc);
+    spc1000_t* sys = &app->spc1000;
+    spc1000_init(sys, &desc);
+    app->achieved_speed = 1.0f;
     #ifdef CHIPS_USE_UI
-    spc1000ui_init(&spc1000);
+    spc1000ui_init(sys, &app->keybuf, app->threaded);
     #endif
     bool delay_input = false;
     if (sargs_exists("file")) {
 
-        if (!fs_load_file(sargs_value("file"))) {
+        if (!fs_load_file(&app->fs, sargs_value("file"))) {
             gfx_flash_error();
             delay_input = true;
         }
 		else
 		{
-			uint8_t* tape_ptr = (uint8_t*)fs_ptr();
-            spc1000_insert_tape(&spc1000, fs_ptr(), fs_size());
+            spc1000_insert_tape(sys, fs_ptr(&app->fs), fs_size(&app->fs));
 		}
     } else {
-        spc1000_insert_tape(&spc1000, desc.tap_spc1000, desc.tap_spc1000_size); 
+        spc1000_insert_tape(sys, desc.tap_spc1000, desc.tap_spc1000_size); 
     }
     if (!delay_input) {
         if (sargs_exists("input")) {
-            keybuf_put(sargs_value("input"));
+            keybuf_put(&app->keybuf, sargs_value("input"));
+        }
+    }
+    if (sargs_exists("speed")) {
+        if (sargs_equals("speed", "max")) {
+            app->unthrottled = true;
+        }
+        else {
+            float speed = (float) atof(sargs_value("speed"));
+            if (speed > 0.0f) {
+                spc1000_set_speed(sys, speed, speed > 1.0f);
+            }
+        }
+    }
+    if (!sargs_equals("rewind", "off")) {
+        /* rewind=n sets the buffer size in MB */
+        app->rewind_state_size = spc1000_save_state(sys, 0, 0);
+        app->rewind_state = (uint8_t*) malloc(app->rewind_state_size);
+        rewind_init(&app->rewind, &(rewind_desc_t){
+            .state_size = app->rewind_state_size,
+            .buffer_size = sargs_exists("rewind") ? atoi(sargs_value("rewind")) * 1024 * 1024 : 0,
+        });
+    }
+    app->last_frame_time = stm_now();
+    #ifdef APP_USE_THREAD
+    if (sargs_exists("capture") || sargs_exists("capture_audio")) {
+        /*  capture=file writes a Y4M file, with capture_format=raw raw RGBA8
+            frames (for instance into a named pipe), capture_audio=file a WAV
+            file, capture_buffers=n sets the number of queued frames
+        */
+        if (sargs_exists("capture") && (app->indexed || app->gpu_decode)) {
+            printf("capture needs RGBA8 video (video=%s), not capturing\n", sargs_value("video"));
+        }
+        else {
+            capture_start(&app->capture, &(capture_desc_t){
+                .width = spc1000_display_width(sys),
+                .height = spc1000_display_height(sys),
+                .fps = 1000000 / APP_FRAME_US,
+                .format = sargs_equals("capture_format", "raw") ? CAPTURE_RAW : CAPTURE_Y4M,
+                .video_path = sargs_exists("capture") ? sargs_value("capture") : 0,
+                .audio_path = sargs_exists("capture_audio") ? sargs_value("capture_audio") : 0,
+                .sample_rate = saudio_sample_rate(),
+                .num_buffers = sargs_exists("capture_buffers") ? atoi(sargs_value("capture_buffers")) : 0,
+            });
+            app->capturing = true;
+            app->capture_change_count = sys->vdg.change_count - 1;
+        }
+    }
+    if (app->threaded) {
+        clock_init(&app->emu_clock);
+        pthread_mutex_init(&app->lock, 0);
+        pthread_create(&app->thread, 0, emu_thread, app);
+    }
+    #endif
+}
+
+/* render thread: queue an event for the emulator thread, dropped if the queue is full */
+static void queue_event(app_t* app, const app_event_t* event) {
+    const uint32_t wr = app->event_write;
+    if ((wr - __atomic_load_n(&app->event_read, __ATOMIC_ACQUIRE)) < APP_NUM_EVENTS) {
+        app->events[wr % APP_NUM_EVENTS] = *event;
+        __atomic_store_n(&app->event_write, wr + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void post_event(app_t* app, app_event_type_t type, int val) {
+    queue_event(app, &(app_event_t){ .type = type, .val = val });
+}
+
+/* emulator thread: take the next event, false if there is none */
+static bool next_event(app_t* app, app_event_t* event) {
+    const uint32_t rd = app->event_read;
+    if (rd == __atomic_load_n(&app->event_write, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *event = app->events[rd % APP_NUM_EVENTS];
+    __atomic_store_n(&app->event_read, rd + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* forward a key press or release to the emulator */
+static void app_key(app_t* app, int c, bool down) {
+    if (app->threaded) {
+        post_event(app, down ? APP_EVENT_KEY_DOWN : APP_EVENT_KEY_UP, c);
+    }
+    else if (down) {
+        spc1000_key_down(&app->spc1000, c);
+    }
+    else {
+        spc1000_key_up(&app->spc1000, c);
+    }
+}
+
+static void app_rewind_key(app_t* app, bool down) {
+    if (app->threaded) {
+        post_event(app, APP_EVENT_REWIND_KEY, down);
+    }
+    else {
+        app->rewind_key = down;
+    }
+}
+
+/* reboot into a different configuration */
+void app_boot(spc1000_t* sys, spc1000_type_t type) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (app->threaded) {
+        post_event(app, APP_EVENT_BOOT, type);
+    }
+    else {
+        spc1000_desc_t desc = spc1000_desc(type, sys->joystick_type);
+        spc1000_discard(sys);
+        spc1000_init(sys, &desc);
+    }
+}
+
+/*  emulator state changes from the UI, with thread=on they are queued
+    for the emulator thread like reboots
+*/
+void app_reset(spc1000_t* sys) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (app->threaded) {
+        post_event(app, APP_EVENT_RESET, 0);
+    }
+    else {
+        spc1000_reset(sys);
+    }
+}
+
+void app_set_speed(spc1000_t* sys, float speed, bool skip_audio) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (app->threaded) {
+        queue_event(app, &(app_event_t){ .type = APP_EVENT_SPEED, .val = skip_audio, .speed = speed });
+    }
+    else {
+        spc1000_set_speed(sys, speed, skip_audio);
+    }
+}
+
+void app_set_tape_fastload(spc1000_t* sys, bool enabled) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (app->threaded) {
+        post_event(app, APP_EVENT_TAPE_FASTLOAD, enabled);
+    }
+    else {
+        spc1000_set_tape_fastload(sys, enabled);
+    }
+}
+
+void app_set_tape_num(spc1000_t* sys, int num) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (app->threaded) {
+        post_event(app, APP_EVENT_TAPE_NUM, num);
+    }
+    else {
+        spc1000_set_tape_num(sys, num);
+    }
+}
+
+/* the tape data must stay valid until the emulator thread has taken it */
+bool app_insert_tape(spc1000_t* sys, const uint8_t* ptr, int num_bytes) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (app->threaded) {
+        queue_event(app, &(app_event_t){ .type = APP_EVENT_INSERT_TAPE, .val = num_bytes, .ptr = ptr });
+        return num_bytes > 0;
+    }
+    return spc1000_insert_tape(sys, ptr, num_bytes);
+}
+
+/* memory editor writes, layer 0 is the CPU mapped memory, layer 1 the video memory */
+static void write_mem(spc1000_t* sys, int layer, uint16_t addr, uint8_t data) {
+    if (0 == layer) {
+        mem_wr(&sys->mem, addr, data);
+        z80_invalidate_blocks(&sys->cpu, addr, 1);
+    }
+    else if ((1 == layer) && (addr < sizeof(sys->vram))) {
+        sys->vram[addr] = data;
+        mc6847_invalidate(&sys->vdg);
+    }
+}
+
+void app_mem_write(spc1000_t* sys, int layer, uint16_t addr, uint8_t data) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (app->threaded) {
+        queue_event(app, &(app_event_t){ .type = APP_EVENT_MEM_WRITE, .val = data, .layer = layer, .addr = addr });
+    }
+    else {
+        write_mem(sys, layer, addr, data);
+    }
+}
+
+static int rewind_frames(app_t* app, spc1000_t* sys, int num_frames) {
+    int n = 0;
+    while ((n < num_frames) && rewind_pop(&app->rewind, app->rewind_state)) {
+        n++;
+    }
+    if (n > 0) {
+        spc1000_load_state(sys, app->rewind_state, app->rewind_state_size);
+    }
+    return n;
+}
+
+/* step back a number of frames, with num_frames=0 only return the number of frames available */
+int app_rewind(spc1000_t* sys, int num_frames) {
+    app_t* app = (app_t*) sapp_userdata();
+    if (!app->rewind_state) {
+        return 0;
+    }
+    if (0 == num_frames) {
+        return __atomic_load_n(&app->rewind.num, __ATOMIC_RELAXED);
+    }
+    if (app->threaded) {
+        post_event(app, APP_EVENT_REWIND, num_frames);
+        return num_frames;
+    }
+    return rewind_frames(app, sys, num_frames);
+}
+
+/* push the current state into the rewind buffer, unless the machine is stopped */
+static void rewind_push_frame(app_t* app, uint32_t tick_count) {
+    if (app->rewind_state && (tick_count != app->spc1000.tick_count)) {
+        spc1000_save_state(&app->spc1000, app->rewind_state, app->rewind_state_size);
+        rewind_push(&app->rewind, app->rewind_state);
+    }
+}
+
+/*  measure the achieved speed multiplier, in unthrottled mode also adjust
+    the requested speed so that emulation takes about 3/4 of a frame
+*/
+static void update_speed(app_t* app, uint32_t frame_count, uint32_t frame_time_us, uint64_t exec_time) {
+    spc1000_t* sys = &app->spc1000;
+    (void)frame_count;
+    double emu_us = frame_time_us * spc1000_speed(sys);
+    double wall_us = stm_us(stm_laptime(&app->last_frame_time));
+    if (wall_us > 0.0) {
+        app->achieved_speed = (float) (emu_us / wall_us);
+    }
+    if (app->unthrottled) {
+        double exec_us = stm_us(exec_time);
+        float speed = sys->speed * (float) ((0.75 * frame_time_us) / (exec_us > 1.0 ? exec_us : 1.0));
+        speed = 0.5f * (speed + sys->speed);
+        if (speed < 1.0f) {
+            speed = 1.0f;
+        }
+        else if (speed > 1000.0f) {
+            speed = 1000.0f;
+        }
+        spc1000_set_speed(sys, speed, true);
+    }
+    #if !CHIPS_USE_UI
+        if (sargs_exists("speed") && (0 == (frame_count % 60))) {
+            printf("speed: x%.1f audio: %d/%d underruns: %u\n", app->achieved_speed,
+                audio_ring_fill(&app->audio), audio_ring_size(&app->audio), audio_ring_underruns(&app->audio));
+        }
+    #endif
+}
+
+/*  audio pacing: the audio device consumes samples at its own clock, keep
+    the audio ring half full by resampling by up to +-0.5%, and when the fill
+    level is far off (startup, stalls) also by changing the frame's tick budget
+*/
+static uint32_t pace_audio(app_t* app, uint32_t frame_time_us) {
+    spc1000_t* sys = &app->spc1000;
+    if ((spc1000_speed(sys) != 1.0f) || (saudio_sample_rate() <= 0)) {
+        return frame_time_us;
+    }
+    const int target = audio_ring_size(&app->audio) / 2;
+    const int missing = target - audio_ring_fill(&app->audio);
+    float error = (float)missing / (float)target;
+    error = (error < -1.0f) ? -1.0f : ((error > 1.0f) ? 1.0f : error);
+    spc1000_set_audio_rate(sys, 1.0f + APP_MAX_RATE_ADJUST * error);
+    if ((error < -0.5f) || (error > 0.5f)) {
+        int64_t budget_us = frame_time_us + ((int64_t)missing * 1000000) / (2 * saudio_sample_rate());
+        if (budget_us < 0) {
+            budget_us = 0;
+        }
+        else if (budget_us > (2 * frame_time_us)) {
+            budget_us = 2 * frame_time_us;
+        }
+        return (uint32_t) budget_us;
+    }
+    return frame_time_us;
+}
+
+/* run the emulator for one frame, or step back one frame while rewinding */
+static void run_frame(app_t* app, clock_state* clk) {
+    spc1000_t* sys = &app->spc1000;
+    uint32_t frame_time_us = clock_frame_time(clk);
+    if (app->audio_pacing) {
+        frame_time_us = pace_audio(app, frame_time_us);
+    }
+    const uint64_t exec_start = stm_now();
+    if (app->rewind_key) {
+        rewind_frames(app, sys, 1);
+    }
+    else {
+        const uint32_t tick_count = sys->tick_count;
+        #if CHIPS_USE_UI
+        if (!app->threaded) {
+            spc1000ui_exec(sys, frame_time_us);
+        }
+        else
+        #endif
+        spc1000_exec(sys, frame_time_us);
+        rewind_push_frame(app, tick_count);
+    }
+    #ifdef APP_USE_THREAD
+    if (app->capturing && app->capture.video_path) {
+        /* never waits for the writer, unchanged frames are repeated without a copy */
+        const bool changed = sys->vdg.change_count != app->capture_change_count;
+        app->capture_change_count = sys->vdg.change_count;
+        capture_video(&app->capture, changed ? sys->vdg.rgba8_buffer : 0);
+    }
+    #endif
+    update_speed(app, clock_frame_count(clk), frame_time_us, stm_since(exec_start));
+}
+
+#ifdef APP_USE_THREAD
+static void handle_events(app_t* app) {
+    spc1000_t* sys = &app->spc1000;
+    app_event_t event;
+    while (next_event(app, &event)) {
+        switch (event.type) {
+            case APP_EVENT_KEY_DOWN:    spc1000_key_down(sys, event.val); break;
+            case APP_EVENT_KEY_UP:      spc1000_key_up(sys, event.val); break;
+            case APP_EVENT_REWIND_KEY:  app->rewind_key = (0 != event.val); break;
+            case APP_EVENT_REWIND:      rewind_frames(app, sys, event.val); break;
+            case APP_EVENT_BOOT: {
+                    /* the render thread must not see the machine half initialized */
+                    spc1000_desc_t desc = spc1000_desc((spc1000_type_t)event.val, sys->joystick_type);
+                    pthread_mutex_lock(&app->lock);
+                    spc1000_discard(sys);
+                    spc1000_init(sys, &desc);
+                    pthread_mutex_unlock(&app->lock);
+                }
+                break;
+            case APP_EVENT_RESET:           spc1000_reset(sys); break;
+            case APP_EVENT_SPEED:           spc1000_set_speed(sys, event.speed, 0 != event.val); break;
+            case APP_EVENT_TAPE_FASTLOAD:   spc1000_set_tape_fastload(sys, 0 != event.val); break;
+            case APP_EVENT_TAPE_NUM:        spc1000_set_tape_num(sys, event.val); break;
+            case APP_EVENT_INSERT_TAPE:
+                /* frees the old tape, which the UI may be reading */
+                pthread_mutex_lock(&app->lock);
+                spc1000_insert_tape(sys, event.ptr, event.val);
+                pthread_mutex_unlock(&app->lock);
+                break;
+            case APP_EVENT_MEM_WRITE:       write_mem(sys, event.layer, event.addr, (uint8_t)event.val); break;
+        }
+    }
+}
+
+/* the emulator thread, runs one frame every 16.7 ms independent of the display */
+static void* emu_thread(void* arg) {
+    app_t* app = (app_t*) arg;
+    const uint64_t start = stm_now();
+    double deadline_us = 0.0;
+    while (!__atomic_load_n(&app->quit, __ATOMIC_ACQUIRE)) {
+        handle_events(app);
+        run_frame(app, &app->emu_clock);
+        /* publish a changed frame and continue in the buffer that was swapped out,
+           with a copy of the frame, so that only changed lines are decoded again
+           (with video=gpu the buffers hold the packed frame data instead)
+        */
+        if (app->spc1000.vdg.change_count != app->frame_change_count) {
+            app->frame_change_count = app->spc1000.vdg.change_count;
+            if (app->gpu_decode) {
+                mc6847_frame_data(&app->spc1000.vdg, (uint8_t*) app->frames[app->emu_frame]);
+            }
+            const int prev = __atomic_exchange_n(&app->ready_frame, app->emu_frame | APP_FRAME_NEW, __ATOMIC_ACQ_REL);
+            app->emu_frame = prev & ~APP_FRAME_NEW;
+            if (!app->gpu_decode) {
+                mc6847_move_buffer(&app->spc1000.vdg, app->frames[app->emu_frame]);
+            }
         }
+
+        deadline_us += APP_FRAME_US;
+        const double now_us = stm_us(stm_since(start));
+        if (deadline_us > now_us) {
+            const double wait_us = deadline_us - now_us;
+            struct timespec ts = { .tv_sec = (time_t)(wait_us / 1e6), .tv_nsec = (long)(((uint64_t)wait_us % 1000000) * 1000) };
+            nanosleep(&ts, 0);
+        }
+        else if ((now_us - deadline_us) > 100000.0) {
+            /* too far behind (debugger, suspended process), don't try to catch up */
+            deadline_us = now_us;
+        }
+    }
+    return 0;
+}
+#endif
+
+/* draw a decoded frame, RGBA8, color indices or packed MC6847 frame data */
+static void draw_frame(app_t* app, const uint32_t* pixels) {
+    spc1000_t* sys = &app->spc1000;
+    const int w = spc1000_display_width(sys);
+    const int h = spc1000_display_height(sys);
+    if (app->gpu_decode) {
+        uint32_t colors[MC6847_NUM_COLORS];
+        mc6847_colors(&sys->vdg, colors);
+        gfx_draw_mc6847((const uint8_t*) pixels, colors, MC6847_NUM_COLORS, w, h);
+    }
+    else if (app->indexed) {
+        uint32_t colors[MC6847_NUM_COLORS];
+        mc6847_colors(&sys->vdg, colors);
+        gfx_draw_indexed((const uint8_t*) pixels, colors, MC6847_NUM_COLORS, w, h);
+    }
+    else {
+        gfx_draw_pixels(pixels, w, h);
     }
 }
 
 /* per frame stuff, tick the emulator, handle input, decode and draw emulator display */
-void app_frame() {
+void app_frame(void* user_data) {
+    app_t* app = (app_t*) user_data;
+    spc1000_t* sys = &app->spc1000;
+    if (app->threaded) {
+        clock_frame_time(&app->clock);
+        #ifdef APP_USE_THREAD
+        pthread_mutex_lock(&app->lock);
+        #endif
+        if (__atomic_load_n(&app->ready_frame, __ATOMIC_ACQUIRE) & APP_FRAME_NEW) {
+            app->draw_frame = __atomic_exchange_n(&app->ready_frame, app->draw_frame, __ATOMIC_ACQ_REL) & ~APP_FRAME_NEW;
+            draw_frame(app, app->frames[app->draw_frame]);
+        }
+        else {
+            gfx_redraw();
+        }
+        #ifdef APP_USE_THREAD
+        pthread_mutex_unlock(&app->lock);
+        #endif
+    }
+    else {
+        run_frame(app, &app->clock);
+        if (sys->vdg.change_count != app->frame_change_count) {
+            app->frame_change_count = sys->vdg.change_count;
+            if (app->gpu_decode) {
+                mc6847_frame_data(&sys->vdg, (uint8_t*) gfx_framebuffer());
+            }
+            draw_frame(app, gfx_framebuffer());
+        }
+        else {
+            gfx_redraw();
+        }
+    }
     #if CHIPS_USE_UI
-        spc1000ui_exec(&spc1000, (int)(clock_frame_time()*spc1000.speed));
-    #else
-        spc1000_exec(&spc1000, (int)(clock_frame_time()*spc1000.speed));
+    spc1000ui_set_speed(app->achieved_speed);
     #endif
-    gfx_draw(spc1000_display_width(&spc1000), spc1000_display_height(&spc1000));
     const uint32_t load_delay_frames = 60;
-    static bool completed = false;
-    if (fs_ptr() && clock_frame_count() > load_delay_frames) {
+    if (fs_ptr(&app->fs) && clock_frame_count(&app->clock) > load_delay_frames) {
         bool load_success = false;
-        if (fs_ext("txt") || fs_ext("bas")) {
+        if (fs_ext(&app->fs, "txt") || fs_ext(&app->fs, "bas")) {
             load_success = true;
-            keybuf_put((const char*)fs_ptr());
+            keybuf_put(&app->keybuf, (const char*)fs_ptr(&app->fs));
         }
         else {
-            //load_success = spc1000_tapeload(&spc1000, fs_ptr(), fs_size());
-            //printf("dat=%s\n", fs_ptr());
+            //load_success = spc1000_tapeload(sys, fs_ptr(&app->fs), fs_size(&app->fs));
         }
 
         if (load_success) {
-            if (clock_frame_count() > (load_delay_frames + 10)) {
+            if (clock_frame_count(&app->clock) > (load_delay_frames + 10)) {
                 gfx_flash_success();
             }  
         }
         else {
             gfx_flash_error();
         }
-        fs_free();
+        fs_free(&app->fs);
     }
-    if (completed == false && clock_frame_count() > (load_delay_frames + 10)) {
-        //keybuf_put("load\n");
-        completed = true;
-    } 
 	if (sargs_exists("input")) {
-		keybuf_put(sargs_value("input"));
+		keybuf_put(&app->keybuf, sargs_value("input"));
 	}
     uint8_t key_code;
-    if (0 != (key_code = keybuf_get())) {
-        spc1000_key_down(&spc1000, key_code);
-        spc1000_key_up(&spc1000, key_code);
+    if (0 != (key_code = keybuf_get(&app->keybuf))) {
+        app_key(app, key_code, true);
+        app_key(app, key_code, false);
     }
 }
 
@@ -180,6 +757,7 @@ void app_frame() {
 #ifdef SDL2
 #include <SDL.h>
 void sdl_keyinput(const SDL_Event *event) {
+	app_t* app = (app_t*) sapp_userdata();
 	int c = 0;
 	switch (event->key.keysym.sym)
 	{
@@ -204,20 +782,17 @@ void sdl_keyinput(const SDL_Event *event) {
 		case SDLK_LALT:			c = 0xF8; break;
 		case SDLK_RSHIFT:
 		case SDLK_LSHIFT:		c = 0x0E; break;
+		case SDLK_F12:			app_rewind_key(app, event->type == SDL_KEYDOWN); break;
 	}
 	if (event->key.keysym.sym > 0x20 && event->key.keysym.sym < 0x7f)
 		c = event->key.keysym.sym;
 	if (c) {
-		if (event->type == SDL_KEYDOWN) {
-			spc1000_key_down(&spc1000, c);
-		}
-		else {
-			spc1000_key_up(&spc1000, c);
-		}
+		app_key(app, c, event->type == SDL_KEYDOWN);
 	}	
 }
 #endif
-void app_input(const sapp_event* event) {
+void app_input(const sapp_event* event, void* user_data) {
+    app_t* app = (app_t*) user_data;
     #ifdef CHIPS_USE_UI
     if (ui_input(event)) {
         /* input was handled by UI */
@@ -230,8 +805,8 @@ void app_input(const sapp_event* event) {
         case SAPP_EVENTTYPE_CHAR:
             c = (int) event->char_code;
             if ((c > 0x20) && (c < 0x7F)) {
-                spc1000_key_down(&spc1000, c);
-                spc1000_key_up(&spc1000, c);
+                app_key(app, c, true);
+                app_key(app, c, false);
             }
             break;
 #endif
@@ -259,18 +834,17 @@ void app_input(const sapp_event* event) {
 				case SAPP_KEYCODE_LEFT_ALT:		c = 0xF8; break;
 				case SAPP_KEYCODE_RIGHT_SHIFT:
 				case SAPP_KEYCODE_LEFT_SHIFT:	c = 0x0E; break;
+                case SAPP_KEYCODE_F12:
+                    app_rewind_key(app, event->type == SAPP_EVENTTYPE_KEY_DOWN);
+                    c = 0;
+                    break;
 
                 default:                        c = 0; break;
             }
 			if (event->key_code > 0x20 && event->key_code < 0x7f)
 				c = event->key_code;
             if (c) {
-                if (event->type == SAPP_EVENTTYPE_KEY_DOWN) {
-                    spc1000_key_down(&spc1000, c);
-                }
-                else {
-                    spc1000_key_up(&spc1000, c);
-                }
+                app_key(app, c, event->type == SAPP_EVENTTYPE_KEY_DOWN);
             }
             break;
         case SAPP_EVENTTYPE_TOUCHES_BEGAN:
@@ -282,12 +856,36 @@ void app_input(const sapp_event* event) {
 }
 
 /* application cleanup callback */
-void app_cleanup() {
-    spc1000_discard(&spc1000);
+void app_cleanup(void* user_data) {
+    app_t* app = (app_t*) user_data;
+    #ifdef APP_USE_THREAD
+    if (app->threaded) {
+        __atomic_store_n(&app->quit, true, __ATOMIC_RELEASE);
+        pthread_join(app->thread, 0);
+        pthread_mutex_destroy(&app->lock);
+    }
+    if (app->capturing) {
+        capture_stop(&app->capture);
+        capture_stats_t stats;
+        capture_stats(&app->capture, &stats);
+        printf("capture: %u frames, %u dropped, %u samples dropped%s\n", stats.written_frames,
+            stats.dropped_frames, stats.dropped_samples, stats.error ? ", write error" : "");
+    }
+    #endif
+    spc1000_discard(&app->spc1000);
+    if (app->rewind_state) {
+        rewind_discard(&app->rewind);
+        free(app->rewind_state);
+    }
     #ifdef CHIPS_USE_UI
     spc1000ui_discard();
     #endif
     saudio_shutdown();
+    audio_ring_discard(&app->audio);
     gfx_shutdown();
     sargs_shutdown();
+    for (int i = 0; i < APP_NUM_FRAMES; i++) {
+        free(app->frames[i]);
+    }
+    free(app);
 }
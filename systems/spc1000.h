@@ -65,7 +65,9 @@ extern "C" {
 
 #define SPC1K_MAX_AUDIO_SAMPLES (1024)       /* max number of audio samples in internal sample buffer */
 #define SPC1K_DEFAULT_AUDIO_SAMPLES (128)    /* default number of samples in internal sample buffer */
-#define SPC1K_MAX_TAPE_SIZE (1<<28)          /* max size of tape file in bytes */
+#define SPC1K_MAX_TAPE_FILES (50)            /* max number of file headers indexed on a tape */
+#define SPC1K_SPEED_TAPE (10.0f)             /* speed multiplier while the tape motor runs with the unpatched ROM */
+#define SPC1K_STATE_VERSION (1)              /* bumped whenever the save state layout changes */
 
 /* SPC-1000 models */
 typedef enum {
@@ -86,6 +88,12 @@ typedef enum {
 #define SPC1K_JOYSTICK_UP    (1<<3)
 #define SPC1K_JOYSTICK_BTN   (1<<4)
 
+/* device mask bits for spc1000_disable_devices(), used for benchmarking */
+#define SPC1K_DEVICE_VDG     (1<<0)     /* MC6847 video decoding, the sync timing keeps running */
+#define SPC1K_DEVICE_AY      (1<<1)     /* AY-3-8912 sound generation */
+#define SPC1K_DEVICE_BEEPER  (1<<2)     /* beeper output, it stays the sample clock while the AY is on */
+#define SPC1K_DEVICE_TAPE    (1<<3)     /* cassette tape, reads return 0 and fast-loading is off */
+
 /* audio sample data callback */
 typedef void (*spc1000_audio_callback_t)(const float* samples, int num_samples, void* user_data);
 
@@ -97,6 +105,8 @@ typedef struct {
     /* video output config */
     void* pixel_buffer;         /* pointer to a linear RGBA8 pixel buffer, at least 320*256*4 bytes */
     int pixel_buffer_size;      /* size of the pixel buffer in bytes */
+    bool pixel_index8;          /* write 8-bit MC6847 color indices instead of RGBA8 (see mc6847_colors()) */
+    bool external_decode;       /* no pixel buffer, the renderer decodes mc6847_frame_data() of sys->vdg */
 
     /* optional user-data for callbacks */
     void* user_data;
@@ -114,8 +124,22 @@ typedef struct {
     /* Tape image */
     const unsigned char* tap_spc1000;
     int tap_spc1000_size;
+    bool tape_fastload;         /* load tape blocks instantly by trapping the ROM tape routines */
+    bool idle_skip;             /* skip ahead to the next field sync while the CPU only polls the keyboard */
+    bool cpu_block_cache;       /* run the CPU from predecoded basic blocks, see spc1000_set_cpu_block_cache() */
+    bool cpu_jit;               /* translate the predecoded blocks into native code, see spc1000_set_cpu_jit() */
 } spc1000_desc_t;
 
+/* a cassette tape, created from a tape image and attached to a spc1000_t by pointer */
+typedef struct {
+    int size;           /* number of bits on the tape */
+    int pos;            /* current read position in bits */
+    int num;            /* number of file headers found on the tape */
+    char names[SPC1K_MAX_TAPE_FILES][18];   /* file names from the headers */
+    int numpos[SPC1K_MAX_TAPE_FILES];       /* bit position of each header */
+    uint8_t* bits;      /* tape bits packed MSB first, zero padded past the end */
+} spc1000_tape_t;
+
 /* Samsung spc1000 emulation state */
 typedef struct {
     z80_t cpu;    
@@ -135,9 +159,21 @@ typedef struct {
     uint8_t iplk;
     bool fs;
     uint32_t tick_count;
+    /* device scheduler, the audio devices and video chip are only ticked
+       lazily when the CPU touches them, or when the next scheduled event
+       is reached
+    */
+    uint32_t sched_next;        /* tick_count of the next scheduled device event */
+    uint32_t audio_tick;        /* tick_count up to which beeper and AY have been ticked */
+    uint32_t vdg_tick;          /* tick_count up to which the MC6847 has been ticked */
     uint32_t motor_start;
     clk_t clk;
     mem_t mem;
+    z80_page_t pages[Z80_NUM_PAGES];    /* the CPU's fast path view of mem */
+    bool cpu_fast_path;         /* memory accesses bypass the tick callback between device events */
+    bool cpu_block_cache;       /* instructions are fetched from cpu_blocks on the fast path */
+    z80_blocks_t cpu_blocks;    /* the CPU's predecoded basic blocks of mem */
+    bool cpu_jit;               /* the blocks run as native code where the recompiler supports them */
     kbd_t kbd;
     void* user_data;
     spc1000_audio_callback_t audio_cb;
@@ -148,17 +184,32 @@ typedef struct {
     uint8_t vram[0x2000];
     uint8_t rom[0x8000];
     /* tape loading */
-    int tape_size;  /* tape_size is > 0 if a tape is inserted */
-    int tape_pos;
-    int tape_num;
-    char *tape_names[50];
-    int tape_numpos[50];
-    uint8_t tape_buf[SPC1K_MAX_TAPE_SIZE];
+    spc1000_tape_t* tape;       /* currently attached tape, or 0 */
+    bool tape_owned;            /* tape was created by spc1000_insert_tape() */
+    bool tape_fastload;         /* ROM tape routines are trapped while a tape is attached */
     bool tapeMotor;
     bool pulse;
     bool printStatus;
     uint8_t tap;
-    float speed;
+    /* fast-forward, only video decoding and optionally audio are skipped,
+       the MC6847 sync timing and interrupts stay exact
+    */
+    float speed;            /* requested speed multiplier, 1.0 is realtime */
+    bool skip_audio;        /* don't generate audio samples while fast-forwarding */
+    bool tape_turbo;        /* tape motor runs with the unpatched ROM */
+    bool vdg_decode;        /* false while only the MC6847 sync counters run */
+    bool audio_mute;        /* true while audio generation is skipped */
+    int beeper_period;      /* nominal sample periods, see spc1000_set_audio_rate() */
+    int ay_sample_period;
+    uint8_t devices_off;    /* SPC1K_DEVICE_* mask of switched off devices */
+    /* idle skipping, not cycle-exact: when the CPU has only polled an
+       untouched keyboard for a while, the time up to the next field sync
+       interrupt is skipped without running the CPU
+    */
+    bool idle_skip;
+    int idle_polls;         /* keyboard polls without any other IO or RAM change */
+    uint8_t idle_stack;     /* stack pointer page when z80_exec() was last entered */
+    uint32_t idle_ticks;    /* skipped ticks, wraps around */
 } spc1000_t;
 
 /* initialize a new spc1000 instance */
@@ -175,8 +226,14 @@ int spc1000_display_width(spc1000_t* sys);
 int spc1000_display_height(spc1000_t* sys);
 /* reset spc1000 instance */
 void spc1000_reset(spc1000_t* sys);
-/* run spc1000 instance for a number of microseconds */
+/* run spc1000 instance for a number of microseconds (multiplied by the current speed) */
 void spc1000_exec(spc1000_t* sys, uint32_t micro_seconds);
+/* set the speed multiplier (1.0 is realtime), and whether audio is skipped when > 1.0 */
+void spc1000_set_speed(spc1000_t* sys, float speed, bool skip_audio);
+/* get the effective speed multiplier, this includes the automatic tape fast-forward */
+float spc1000_speed(spc1000_t* sys);
+/* scale the audio sample rate by a factor close to 1.0, for dynamic audio rate control */
+void spc1000_set_audio_rate(spc1000_t* sys, float ratio);
 /* send a key down event */
 void spc1000_key_down(spc1000_t* sys, int key_code);
 /* send a key up event */
@@ -187,7 +244,16 @@ void spc1000_set_joystick_type(spc1000_t* sys, spc1000_joystick_type_t type);
 spc1000_joystick_type_t spc1000_joystick_type(spc1000_t* sys);
 /* set joystick mask (combination of SPC1K_JOYSTICK_*) */
 void spc1000_joystick(spc1000_t* sys, uint8_t mask);
-/* insert a tape for loading (must be an spc1000 TAP file), data will be copied */
+/* create a tape from a TAP (text '0'/'1') or CAS (binary) image, data will be copied */
+spc1000_tape_t* spc1000_tape_create(const uint8_t* ptr, int num_bytes);
+/* destroy a tape created with spc1000_tape_create() */
+void spc1000_tape_destroy(spc1000_tape_t* tape);
+/* tape cursor: read the next bit, or the next 1..64 bits MSB first, bits past the end read as 0 */
+bool spc1000_tape_read_bit(spc1000_tape_t* tape);
+uint64_t spc1000_tape_read_bits(spc1000_tape_t* tape, int num_bits);
+/* attach a tape owned by the caller, it must stay alive until removed */
+void spc1000_attach_tape(spc1000_t* sys, spc1000_tape_t* tape);
+/* insert a tape for loading (TAP or CAS file), data will be copied into a tape owned by sys */
 bool spc1000_insert_tape(spc1000_t* sys, const uint8_t* ptr, int num_bytes);
 /* set a tape pos with number order */
 void spc1000_set_tape_num(spc1000_t* sys, int num);
@@ -195,6 +261,22 @@ void spc1000_set_tape_num(spc1000_t* sys, int num);
 int spc1000_get_tape_num(spc1000_t* sys);
 /* remove tape */
 void spc1000_remove_tape(spc1000_t* sys);
+/* enable/disable instant loading through the ROM tape routines */
+void spc1000_set_tape_fastload(spc1000_t* sys, bool enabled);
+/* switch off devices (SPC1K_DEVICE_* mask, 0 switches all back on) */
+void spc1000_disable_devices(spc1000_t* sys, uint8_t mask);
+/* enable/disable the CPU memory fast path (default: on), off runs every cycle through the tick callback */
+void spc1000_set_cpu_fast_path(spc1000_t* sys, bool enabled);
+/* enable/disable the CPU's predecoded basic-block cache (default: off), it only has an effect on the fast path */
+void spc1000_set_cpu_block_cache(spc1000_t* sys, bool enabled);
+/* enable/disable the CPU's recompiler (default: off, implies the block cache), returns false if the host isn't supported */
+bool spc1000_set_cpu_jit(spc1000_t* sys, bool enabled, bool verify);
+/* enable/disable skipping idle keyboard polling (not cycle-exact) */
+void spc1000_set_idle_skip(spc1000_t* sys, bool enabled);
+/* save the machine state into a buffer, returns the state size in bytes (query with ptr=0), nothing is written if it doesn't fit */
+int spc1000_save_state(spc1000_t* sys, void* ptr, int num_bytes);
+/* restore a state written by spc1000_save_state(), the same tape must be attached, fails on a version or size mismatch */
+bool spc1000_load_state(spc1000_t* sys, const void* ptr, int num_bytes);
 /* load a ZX Z80 file into the emulator */
 bool spc1000_quickload(spc1000_t* sys, const uint8_t* ptr, int num_bytes); 
 
@@ -214,12 +296,30 @@ bool spc1000_quickload(spc1000_t* sys, const uint8_t* ptr, int num_bytes);
 #endif
 
 #define _SPC1K_FREQUENCY (4000000)
+#define _SPC1K_IDLE_POLLS (32)      /* keyboard polls without other IO until the CPU counts as idle */
+#define _SPC1K_IDLE_PC_START (0x0D14)   /* BASIC's key wait loop and keyboard scan routine */
+#define _SPC1K_IDLE_PC_END (0x0DBC)
+
+/* the character attribute bits at VRAM 0x800 */
+#define ATTR_INV 0x1 // white
+#define ATTR_CSS 0x2 // cyan blue
+#define ATTR_SEM 0x4
+#define ATTR_EXT 0x8
 
 static uint64_t _spc1000_tick(int num, uint64_t pins, void* user_data);
 static uint64_t _spc1000_vdg_fetch(uint64_t pins, void* user_data);
+static void _spc1000_vram_dirty(spc1000_t* sys, uint16_t addr);
+static void _spc1000_sync_audio(spc1000_t* sys);
+static void _spc1000_sync_vdg(spc1000_t* sys);
+static void _spc1000_sched(spc1000_t* sys);
+static void _spc1000_update_fast_ticks(spc1000_t* sys);
 static void _spc1000_init_keymap(spc1000_t* sys);
 static void _spc1000_init_memorymap(spc1000_t* sys);
-static void _spc1000_osload(spc1000_t* sys);
+static void _spc1000_update_memorymap(spc1000_t* sys);
+static void _spc1000_update_trap(spc1000_t* sys);
+static void _spc1000_idle_poll(spc1000_t* sys, uint8_t data);
+static uint32_t _spc1000_run(spc1000_t* sys, uint32_t num_ticks);
+static bool _spc1000_tape_read_bit(spc1000_t* sys);
 //bool spc1000_tapeload(spc1000_t* sys, const uint8_t* ptr, int num_bytes);
 
 #define _SPC1K_DEFAULT(val,def) (((val) != 0) ? (val) : (def))
@@ -243,9 +343,7 @@ uint8_t _ay8910_read_callback(int port_id, void* user_data)
 #if 0            
             if (sys->ram[0x23b] == 0xc9 && sys->ram[0x3c4] == 0xc9)
             {
-                val = sys->tape_buf[sys->tape_pos++] == '1';
-                if (sys->tape_pos >= sys->tape_size)
-                    sys->tape_pos = 0;                
+                val = _spc1000_tape_read_bit(sys);
             }
             else
 #endif                
@@ -254,12 +352,8 @@ uint8_t _ay8910_read_callback(int port_id, void* user_data)
                 int t = (sys->tick_count - sys->motor_start) >> 5;
                 if (t > (*tap ? LTONE : STONE))
                 {
-                    *tap = sys->tape_buf[sys->tape_pos++] == '1';
-                    //printf("%d\r", 100 * sys->tape_pos / sys->tape_size);
-                    //fflush(stdout);
-                    if (sys->tape_pos > sys->tape_size)
-                        sys->tape_pos = 0;
-                    
+                    *tap = _spc1000_tape_read_bit(sys);
+
                     sys->motor_start = sys->tick_count;
                     t = 0;
                 }
@@ -278,7 +372,7 @@ uint8_t _ay8910_read_callback(int port_id, void* user_data)
 
 void spc1000_init(spc1000_t* sys, const spc1000_desc_t* desc) {
     CHIPS_ASSERT(sys && desc);
-    CHIPS_ASSERT(desc->pixel_buffer && (desc->pixel_buffer_size >= spc1000_max_display_size()));
+    CHIPS_ASSERT(desc->external_decode || (desc->pixel_buffer && (desc->pixel_buffer_size >= (desc->pixel_index8 ? (spc1000_max_display_size() / 4) : spc1000_max_display_size()))));
 
     memset(sys, 0, sizeof(spc1000_t));
     sys->valid = true;
@@ -286,7 +380,10 @@ void spc1000_init(spc1000_t* sys, const spc1000_desc_t* desc) {
     sys->user_data = desc->user_data;
     sys->audio_cb = desc->audio_cb;
 	sys->tapeMotor = false;
-    sys->speed = 1.0;
+    sys->tape_fastload = desc->tape_fastload;
+    sys->idle_skip = desc->idle_skip;
+    sys->speed = 1.0f;
+    sys->vdg_decode = true;
     sys->num_samples = _SPC1K_DEFAULT(desc->audio_num_samples, SPC1K_DEFAULT_AUDIO_SAMPLES);
     CHIPS_ASSERT(sys->num_samples <= SPC1K_MAX_AUDIO_SAMPLES);
     CHIPS_ASSERT(desc->rom_spc1000 && (desc->rom_spc1000_size == sizeof(sys->rom)));
@@ -300,14 +397,42 @@ void spc1000_init(spc1000_t* sys, const spc1000_desc_t* desc) {
     cpu_desc.tick_cb = _spc1000_tick;
     cpu_desc.user_data = sys;
     z80_init(&sys->cpu, &cpu_desc);
+    z80_set_pages(&sys->cpu, sys->pages);
+    sys->cpu_fast_path = true;
+    sys->cpu_block_cache = desc->cpu_block_cache;
+    if (sys->cpu_block_cache) {
+        z80_set_blocks(&sys->cpu, &sys->cpu_blocks, sys->rom, sizeof(sys->rom));
+    }
+    if (desc->cpu_jit) {
+        spc1000_set_cpu_jit(sys, true, false);
+    }
+    _spc1000_update_trap(sys);
 
     mc6847_desc_t vdg_desc;
     _SPC1K_CLEAR(vdg_desc);
-    vdg_desc.tick_hz = 3579545;
-    vdg_desc.rgba8_buffer = (uint32_t*) desc->pixel_buffer;
-    vdg_desc.rgba8_buffer_size = desc->pixel_buffer_size;
+    vdg_desc.tick_hz = _SPC1K_FREQUENCY;
+    if (desc->external_decode) {
+        vdg_desc.external_decode = true;
+    }
+    else if (desc->pixel_index8) {
+        vdg_desc.index8_buffer = (uint8_t*) desc->pixel_buffer;
+        vdg_desc.index8_buffer_size = desc->pixel_buffer_size;
+    }
+    else {
+        vdg_desc.rgba8_buffer = (uint32_t*) desc->pixel_buffer;
+        vdg_desc.rgba8_buffer_size = desc->pixel_buffer_size;
+    }
     vdg_desc.fetch_cb = _spc1000_vdg_fetch;
     vdg_desc.user_data = sys;
+    /* read VRAM directly, _spc1000_vdg_fetch() does the same through the callback */
+    vdg_desc.vram = sys->vram;
+    vdg_desc.vram_size = sizeof(sys->vram);
+    vdg_desc.attr_offset = 0x800;
+    vdg_desc.attr_inv = ATTR_INV;
+    vdg_desc.attr_css = ATTR_CSS;
+    vdg_desc.attr_intext = ATTR_EXT;
+    vdg_desc.attr_as = ATTR_SEM;
+    vdg_desc.dirty_tracking = true;
     mc6847_init(&sys->vdg, &vdg_desc);
 
     const int audio_hz = _SPC1K_DEFAULT(desc->audio_sample_rate, 44100);
@@ -326,10 +451,13 @@ void spc1000_init(spc1000_t* sys, const spc1000_desc_t* desc) {
     ay_desc.in_cb = _ay8910_read_callback;
     
     ay38910_init(&sys->ay, &ay_desc); 
+    sys->beeper_period = sys->beeper.period;
+    sys->ay_sample_period = sys->ay.sample_period;
     
     /* setup memory map and keyboard matrix */
     _spc1000_init_memorymap(sys);
     _spc1000_init_keymap(sys);
+    _spc1000_sched(sys);
 
     /* CPU start state */
     z80_set_pc(&sys->cpu, 0x0000);
@@ -361,6 +489,8 @@ void spc1000_init(spc1000_t* sys, const spc1000_desc_t* desc) {
 
 void spc1000_discard(spc1000_t* sys) {
     CHIPS_ASSERT(sys && sys->valid);
+    spc1000_remove_tape(sys);
+    spc1000_set_cpu_jit(sys, false, false);
     sys->valid = false;
 }
 
@@ -388,26 +518,71 @@ int spc1000_display_height(spc1000_t* sys) {
 
 void spc1000_reset(spc1000_t* sys) {
     CHIPS_ASSERT(sys && sys->valid);
+    _spc1000_sync_audio(sys);
+    _spc1000_sync_vdg(sys);
     z80_reset(&sys->cpu);
     mc6847_reset(&sys->vdg);
     beeper_reset(&sys->beeper);
+    sys->iplk = 0;
     _spc1000_init_memorymap(sys);
     z80_set_pc(&sys->cpu, 0x0000);
-    sys->iplk = 0;
     sys->tapeMotor = false;
-    sys->speed = 1.0;
+    sys->tape_turbo = false;
+    _spc1000_sched(sys);
 }
 
 void spc1000_exec(spc1000_t* sys, uint32_t micro_seconds) {
     CHIPS_ASSERT(sys && sys->valid);
-    uint32_t ticks_to_run = clk_ticks_to_run(&sys->clk, micro_seconds);
-    uint32_t ticks_executed = z80_exec(&sys->cpu, ticks_to_run);
+    const float speed = spc1000_speed(sys);
+    const bool fast_forward = speed > 1.0f;
+    uint32_t ticks_to_run = clk_ticks_to_run(&sys->clk, (uint32_t)(micro_seconds * speed));
+    uint32_t ticks_executed = 0;
+    sys->audio_mute = fast_forward && sys->skip_audio;
+    /* when fast-forwarding, only the last video field is decoded */
+    const uint32_t field_ticks = (uint32_t) ((MC6847_ALL_LINES * sys->vdg.h_period) / MC6847_FIXEDPOINT_SCALE);
+    if (fast_forward && (ticks_to_run > field_ticks)) {
+        sys->vdg_decode = false;
+        ticks_executed = _spc1000_run(sys, ticks_to_run - field_ticks);
+        _spc1000_sync_vdg(sys);
+        sys->vdg_decode = true;
+    }
+    if ((ticks_executed < ticks_to_run) && (0 == sys->cpu.trap_id)) {
+        ticks_executed += _spc1000_run(sys, ticks_to_run - ticks_executed);
+    }
     clk_ticks_executed(&sys->clk, ticks_executed);
+    /* bring the lazily ticked devices up to date */
+    _spc1000_sync_audio(sys);
+    _spc1000_sync_vdg(sys);
+    _spc1000_sched(sys);
     kbd_update(&sys->kbd); 
 }
 
+void spc1000_set_speed(spc1000_t* sys, float speed, bool skip_audio) {
+    CHIPS_ASSERT(sys && sys->valid && (speed > 0.0f));
+    sys->speed = speed;
+    sys->skip_audio = skip_audio;
+}
+
+void spc1000_set_audio_rate(spc1000_t* sys, float ratio) {
+    CHIPS_ASSERT(sys && sys->valid && (ratio > 0.5f) && (ratio < 2.0f));
+    _spc1000_sync_audio(sys);
+    /* more samples per second means a shorter sample period */
+    sys->beeper.period = (int) (sys->beeper_period / ratio);
+    sys->ay.sample_period = (int) (sys->ay_sample_period / ratio);
+    _spc1000_sched(sys);
+}
+
+float spc1000_speed(spc1000_t* sys) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (sys->tape_turbo && (sys->speed < SPC1K_SPEED_TAPE)) {
+        return SPC1K_SPEED_TAPE;
+    }
+    return sys->speed;
+}
+
 void spc1000_key_down(spc1000_t* sys, int key_code) {
     CHIPS_ASSERT(sys && sys->valid);
+    sys->idle_polls = 0;
     switch (sys->joystick_type) {
         case SPC1K_JOYSTICKTYPE_NONE:
             kbd_key_down(&sys->kbd, key_code);
@@ -444,6 +619,47 @@ void spc1000_key_up(spc1000_t* sys, int key_code) {
     }
 }
 
+void spc1000_disable_devices(spc1000_t* sys, uint8_t mask) {
+    CHIPS_ASSERT(sys && sys->valid);
+    _spc1000_sync_audio(sys);
+    _spc1000_sync_vdg(sys);
+    sys->devices_off = mask;
+    _spc1000_update_trap(sys);
+}
+
+void spc1000_set_cpu_fast_path(spc1000_t* sys, bool enabled) {
+    CHIPS_ASSERT(sys && sys->valid);
+    sys->cpu_fast_path = enabled;
+    z80_set_pages(&sys->cpu, enabled ? sys->pages : 0);
+    _spc1000_update_fast_ticks(sys);
+}
+
+void spc1000_set_cpu_block_cache(spc1000_t* sys, bool enabled) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (!enabled) {
+        spc1000_set_cpu_jit(sys, false, false);
+    }
+    sys->cpu_block_cache = enabled;
+    z80_set_blocks(&sys->cpu, enabled ? &sys->cpu_blocks : 0, sys->rom, sizeof(sys->rom));
+}
+
+bool spc1000_set_cpu_jit(spc1000_t* sys, bool enabled, bool verify) {
+    CHIPS_ASSERT(sys && sys->valid);
+    if (enabled && !sys->cpu_block_cache) {
+        spc1000_set_cpu_block_cache(sys, true);
+    }
+    sys->cpu_jit = z80_set_jit(&sys->cpu, enabled, verify) && enabled;
+    return sys->cpu_jit == enabled;
+}
+
+void spc1000_set_idle_skip(spc1000_t* sys, bool enabled) {
+    CHIPS_ASSERT(sys && sys->valid);
+    sys->idle_skip = enabled;
+    sys->idle_polls = 0;
+    _spc1000_update_trap(sys);
+    _spc1000_update_memorymap(sys);
+}
+
 void spc1000_set_joystick_type(spc1000_t* sys, spc1000_joystick_type_t type) {
     CHIPS_ASSERT(sys && sys->valid);
     sys->joystick_type = type;
@@ -460,37 +676,43 @@ void spc1000_joystick(spc1000_t* sys, uint8_t mask) {
 }
 
 
-/* CPU tick callback */
-static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
-	static int refresh = 0;
-	spc1000_t* sys = (spc1000_t*) user_data;
+/*  Device scheduler
 
-    /* tick the video chip */
-	refresh++;
-	if (sys->speed <= 1.0 || (refresh % 100 == 0))
-		mc6847_tick(&sys->vdg);
-    if ((sys->vdg.pins & MC6847_FS))
-    {
-        if (!sys->fs)
-            pins |= Z80_INT;
-        sys->fs = true;
-    }
-    else
-    {   if (sys->fs)
-            pins |= Z80_INT;
-        sys->fs = false;
+    The beeper, AY-3-8912 and MC6847 are not ticked from inside the CPU
+    tick callback. Instead, each device remembers the tick_count up to
+    which it has been ticked, and is brought up to date in one go when
+    the CPU is about to change its state through an IO port, when the 
+    next scheduled event is reached (the audio sample buffer is full, 
+    or the MC6847 field sync pin changes), or at the end of spc1000_exec().
+    
+    tick_count is a wrapping 32-bit timestamp, so timestamps must only
+    be compared through their signed difference.
+*/
+#define _SPC1K_REACHED(sys,t) ((int32_t)((sys)->tick_count-(t)) >= 0)
+
+/* tick the beeper and AY-3-8912 up to tick_count */
+static void _spc1000_sync_audio(spc1000_t* sys) {
+    const bool beeper_on = 0 == (sys->devices_off & SPC1K_DEVICE_BEEPER);
+    const bool ay_on = 0 == (sys->devices_off & SPC1K_DEVICE_AY);
+    if (sys->audio_mute || !(beeper_on || ay_on)) {
+        sys->audio_tick = sys->tick_count;
+        return;
     }
-    /* tick audio systems */
-    for (int i = 0; i < num_ticks; i++) {
-        sys->tick_count++;
+    uint32_t t = sys->audio_tick;
+    const uint32_t end = sys->tick_count;
+    while (t != end) {
+        t++;
+        /* the beeper is also the sample clock */
         bool sample_ready = beeper_tick(&sys->beeper);
         /* the AY-3-8912 chip runs at half CPU frequency */
-        if (sys->tick_count & 1) {
+        if (ay_on && (t & 1)) {
             ay38910_tick(&sys->ay);
         }
         if (sample_ready) {
-            float sample = sys->beeper.sample;
-            sample += sys->ay.sample;
+            float sample = beeper_on ? sys->beeper.sample : 0.0f;
+            if (ay_on) {
+                sample += sys->ay.sample;
+            }
             sys->sample_buffer[sys->sample_pos++] = sample;
             if (sys->sample_pos == sys->num_samples) {
                 if (sys->audio_cb) {
@@ -499,7 +721,55 @@ static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
                 sys->sample_pos = 0;
             }
         }
-    }    
+    }
+    sys->audio_tick = t;
+}
+
+/* run the MC6847 up to tick_count, this decodes all completed scanlines */
+static void _spc1000_sync_vdg(spc1000_t* sys) {
+    if (sys->vdg_decode && (0 == (sys->devices_off & SPC1K_DEVICE_VDG))) {
+        mc6847_exec(&sys->vdg, sys->tick_count - sys->vdg_tick);
+    }
+    else {
+        mc6847_skip(&sys->vdg, sys->tick_count - sys->vdg_tick);
+    }
+    sys->vdg_tick = sys->tick_count;
+}
+
+/* compute the tick_count of the next device event */
+static void _spc1000_sched(spc1000_t* sys) {
+    /* the audio devices are next needed when the sample buffer is full */
+    int num_samples = sys->num_samples - sys->sample_pos;
+    uint32_t audio_ticks = (uint32_t) ((num_samples * sys->beeper.period) / BEEPER_FIXEDPOINT_SCALE);
+    uint32_t audio_next = sys->audio_tick + (audio_ticks > 0 ? audio_ticks : 1);
+    /* the video chip is next needed when the field sync pin changes */
+    uint32_t vdg_next = sys->vdg_tick + mc6847_ticks_to_edge(&sys->vdg, MC6847_FS);
+    sys->sched_next = ((int32_t)(vdg_next - audio_next) < 0) ? vdg_next : audio_next;
+    _spc1000_update_fast_ticks(sys);
+}
+
+/* the CPU may skip the tick callback until the next scheduled event */
+static inline void _spc1000_update_fast_ticks(spc1000_t* sys) {
+    sys->cpu.fast_ticks = sys->cpu_fast_path ? (int)(sys->sched_next - sys->tick_count) : 0;
+}
+
+/* CPU tick callback */
+static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
+	spc1000_t* sys = (spc1000_t*) user_data;
+    sys->tick_count += num_ticks;
+
+    /* run scheduled device events */
+    if (_SPC1K_REACHED(sys, sys->sched_next)) {
+        _spc1000_sync_audio(sys);
+        _spc1000_sync_vdg(sys);
+        /* both field sync edges request an interrupt */
+        const bool fs = 0 != (sys->vdg.pins & MC6847_FS);
+        if (fs != sys->fs) {
+            pins |= Z80_INT;
+            sys->fs = fs;
+        }
+        _spc1000_sched(sys);
+    }
 
     /* memory and IO requests */
     if (pins & Z80_MREQ) 
@@ -510,16 +780,29 @@ static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
             Z80_SET_DATA(pins, !sys->iplk ? sys->rom[addr&0x7fff] : sys->ram[addr]);
         }
         else if (pins & Z80_WR) {
-            sys->ram[addr] = Z80_GET_DATA(pins);
+            const uint8_t data = Z80_GET_DATA(pins);
+            if ((sys->idle_polls > 0) && (sys->ram[addr] != data) && ((addr >> 8) != sys->idle_stack)) {
+                /* changing RAM outside the stack ends an idle phase */
+                sys->idle_polls = 0;
+            }
+            sys->ram[addr] = data;
         }
     }
     else if (pins & Z80_IORQ) 
     {
         const uint16_t Port = Z80_GET_ADDR(pins);
+        if ((Port < 0x8000) || (Port > 0x8009) || !(pins & Z80_RD)) {
+            /* any other IO (and the interrupt acknowledge) ends an idle phase */
+            sys->idle_polls = 0;
+        }
         if (pins & Z80_RD) {
             if (Port >= 0x8000 && Port <= 0x8009) {
                // Z80_SET_DATA(pins, &sys->keyMatrix[Port - 0x8009]);
-               Z80_SET_DATA(pins, kbd_scanlines(&sys->kbd, 1<<(Port-0x8000)));
+               const uint8_t data = kbd_scanlines(&sys->kbd, 1<<(Port-0x8000));
+               Z80_SET_DATA(pins, data);
+               if (sys->idle_skip) {
+                   _spc1000_idle_poll(sys, data);
+               }
             }
             else if ((Port & 0xe000) == 0x2000)
             {
@@ -534,27 +817,15 @@ static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
                 /* read from AY-3-8912 (11............0.) */
                 pins = ay38910_iorq(&sys->ay, AY38910_BC1|pins) & Z80_PIN_MASK;
             }
-            else if ((Port == 0x4002))
-            {
-                uint8_t val = sys->tape_buf[sys->tape_pos++] == '1';
-                if (sys->tape_pos > sys->tape_size)
-                    sys->tape_pos = 0;
-                //printf("%d", val);
-                fflush(stdout);
-                Z80_SET_DATA(pins, val << 7);
-            }
-            else if ((Port == 0x4003))
+            else if ((Port == 0x4002) || (Port == 0x4003))
             {
-                uint8_t val = sys->tape_buf[sys->tape_pos++] == '1';
-                if (sys->tape_pos > sys->tape_size)
-                    sys->tape_pos = 0;
-                //printf("|");
-                fflush(stdout);
+                uint8_t val = _spc1000_tape_read_bit(sys);
                 Z80_SET_DATA(pins, val << 7);
             }
             else if ((Port & 0xe000) == 0xa000)
             {
                 sys->iplk = !sys->iplk;
+                _spc1000_update_memorymap(sys);
             }
 			else
 				Z80_SET_DATA(pins, 0xff);
@@ -565,15 +836,22 @@ static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
             const uint16_t Port = Z80_GET_ADDR(pins);            
             if (Port < 0x2000) 
             {
-                sys->vram[Port] = data;
+                if (sys->vram[Port] != data) {
+                    /* scanlines up to now must be decoded from the old content */
+                    _spc1000_sync_vdg(sys);
+                    sys->vram[Port] = data;
+                    _spc1000_vram_dirty(sys, Port);
+                }
             }
             else if ((Port & 0xe000) == 0xa000)
             {
                 sys->iplk = !sys->iplk;
+                _spc1000_update_memorymap(sys);
             }
             else if ((Port & 0xE000) == 0x2000)	// GMODE setting
             {
 #define CHECK(a, b, c) ((a & (1 << b)) ? c : 0)                
+                _spc1000_sync_vdg(sys);
                 uint64_t vdg_pins = CHECK(data, 2, MC6847_GM0) | CHECK(data, 1, MC6847_GM1) | CHECK(data, 3, MC6847_AG) | CHECK(data, 7, MC6847_CSS) | MC6847_GM2;
                 uint64_t vdg_mask = MC6847_AG|MC6847_GM0|MC6847_GM1|MC6847_CSS|MC6847_GM2;
                 mc6847_ctrl(&sys->vdg, vdg_pins, vdg_mask);
@@ -585,7 +863,10 @@ static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
                 ay38910_iorq(&sys->ay, AY38910_BDIR|AY38910_BC1|pins);
             } else if ((Port & 0xFFFF) == 0x4001) // PSG Write
             {
-                /* write to AY-3-8912 (10............0.) */
+                /* write to AY-3-8912 (10............0.), the AY must
+                   have been ticked up to now before its registers change
+                */
+                _spc1000_sync_audio(sys);
                 ay38910_iorq(&sys->ay, AY38910_BDIR|pins);
             }
             else if ((Port & 0xe000) == 0x6000)
@@ -596,7 +877,7 @@ static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
 #if 0                    
                     if (sys->ram[0x23b] == 0xc9 && sys->ram[0x3c4] == 0xc9)
                     {
-                        sys->tape_pos--;
+                        if (sys->tape) sys->tape->pos--;
                         //printf("-");
                         fflush(stdout);
                     }
@@ -612,24 +893,35 @@ static uint64_t _spc1000_tick(int num_ticks, uint64_t pins, void* user_data) {
                     {
                         sys->motor_start = sys->tick_count;
                         if (sys->ram[0x23b] != 0xc9 && sys->ram[0x3c4] != 0xc9)
-                            sys->speed = 10.0;
+                            sys->tape_turbo = true;
                     }
                     else
                     {
                         sys->motor_start = 0;
-                        sys->speed = 1.0;
+                        sys->tape_turbo = false;
                     }
                 }
             }
         }
     }
+    _spc1000_update_fast_ticks(sys);
     return pins;
 }
 
-#define ATTR_INV 0x1 // white
-#define ATTR_CSS 0x2 // cyan blue
-#define ATTR_SEM 0x4
-#define ATTR_EXT 0x8
+/* mark the scanlines as dirty which _spc1000_vdg_fetch() reads from a VRAM address */
+static void _spc1000_vram_dirty(spc1000_t* sys, uint16_t addr) {
+    if (sys->vdg.pins & MC6847_AG) {
+        mc6847_invalidate_addr(&sys->vdg, addr);
+    }
+    else if (addr < 0x1000) {
+        /* a character or its attribute byte */
+        mc6847_invalidate_addr(&sys->vdg, addr & 0x7FF);
+    }
+    else if (addr < 0x1800) {
+        /* the external character generator */
+        mc6847_invalidate(&sys->vdg);
+    }
+}
 
 uint64_t _spc1000_vdg_fetch(uint64_t pins, void* user_data) {
     spc1000_t* sys = (spc1000_t*) user_data;
@@ -743,54 +1035,324 @@ static void _spc1000_init_memorymap(spc1000_t* sys) {
         sys->ram[i++] = (r>>24);
     }
     /* 64 KB RAM */
-    mem_map_ram(&sys->mem, 0, 0x0000, 0x10000, sys->ram);
     mem_map_ram(&sys->mem, 1, 0x0000, 0x2000, sys->vram);
-    /* 32 KB ROMs from 0x000 */
-    //mem_map_rom(&sys->mem, 1, 0x0000, 0x8000, sys->rom);
+    _spc1000_update_memorymap(sys);
 }
 
-/*=== FILE LOADING ===========================================================*/
-/* spc1000 TAP / ATM header (https://github.com/hoglet67/spc1000ulator/blob/master/docs/spc1000mmc2.txt ) */
+/*  map the CPU view of memory into layer 0: with IPLK off the 32 KB ROM
+    is read in both halves, writes always go to RAM, then rebuild the
+    CPU's fast path pages from the page table
+*/
+static void _spc1000_update_memorymap(spc1000_t* sys) {
+    if (sys->iplk) {
+        mem_map_ram(&sys->mem, 0, 0x0000, 0x10000, sys->ram);
+    }
+    else {
+        mem_map_rw(&sys->mem, 0, 0x0000, 0x8000, sys->rom, sys->ram);
+        mem_map_rw(&sys->mem, 0, 0x8000, 0x8000, sys->rom, sys->ram + 0x8000);
+    }
+    CHIPS_ASSERT(MEM_PAGE_SIZE == Z80_PAGE_SIZE);
+    for (int i = 0; i < Z80_NUM_PAGES; i++) {
+        sys->pages[i].read_ptr = sys->mem.page_table[i].read_ptr;
+        /* idle detection needs to see all memory writes */
+        sys->pages[i].write_ptr = sys->idle_skip ? 0 : sys->mem.page_table[i].write_ptr;
+    }
+}
+
+/*=== SAVE STATES ============================================================*/
+/*  A save state is a little-endian byte stream with a header (magic, 
+    version, size in bytes) followed by the emulator state, independent 
+    from the host's struct layout and byte order. Configuration which is
+    set up by spc1000_init() (callbacks, pixel buffer, ROM, palette,
+    keyboard mapping, audio rates) is not part of the state.
+
+    The same field list is used for saving and loading, so the two
+    directions can't get out of sync.
+*/
+#define _SPC1K_STATE_MAGIC (0x534B3153)     /* 'S1KS' */
+
 typedef struct {
-    uint8_t name[16];
-    uint16_t load_addr;
-    uint16_t exec_addr;
-    uint16_t length;
-} _spc1000_tap_header;
+    uint8_t* buf;       /* 0 when only computing the size */
+    int size;
+    int pos;
+    bool load;
+} _spc1000_state_t;
+
+static void _spc1000_state_bytes(_spc1000_state_t* st, void* ptr, int num_bytes) {
+    if (st->buf && ((st->pos + num_bytes) <= st->size)) {
+        if (st->load) {
+            memcpy(ptr, st->buf + st->pos, num_bytes);
+        }
+        else {
+            memcpy(st->buf + st->pos, ptr, num_bytes);
+        }
+    }
+    st->pos += num_bytes;
+}
 
-#if 0
-bool spc1000_insert_tape(spc1000_t* sys, const uint8_t* ptr, int num_bytes) {
+static void _spc1000_state_u64(_spc1000_state_t* st, uint64_t* val) {
+    uint8_t b[8];
+    for (int i = 0; i < 8; i++) {
+        b[i] = (uint8_t)(*val >> (i * 8));
+    }
+    _spc1000_state_bytes(st, b, 8);
+    if (st->load) {
+        *val = 0;
+        for (int i = 0; i < 8; i++) {
+            *val |= ((uint64_t)b[i]) << (i * 8);
+        }
+    }
+}
+
+static void _spc1000_state_u32(_spc1000_state_t* st, uint32_t* val) {
+    uint8_t b[4] = { (uint8_t)*val, (uint8_t)(*val>>8), (uint8_t)(*val>>16), (uint8_t)(*val>>24) };
+    _spc1000_state_bytes(st, b, 4);
+    if (st->load) {
+        *val = b[0] | (b[1]<<8) | (b[2]<<16) | ((uint32_t)b[3]<<24);
+    }
+}
+
+static void _spc1000_state_u16(_spc1000_state_t* st, uint16_t* val) {
+    uint8_t b[2] = { (uint8_t)*val, (uint8_t)(*val>>8) };
+    _spc1000_state_bytes(st, b, 2);
+    if (st->load) {
+        *val = b[0] | (b[1]<<8);
+    }
+}
+
+static void _spc1000_state_u8(_spc1000_state_t* st, uint8_t* val) {
+    _spc1000_state_bytes(st, val, 1);
+}
+
+static void _spc1000_state_int(_spc1000_state_t* st, int* val) {
+    uint32_t u = (uint32_t)*val;
+    _spc1000_state_u32(st, &u);
+    *val = (int)u;
+}
+
+static void _spc1000_state_bool(_spc1000_state_t* st, bool* val) {
+    uint8_t u = *val ? 1 : 0;
+    _spc1000_state_u8(st, &u);
+    *val = (u != 0);
+}
+
+static void _spc1000_state_float(_spc1000_state_t* st, float* val) {
+    uint32_t u;
+    memcpy(&u, val, sizeof(u));
+    _spc1000_state_u32(st, &u);
+    memcpy(val, &u, sizeof(u));
+}
+
+static void _spc1000_state(spc1000_t* sys, _spc1000_state_t* st) {
+    /* Z80 */
+    _spc1000_state_u64(st, &sys->cpu.bc_de_hl_fa);
+    _spc1000_state_u64(st, &sys->cpu.bc_de_hl_fa_);
+    _spc1000_state_u64(st, &sys->cpu.wz_ix_iy_sp);
+    _spc1000_state_u64(st, &sys->cpu.im_ir_pc_bits);
+    _spc1000_state_u64(st, &sys->cpu.pins);
+    /* MC6847 */
+    _spc1000_state_u64(st, &sys->vdg.pins);
+    _spc1000_state_int(st, &sys->vdg.h_count);
+    _spc1000_state_int(st, &sys->vdg.l_count);
+    /* AY-3-8912 */
+    ay38910_t* ay = &sys->ay;
+    _spc1000_state_u32(st, &ay->tick);
+    _spc1000_state_u8(st, &ay->addr);
+    _spc1000_state_bytes(st, ay->reg, AY38910_NUM_REGISTERS);
+    for (int i = 0; i < AY38910_NUM_CHANNELS; i++) {
+        ay38910_tone_t* tone = &ay->tone[i];
+        _spc1000_state_u16(st, &tone->period);
+        _spc1000_state_u16(st, &tone->counter);
+        _spc1000_state_u32(st, &tone->bit);
+        _spc1000_state_u32(st, &tone->tone_disable);
+        _spc1000_state_u32(st, &tone->noise_disable);
+    }
+    _spc1000_state_u16(st, &ay->noise.period);
+    _spc1000_state_u16(st, &ay->noise.counter);
+    _spc1000_state_u32(st, &ay->noise.rng);
+    _spc1000_state_u32(st, &ay->noise.bit);
+    _spc1000_state_u16(st, &ay->env.period);
+    _spc1000_state_u16(st, &ay->env.counter);
+    _spc1000_state_bool(st, &ay->env.shape_holding);
+    _spc1000_state_bool(st, &ay->env.shape_hold);
+    _spc1000_state_u8(st, &ay->env.shape_counter);
+    _spc1000_state_u8(st, &ay->env.shape_state);
+    _spc1000_state_u64(st, &ay->pins);
+    _spc1000_state_int(st, &ay->sample_counter);
+    _spc1000_state_float(st, &ay->sample);
+    /* beeper */
+    _spc1000_state_int(st, &sys->beeper.state);
+    _spc1000_state_int(st, &sys->beeper.counter);
+    _spc1000_state_float(st, &sys->beeper.sample);
+    /* keyboard matrix */
+    kbd_t* kbd = &sys->kbd;
+    _spc1000_state_u32(st, &kbd->frame_count);
+    _spc1000_state_u16(st, &kbd->active_columns);
+    _spc1000_state_u16(st, &kbd->active_lines);
+    for (int i = 0; i < KBD_MAX_PRESSED_KEYS; i++) {
+        key_state_t* key = &kbd->key_buffer[i];
+        _spc1000_state_int(st, &key->key);
+        _spc1000_state_u32(st, &key->mask);
+        _spc1000_state_u32(st, &key->pressed_frame);
+        _spc1000_state_u32(st, &key->released_frame);
+    }
+    _spc1000_state_bytes(st, kbd->keyMatrix, sizeof(kbd->keyMatrix));
+    _spc1000_state_int(st, &sys->clk.ticks_to_run);
+    _spc1000_state_int(st, &sys->clk.overrun_ticks);
+    /* system */
+    _spc1000_state_bool(st, &sys->out_cass0);
+    _spc1000_state_bool(st, &sys->out_cass1);
+    _spc1000_state_u8(st, &sys->kbd_joymask);
+    _spc1000_state_u8(st, &sys->joy_joymask);
+    _spc1000_state_u8(st, &sys->mmc_cmd);
+    _spc1000_state_u8(st, &sys->mmc_latch);
+    _spc1000_state_u8(st, &sys->gmode);
+    _spc1000_state_u8(st, &sys->iplk);
+    _spc1000_state_bool(st, &sys->fs);
+    _spc1000_state_u32(st, &sys->tick_count);
+    _spc1000_state_u32(st, &sys->audio_tick);
+    _spc1000_state_u32(st, &sys->vdg_tick);
+    _spc1000_state_u32(st, &sys->motor_start);
+    /* the audio sample buffer, its size is part of the configuration */
+    _spc1000_state_int(st, &sys->sample_pos);
+    if (st->load && ((sys->sample_pos < 0) || (sys->sample_pos >= sys->num_samples))) {
+        sys->sample_pos = 0;
+    }
+    for (int i = 0; i < sys->num_samples; i++) {
+        _spc1000_state_float(st, &sys->sample_buffer[i]);
+    }
+    _spc1000_state_bytes(st, sys->ram, sizeof(sys->ram));
+    _spc1000_state_bytes(st, sys->vram, sizeof(sys->vram));
+    /* tape cursor, the tape itself is not saved */
+    _spc1000_state_bool(st, &sys->tapeMotor);
+    _spc1000_state_bool(st, &sys->pulse);
+    _spc1000_state_bool(st, &sys->printStatus);
+    _spc1000_state_u8(st, &sys->tap);
+    _spc1000_state_bool(st, &sys->tape_turbo);
+    int tape_pos = sys->tape ? sys->tape->pos : -1;
+    _spc1000_state_int(st, &tape_pos);
+    if (st->load && sys->tape && (tape_pos >= 0) && (tape_pos <= sys->tape->size)) {
+        sys->tape->pos = tape_pos;
+    }
+}
+
+/* the state header: magic, version and total size */
+static void _spc1000_state_header(_spc1000_state_t* st, uint32_t* magic, uint32_t* version, uint32_t* size) {
+    _spc1000_state_u32(st, magic);
+    _spc1000_state_u32(st, version);
+    _spc1000_state_u32(st, size);
+}
+
+/* the state size only depends on the configuration */
+static int _spc1000_state_size(spc1000_t* sys) {
+    _spc1000_state_t st;
+    _SPC1K_CLEAR(st);
+    uint32_t magic = 0, version = 0, size = 0;
+    _spc1000_state_header(&st, &magic, &version, &size);
+    _spc1000_state(sys, &st);
+    return st.pos;
+}
+
+int spc1000_save_state(spc1000_t* sys, void* ptr, int num_bytes) {
     CHIPS_ASSERT(sys && sys->valid);
-    CHIPS_ASSERT(ptr);
-    spc1000_remove_tape(sys);
-    /* check for valid size */
-    if ((num_bytes < (int)sizeof(_spc1000_tap_header)) || (num_bytes > SPC1K_MAX_TAPE_SIZE)) {
+    const int size = _spc1000_state_size(sys);
+    if (ptr && (size <= num_bytes)) {
+        _spc1000_sync_audio(sys);
+        _spc1000_sync_vdg(sys);
+        _spc1000_state_t st;
+        _SPC1K_CLEAR(st);
+        st.buf = (uint8_t*) ptr;
+        st.size = size;
+        uint32_t magic = _SPC1K_STATE_MAGIC;
+        uint32_t version = SPC1K_STATE_VERSION;
+        uint32_t state_size = (uint32_t) size;
+        _spc1000_state_header(&st, &magic, &version, &state_size);
+        _spc1000_state(sys, &st);
+    }
+    return size;
+}
+
+bool spc1000_load_state(spc1000_t* sys, const void* ptr, int num_bytes) {
+    CHIPS_ASSERT(sys && sys->valid && ptr);
+    const int size = _spc1000_state_size(sys);
+    if (num_bytes != size) {
         return false;
     }
-    memcpy(sys->tape_buf, ptr, num_bytes);
-    
-    sys->tape_pos = 0;
-    sys->tape_size = num_bytes;
+    _spc1000_state_t st;
+    _SPC1K_CLEAR(st);
+    st.buf = (uint8_t*) ptr;
+    st.size = size;
+    st.load = true;
+    uint32_t magic = 0, version = 0, state_size = 0;
+    _spc1000_state_header(&st, &magic, &version, &state_size);
+    if ((magic != _SPC1K_STATE_MAGIC) || (version != SPC1K_STATE_VERSION) || (state_size != (uint32_t)size)) {
+        return false;
+    }
+    _spc1000_state(sys, &st);
+    /* the device scheduler and the video chip's transient pins */
+    sys->vdg.on = sys->vdg.off = 0;
+    mc6847_invalidate(&sys->vdg);
+    sys->cpu.trap_id = 0;
+    z80_invalidate_blocks(&sys->cpu, 0x0000, sizeof(sys->ram));
+    sys->idle_polls = 0;
+    _spc1000_update_trap(sys);
+    _spc1000_update_memorymap(sys);
+    _spc1000_sched(sys);
     return true;
 }
-#endif
-int skip_null_header(const uint8_t *data, int num)
+
+/*=== FILE LOADING ===========================================================*/
+/* extra zero bytes behind the tape bits, so that 64-bit reads never go out of bounds */
+#define _SPC1K_TAPE_PADDING (8)
+
+/* get 1..64 bits at a tape position, MSB first */
+static uint64_t _spc1000_tape_peek(const spc1000_tape_t* tape, int pos, int num_bits) {
+    CHIPS_ASSERT((num_bits > 0) && (num_bits <= 64));
+    if (pos >= tape->size) {
+        return 0;
+    }
+    uint64_t val = 0;
+    while (num_bits > 0) {
+        int shift = pos & 7;
+        int n = 8 - shift;
+        if (n > num_bits) {
+            n = num_bits;
+        }
+        uint8_t b = (uint8_t)(tape->bits[pos >> 3] << shift) >> (8 - n);
+        val = (val << n) | b;
+        pos += n;
+        num_bits -= n;
+    }
+    return val;
+}
+
+bool spc1000_tape_read_bit(spc1000_tape_t* tape) {
+    CHIPS_ASSERT(tape);
+    int pos = tape->pos++;
+    return (pos < tape->size) && (tape->bits[pos >> 3] & (0x80 >> (pos & 7)));
+}
+
+uint64_t spc1000_tape_read_bits(spc1000_tape_t* tape, int num_bits) {
+    CHIPS_ASSERT(tape);
+    uint64_t val = _spc1000_tape_peek(tape, tape->pos, num_bits);
+    tape->pos += num_bits;
+    return val;
+}
+
+/* find the next header preamble (40 '1' followed by 40 '0' bits) at or after pos */
+int skip_null_header(const spc1000_tape_t* tape, int pos)
 {
     int header0 = 0, header1 = 0;
     int rtn = -1;
-//    char str[100];
-    for(int i = 0; i < num; i++)
+    for(int i = pos; i < tape->size; i++)
     {
-        if (data[i] == '1')
+        if (_spc1000_tape_peek(tape, i, 1))
             header1++;
         else if (header1 == 40)
         {
             header0++;
             if (header0 == 40)
             {
-                // memcpy(str, &data[i-80], 80);
-                // str[81] = 0;
-                // printf("header>%s\n", str);
                 rtn = i - 79;
                 break;
             }
@@ -801,119 +1363,129 @@ int skip_null_header(const uint8_t *data, int num)
             header0 = 0;
         }
     }
-    fflush(stdout);
     return rtn;    
 }
 
-typedef struct  {
-	uint8_t type;
-	char name[17];
-	uint16_t size;
-	uint16_t load;
-	uint16_t jump;
-} HEADER;
-char getBytes(const uint8_t *data)
-{
-    char c = 0;
-    for(int i = 0; i < 8; i++)
-        c += (data[i] == '1' ? 1 << (7 -i) : 0);
-    return c;
-}
-char * get_header_info(const uint8_t *data)
+/* copy the 17 character file name of the tape header at pos, the type byte is followed by the name */
+static void _spc1000_tape_header_name(const spc1000_tape_t* tape, int pos, char* name)
 {
-    static HEADER head;  
-    // char header[100];
-    // memcpy(header, data, 80);
-    // printf("%s", header);
-    memset(head.name, 0, 16);
-    head.type = getBytes(data + 82);
     for(int i = 0; i < 17; i++)
     {
-        head.name[i] = getBytes(data + 91 + i * 9);
-        if (head.name[i] && (head.name[i] < '!' || head.name[i] > 'z'))
-            head.name[i] = ' ';
+        /* each byte is followed by a stop bit */
+        name[i] = (char) _spc1000_tape_peek(tape, pos + 91 + i * 9, 8);
+        if (name[i] && (name[i] < '!' || name[i] > 'z'))
+            name[i] = ' ';
     }
-    return head.name;
+    name[17] = 0;
 }
-bool spc1000_insert_tape(spc1000_t* sys, const uint8_t* ptr, int num_bytes) {
-    int bytes = 0, pos = 0, s = 0, header1 = 0, header0 = 0, num = 0;
-    CHIPS_ASSERT(sys && sys->valid);
-    CHIPS_ASSERT(ptr);
-    spc1000_remove_tape(sys);    
-    uint8_t *tapedata; 
+
+/* read the next bit from the attached tape, rewinds past the end */
+static bool _spc1000_tape_read_bit(spc1000_t* sys) {
+    spc1000_tape_t* tape = sys->tape;
+    if (!tape || (sys->devices_off & SPC1K_DEVICE_TAPE)) {
+        return false;
+    }
+    bool bit = spc1000_tape_read_bit(tape);
+    if (tape->pos > tape->size) {
+        tape->pos = 0;
+    }
+    return bit;
+}
+
+spc1000_tape_t* spc1000_tape_create(const uint8_t* ptr, int num_bytes) {
+    CHIPS_ASSERT(ptr && (num_bytes > 0));
+    spc1000_tape_t* tape = (spc1000_tape_t*) calloc(1, sizeof(spc1000_tape_t));
+    int num = 0;
     if (*ptr != '1' && *ptr != '0')
     {
-        if (!strcmp(ptr, "SPC-1000"))
+        /* binary CAS image, the bits are already packed, skip the file signature */
+        if ((num_bytes >= 16) && !memcmp(ptr, "SPC-1000", 8))
         {
-            s = 16;
+            ptr += 16;
+            num_bytes -= 16;
         }
-        bytes = num_bytes * 8;
-        tapedata = (uint8_t *) malloc(bytes);
-        for(int i = s; i < num_bytes; i++)
+        tape->bits = (uint8_t*) calloc(num_bytes + _SPC1K_TAPE_PADDING, 1);
+        memcpy(tape->bits, ptr, num_bytes);
+        tape->size = num_bytes * 8;
+        /* start at the first file header, shift the bits in place */
+        int start = skip_null_header(tape, 0);
+        if (start > 0)
         {
-            for (int j = 0; j < 8; j++)
+            int size = tape->size - start;
+            int num_out = (size + 7) / 8;
+            for (int i = 0; i < num_out; i++)
             {
-                tapedata[pos] = '0' + ((ptr[i] & (1 << (7 - j))) > 0 ? 1 : 0);
-                pos++;
+                tape->bits[i] = (uint8_t) _spc1000_tape_peek(tape, start + i * 8, 8);
             }
+            memset(tape->bits + num_out, 0, num_bytes - num_out);
+            tape->size = size;
         }
-        sys->tape_pos = 0;
-        pos = 0;
-        pos = skip_null_header(tapedata, bytes);
-        //printf("pos=%d\n", pos);
-        memcpy(sys->tape_buf, tapedata+pos, bytes-pos);
-        sys->tape_size = bytes-pos;
-        free(tapedata);
     }
     else
     {
-        tapedata = (uint8_t *) malloc(num_bytes);
-        sys->tape_pos = 0;
-        pos = 0;
+        /* textual TAP image, pack the '0' and '1' characters */
+        tape->bits = (uint8_t*) calloc(num_bytes / 8 + 1 + _SPC1K_TAPE_PADDING, 1);
         for(int i = 0; i < num_bytes; i++)
         {
             if (ptr[i] == '1' || ptr[i] == '0')
-                tapedata[pos++] = ptr[i];
+            {
+                if (ptr[i] == '1')
+                    tape->bits[tape->size >> 3] |= 0x80 >> (tape->size & 7);
+                tape->size++;
+            }
         }
-        num_bytes = pos;
-        pos = 0;
-#if 0        
-        pos = skip_null_header(tapedata, num_bytes);
-        if (pos < 10)
-            pos = 0;
-        else
-            pos -= 10;
-#endif
-//        char str[82];
-//        memcpy(str, tapedata+pos, 81);
-//        printf("pos=%10d, %s\n", pos, str);
-        memcpy(sys->tape_buf, tapedata+pos, num_bytes-pos);
-        sys->tape_size = num_bytes-pos;
-        free(tapedata);
-    }
-    for(int i = 0; i < sys->tape_size; i++)
+    }
+    /* index the file headers */
+    for(int i = 0; (i < tape->size) && (num < SPC1K_MAX_TAPE_FILES); i++)
     {
-        pos = skip_null_header(sys->tape_buf+i, sys->tape_size-i);
+        int pos = skip_null_header(tape, i);
         if (pos >= 0)
         {
-            sys->tape_names[num] = (char *)malloc(18);
-            memcpy(sys->tape_names[num], get_header_info(sys->tape_buf+pos+i), 17);
-            sys->tape_numpos[num] = pos+i;
-//            printf("header#%d:%s(%d)\n", num+1, sys->tape_names[num], pos+i);
-            sys->tape_num = ++num;
-            i += pos + 800;
+            _spc1000_tape_header_name(tape, pos, tape->names[num]);
+            tape->numpos[num] = pos;
+//            printf("header#%d:%s(%d)\n", num+1, tape->names[num], pos);
+            tape->num = ++num;
+            i = pos + 800;
         }
         else
             break;
     }
+    return tape;
+}
+
+void spc1000_tape_destroy(spc1000_tape_t* tape) {
+    CHIPS_ASSERT(tape);
+    free(tape->bits);
+    free(tape);
+}
+
+void spc1000_attach_tape(spc1000_t* sys, spc1000_tape_t* tape) {
+    CHIPS_ASSERT(sys && sys->valid);
+    spc1000_remove_tape(sys);
+    sys->tape = tape;
+    sys->tape_owned = false;
+    _spc1000_update_trap(sys);
+}
+
+bool spc1000_insert_tape(spc1000_t* sys, const uint8_t* ptr, int num_bytes) {
+    CHIPS_ASSERT(sys && sys->valid);
+    CHIPS_ASSERT(ptr);
+    spc1000_remove_tape(sys);
+    if (num_bytes <= 0) {
+        return false;
+    }
+    sys->tape = spc1000_tape_create(ptr, num_bytes);
+    sys->tape_owned = true;
+    _spc1000_update_trap(sys);
     return true;
 }
 
 int spc1000_get_tape_num(spc1000_t* sys)
 {
-    for(int i = 0; i < sys->tape_num; i++)
+    spc1000_tape_t* tape = sys->tape;
+    for(int i = 0; tape && (i < tape->num); i++)
     {
-        if (sys->tape_pos <= sys->tape_numpos[i])
+        if (tape->pos <= tape->numpos[i])
         {
             return i;
         }
@@ -922,103 +1494,286 @@ int spc1000_get_tape_num(spc1000_t* sys)
 }
 void spc1000_set_tape_num(spc1000_t* sys, int num)
 {
+    spc1000_tape_t* tape = sys->tape;
+    if (!tape)
+        return;
     if (num == 0)
-        sys->tape_pos = 0;
+        tape->pos = 0;
     else
-        sys->tape_pos = sys->tape_numpos[num];
-#if 0
-    char str[81];
-    memcpy(str, sys->tape_buf+sys->tape_pos, 80);
-    str[80] = 0;
-    printf("tape_pos=%10d, %s\n", sys->tape_pos, str);
-    fflush(stdout);
-#endif
+        tape->pos = tape->numpos[num];
 }
 
 void spc1000_remove_tape(spc1000_t* sys) {
     CHIPS_ASSERT(sys && sys->valid);
-    sys->tape_pos = 0;
-    sys->tape_size = 0;
-    for(int i = 0; i < sys->tape_num; i++)
-    {
-        if (sys->tape_names[i])
-        {
-            free(sys->tape_names[i]);
-            sys->tape_names[i] = 0;
-        }
+    if (sys->tape && sys->tape_owned) {
+        spc1000_tape_destroy(sys->tape);
     }
-    sys->tape_num = 0;
-}
-
-/*
-    trapped OSLOAD function, load ATM block in a TAP file:
-      https://github.com/hoglet67/spc1000ulator/blob/master/docs/spc1000mmc2.tx
-    from: http://ladybug.xs4all.nl/arlet/fpga/6502/kernel.di
-      OSLOAD Load File subroutine
-       --------------------------
-     - Entry: 0,X = LSB File name string address
-              1,X = MSB File name string address
-              2,X = LSB Data dump start address
-              3,X = MSB Data dump start address
-              4,X : If bit 7 is clear, then the file's own start address is
-                    to be used
-              #DD = FLOAD flag - bit 7 is set if in FLOAD mod
-     - Uses:  #C9 = LSB File name string address
-              #CA = MSB File name string address
-              #CB = LSB Data dump start address
-              #CC = MSB Data dump start address
-              #CD = load flag - if bit 7 is set, then the load address at
-                    (#CB) is to be used instead of the file's load address
-              #D0 = MSB Current block number
-              #D1 = LSB Current block numbe
-     - Header format: <*>                      )
-                      <*>                      )
-                      <*>                      )
-                      <*>                      ) Header preamble
-                      <Filename>               ) Name is 1 to 13 bytes long
-                      <Status Flag>            ) Bit 7 clear if last block
-                                               ) Bit 6 clear to skip block
-                                               ) Bit 5 clear if first block
-                      <LSB block number>
-                      <MSB block number>       ) Always zero
-                      <Bytes in block>
-                      <MSB run address>
-                      <LSB run address>
-                      <MSB block load address>
-                      <LSB block load address
-     - Data format:   <....data....>           ) 1 to #FF bytes
-                      <Checksum>               ) LSB sum of all data byte
+    sys->tape = 0;
+    sys->tape_owned = false;
+    _spc1000_update_trap(sys);
+}
+
+void spc1000_set_tape_fastload(spc1000_t* sys, bool enabled) {
+    CHIPS_ASSERT(sys && sys->valid);
+    sys->tape_fastload = enabled;
+    _spc1000_update_trap(sys);
+}
+
+/*  Tape fast-loading
+
+    The ROM reads tapes through two entry points, 0x0114 loads the 128 byte
+    file header to 0x1396, and 0x0134 loads the data block described by
+    the header (length at 0x13A8, load address at 0x13AA). Both look for
+    a sync pattern (40 '1' and 40 '0' bits for the header, 20 and 20 for
+    data), skip one bit, wait for a '1' start bit, and read the block as
+    9 bits per byte (8 data bits MSB first and a stop bit), followed by a
+    16-bit count of all '1' data bits as checksum. A failed checksum is
+    retried once on the following block. On return A is 0 with carry
+    cleared, or A is 1 with carry set on a checksum error.
+
+    When fast-loading is enabled, the CPU trap callback stops z80_exec()
+    when one of the entry points is called, and _spc1000_tape_load() does
+    the same work directly on the tape bits, then returns to the caller.
+    If no sync pattern is found the ROM routine runs as usual.
 */
-#if 0
-void _spc1000_osload(spc1000_t* sys) {
-    bool success = false;
-
-    /* tape inserted? */
-    uint16_t exec_addr = 0;
-    if ((sys->tape_size > 0) && (sys->tape_pos < sys->tape_size)) {
-        /* read next tape chunk */
-        if ((int)(sys->tape_pos + sizeof(_spc1000_tap_header)) < sys->tape_size) {
-            const _spc1000_tap_header* hdr = (const _spc1000_tap_header*) &sys->tape_buf[sys->tape_pos];
-            sys->tape_pos += sizeof(_spc1000_tap_header);
-            exec_addr = hdr->exec_addr;
-            uint16_t addr = hdr->load_addr;
-            /* override file load address? */
-            if (mem_rd(&sys->mem, 0xCD) & 0x80) {
-                addr = mem_rd16(&sys->mem, 0xCB);
+#define _SPC1K_TRAPID_TAPE_HEADER (1)
+#define _SPC1K_TRAPID_TAPE_DATA (2)
+#define _SPC1K_TRAPID_IDLE (3)
+
+/* read a byte as the CPU sees it */
+static inline uint8_t _spc1000_mem_rd(spc1000_t* sys, uint16_t addr) {
+    return mem_rd(&sys->mem, addr);
+}
+
+/* read a tape byte like the ROM does, counting the '1' bits */
+static uint8_t _spc1000_tape_read_byte(spc1000_tape_t* tape, uint16_t* count) {
+    uint8_t val = 0;
+    for (int i = 0; i < 8; i++) {
+        bool bit = spc1000_tape_read_bit(tape);
+        *count += bit;
+        val = (val << 1) | bit;
+    }
+    /* stop bit */
+    spc1000_tape_read_bit(tape);
+    return val;
+}
+
+/* search the sync pattern like the ROM does, returns false at the end of the tape */
+static bool _spc1000_tape_sync(spc1000_tape_t* tape, int num_ones, int num_zeros) {
+    int h = num_ones, l = num_zeros;
+    while (tape->pos < tape->size) {
+        bool bit = spc1000_tape_read_bit(tape);
+        if (h > 0) {
+            if (!bit) {
+                h = num_ones;
             }
-            if ((sys->tape_pos + hdr->length) <= sys->tape_size) {
-                for (int i = 0; i < hdr->length; i++) {
-                    mem_wr(&sys->mem, addr++, sys->tape_buf[sys->tape_pos++]);
-                }
-                success = true;
+            else {
+                h--;
             }
         }
+        else if (bit) {
+            h = num_ones;
+            l = num_zeros;
+        }
+        else if (--l == 0) {
+            /* skip one bit after the sync pattern */
+            spc1000_tape_read_bit(tape);
+            return true;
+        }
     }
-    /* if tape at end, remove tape */
-    if (sys->tape_pos >= sys->tape_size) {
-        spc1000_remove_tape(sys);
+    return false;
+}
+
+/* load a tape block into memory, returns the ROM error code (0, or 1 on checksum error) */
+static uint8_t _spc1000_tape_read_block(spc1000_t* sys, uint16_t addr, uint16_t len) {
+    spc1000_tape_t* tape = sys->tape;
+    uint16_t count = 0;
+    for (int retries = 2; retries > 0; retries--) {
+        /* wait for the start bit */
+        while ((tape->pos < tape->size) && !spc1000_tape_read_bit(tape));
+        count = 0;
+        for (uint16_t i = 0; i < len; i++) {
+            sys->ram[(uint16_t)(addr + i)] = _spc1000_tape_read_byte(tape, &count);
+        }
+        const uint16_t sum = count;
+        uint8_t hi = _spc1000_tape_read_byte(tape, &count);
+        uint8_t lo = _spc1000_tape_read_byte(tape, &count);
+        /* the ROM keeps the running bit count at 0x11E3 */
+        sys->ram[0x11E3] = (uint8_t) count;
+        sys->ram[0x11E4] = (uint8_t) (count >> 8);
+        if ((lo == (sum & 0xFF)) && (hi == (sum >> 8))) {
+            return 0;
+        }
     }
+    return 1;
+}
+
+/* load the next header or data block, and return from the ROM routine */
+static void _spc1000_tape_load(spc1000_t* sys, int trap_id) {
+    spc1000_tape_t* tape = sys->tape;
+    uint16_t addr, len;
+    int num_sync;
+    if (trap_id == _SPC1K_TRAPID_TAPE_HEADER) {
+        addr = 0x1396;
+        len = 0x80;
+        num_sync = 40;
+    }
+    else {
+        len = sys->ram[0x13A8] | (sys->ram[0x13A9] << 8);
+        addr = sys->ram[0x13AA] | (sys->ram[0x13AB] << 8);
+        num_sync = 20;
+    }
+    uint8_t err = 0;
+    if (len > 0) {
+        const int pos = tape->pos;
+        if (!_spc1000_tape_sync(tape, num_sync, num_sync)) {
+            /* no block found, let the ROM routine run */
+            tape->pos = pos;
+            return;
+        }
+        err = _spc1000_tape_read_block(sys, addr, len);
+    }
+    /* the ROM switches the tape motor off before returning */
+    if (sys->tapeMotor) {
+        sys->tapeMotor = false;
+        sys->tape_turbo = false;
+        sys->motor_start = 0;
+        sys->ram[0x11E9] |= 0x02;
+    }
+    z80_t* cpu = &sys->cpu;
+    /* the block and the ROM's tape variables were written behind the CPU's back */
+    z80_invalidate_blocks(cpu, addr, len);
+    z80_invalidate_blocks(cpu, 0x11E3, 7);
+    if (err) {
+        z80_set_a(cpu, err);
+        z80_set_f(cpu, (z80_f(cpu) & (Z80_SF|Z80_ZF|Z80_PF)) | Z80_CF);
+    }
+    else {
+        z80_set_a(cpu, 0);
+        z80_set_f(cpu, Z80_ZF|Z80_PF);
+    }
+    z80_set_iff1(cpu, true);
+    z80_set_iff2(cpu, true);
+    /* RET */
+    const uint16_t sp = z80_sp(cpu);
+    z80_set_pc(cpu, _spc1000_mem_rd(sys, sp) | (_spc1000_mem_rd(sys, sp + 1) << 8));
+    z80_set_sp(cpu, sp + 2);
+}
+
+/* CPU trap callback, checks for calls into the ROM tape routines and stops at idle polling */
+static int _spc1000_trap(uint16_t pc, int ticks, uint64_t pins, void* user_data) {
+    (void)ticks; (void)pins;
+    spc1000_t* sys = (spc1000_t*) user_data;
+    if (sys->idle_skip) {
+        if ((pc < _SPC1K_IDLE_PC_START) || (pc >= _SPC1K_IDLE_PC_END)) {
+            /* the CPU left the keyboard loop */
+            sys->idle_polls = 0;
+        }
+        else if (sys->idle_polls >= _SPC1K_IDLE_POLLS) {
+            return _SPC1K_TRAPID_IDLE;
+        }
+    }
+    if ((pc != 0x0114) && (pc != 0x0134)) {
+        return 0;
+    }
+    /* only if the ROM routine is mapped (DI; PUSH DE; PUSH BC; PUSH HL; LD D,D2h; LD E,xx) */
+    static const uint8_t code[] = { 0xF3, 0xD5, 0xC5, 0xE5, 0x16, 0xD2, 0x1E };
+    for (int i = 0; i < (int)sizeof(code); i++) {
+        if (_spc1000_mem_rd(sys, pc + i) != code[i]) {
+            return 0;
+        }
+    }
+    const uint8_t sync = _spc1000_mem_rd(sys, pc + sizeof(code));
+    if (sync == 0xCC) {
+        return _SPC1K_TRAPID_TAPE_HEADER;
+    }
+    else if (sync == 0x53) {
+        return _SPC1K_TRAPID_TAPE_DATA;
+    }
+    return 0;
+}
+
+/*  the trap callback is only installed while it's needed, this must not be
+    called from inside z80_exec() (the UI debugger chains its own trap callback
+    to the one installed before z80_exec())
+*/
+static void _spc1000_update_trap(spc1000_t* sys) {
+    const bool tape = sys->tape_fastload && sys->tape && (0 == (sys->devices_off & SPC1K_DEVICE_TAPE));
+    if (tape || sys->idle_skip) {
+        z80_trap_cb(&sys->cpu, _spc1000_trap, sys);
+    }
+    else {
+        z80_trap_cb(&sys->cpu, 0, 0);
+    }
+}
+
+/*  Idle skipping
+
+    At the BASIC prompt the CPU spends its time in the ROM keyboard scan
+    (running from RAM at _SPC1K_IDLE_PC_START.._SPC1K_IDLE_PC_END), only
+    reading the keyboard ports between the field sync interrupts. The loop
+    rewrites its key matrix buffer with the same values and otherwise only
+    writes to the stack. After _SPC1K_IDLE_POLLS keyboard reads without a
+    pressed key, without leaving the loop, without any other IO (an
+    interrupt acknowledge counts as IO) and without changing RAM outside
+    the stack page, the trap callback stops the CPU at the next instruction,
+    and the time up to the next field sync edge is skipped: only tick_count
+    moves, the devices catch up lazily like after any other stretch of CPU
+    time. The interrupt then wakes the CPU up as usual.
+
+    The trap callback stays installed while idle skipping is on (so that a
+    debugger can chain it), and the memory writes go through the tick
+    callback instead of the fast path.
+
+    This isn't cycle-exact, delay loops in the polling code don't advance
+    during the skipped time, so it's off by default.
+*/
+static void _spc1000_idle_poll(spc1000_t* sys, uint8_t data) {
+    if (data != 0xFF) {
+        sys->idle_polls = 0;
+    }
+    else {
+        sys->idle_polls++;
+    }
+}
+
+/* skip up to max_ticks until the next field sync edge, returns the skipped ticks */
+static uint32_t _spc1000_idle_skip(spc1000_t* sys, uint32_t max_ticks) {
+    sys->idle_polls = 0;
+    _spc1000_sync_vdg(sys);
+    uint32_t ticks = mc6847_ticks_to_edge(&sys->vdg, MC6847_FS);
+    if (ticks > max_ticks) {
+        ticks = max_ticks;
+    }
+    sys->tick_count += ticks;
+    sys->idle_ticks += ticks;
+    _spc1000_update_fast_ticks(sys);
+    return ticks;
+}
+
+/* run the CPU, handling tape fast-load and idle traps on the way */
+static uint32_t _spc1000_run(spc1000_t* sys, uint32_t num_ticks) {
+    uint32_t ticks = 0;
+    while (ticks < num_ticks) {
+        sys->idle_stack = z80_sp(&sys->cpu) >> 8;
+        ticks += z80_exec(&sys->cpu, num_ticks - ticks);
+        const int trap_id = sys->cpu.trap_id;
+        if ((trap_id == _SPC1K_TRAPID_TAPE_HEADER) || (trap_id == _SPC1K_TRAPID_TAPE_DATA)) {
+            _spc1000_tape_load(sys, trap_id);
+            sys->cpu.trap_id = 0;
+        }
+        else if (trap_id == _SPC1K_TRAPID_IDLE) {
+            if (ticks < num_ticks) {
+                ticks += _spc1000_idle_skip(sys, num_ticks - ticks);
+            }
+            sys->cpu.trap_id = 0;
+        }
+        else if (trap_id != 0) {
+            /* some other trap (debugger breakpoint) */
+            break;
+        }
+    }
+    return ticks;
 }
-#endif
 
 #endif /* CHIPS_IMPL */
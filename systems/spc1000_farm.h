@@ -0,0 +1,279 @@
+#pragma once
+/*#
+    # spc1000_farm.h
+
+    Runs many independent spc1000_t instances in parallel on a thread pool.
+
+    Do this:
+    ~~~C
+    #define CHIPS_IMPL
+    ~~~
+    before you include this file in *one* C or C++ file to create the
+    implementation.
+
+    Optionally provide the following macros with your own implementation
+
+    ~~~C
+    CHIPS_ASSERT(c)
+    ~~~
+        your own assert macro (default: assert(c))
+
+    You need to include systems/spc1000.h (and its dependencies) before
+    including spc1000_farm.h. The implementation uses POSIX threads.
+
+    ## Usage
+
+    Describe the instances with a spc1000_desc_t template, the farm
+    allocates a separate pixel buffer for each instance. After
+    spc1000_farm_init(), the instances can be set up (tapes, devices,
+    save states) through spc1000_farm_instance().
+
+    spc1000_farm_exec() steps every instance by the same number of frames
+    and returns when all instances are done. The optional frame callback
+    is invoked before each frame of an instance (on a worker thread), to
+    feed input or to inspect the previous frame.
+
+    The instances are split into one shard per thread. A worker first
+    runs the instances of its own shard, then steals the remaining
+    instances from the other shards, so that instances which are more
+    expensive to run (for instance while loading a tape with the
+    fast-forward) don't leave the other threads idle.
+
+    Instances don't share any state, the audio callback of the template
+    is called from the worker threads, with the same user data for all
+    instances.
+
+    ## zlib/libpng license
+
+    Copyright (c) 2019 Miso Kim
+    This software is provided 'as-is', without any express or implied warranty.
+    In no event will the authors be held liable for any damages arising from the
+    use of this software.
+    Permission is granted to anyone to use this software for any purpose,
+    including commercial applications, and to alter it and redistribute it
+    freely, subject to the following restrictions:
+        1. The origin of this software must not be misrepresented; you must not
+        claim that you wrote the original software. If you use this software in a
+        product, an acknowledgment in the product documentation would be
+        appreciated but is not required.
+        2. Altered source versions must be plainly marked as such, and must not
+        be misrepresented as being the original software.
+        3. This notice may not be removed or altered from any source
+        distribution.
+#*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* called before each frame of an instance, frame counts up over all spc1000_farm_exec() calls */
+typedef void (*spc1000_farm_frame_t)(spc1000_t* sys, int index, uint32_t frame, void* user_data);
+
+/* farm setup parameters */
+typedef struct {
+    int num_instances;              /* number of emulator instances */
+    int num_threads;                /* number of threads, default is the number of CPU cores */
+    spc1000_desc_t desc;            /* setup parameters for all instances, pixel buffer is ignored */
+    spc1000_farm_frame_t frame_cb;  /* optional per-frame callback */
+    void* user_data;                /* user data for the frame callback */
+} spc1000_farm_desc_t;
+
+/* a range of instances, workers take instances by incrementing 'next' */
+typedef struct {
+    int next;
+    int end;
+    uint8_t pad[56];                /* one cache line per shard */
+} spc1000_farm_shard_t;
+
+/* farm state */
+typedef struct {
+    int num_instances;
+    int num_threads;
+    spc1000_t* sys;
+    uint32_t* pixels;
+    int pixel_buffer_size;
+    spc1000_farm_frame_t frame_cb;
+    void* user_data;
+    spc1000_farm_shard_t* shards;
+    pthread_t* threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    uint32_t generation;            /* incremented for each spc1000_farm_exec() */
+    int num_busy;                   /* worker threads still running */
+    bool quit;
+    uint32_t micro_seconds;
+    int num_frames;
+    uint32_t frame_count;
+} spc1000_farm_t;
+
+/* initialize the farm, initializes all instances and starts the worker threads */
+void spc1000_farm_init(spc1000_farm_t* farm, const spc1000_farm_desc_t* desc);
+/* stop the worker threads and discard all instances */
+void spc1000_farm_discard(spc1000_farm_t* farm);
+/* get an instance by index */
+spc1000_t* spc1000_farm_instance(spc1000_farm_t* farm, int index);
+/* run all instances for num_frames frames of micro_seconds each, blocks until done */
+void spc1000_farm_exec(spc1000_farm_t* farm, uint32_t micro_seconds, int num_frames);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+/*-- IMPLEMENTATION ----------------------------------------------------------*/
+#ifdef CHIPS_IMPL
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#ifndef CHIPS_ASSERT
+    #include <assert.h>
+    #define CHIPS_ASSERT(c) assert(c)
+#endif
+
+static void _spc1000_farm_run(spc1000_farm_t* farm, int index) {
+    spc1000_t* sys = &farm->sys[index];
+    for (int i = 0; i < farm->num_frames; i++) {
+        if (farm->frame_cb) {
+            farm->frame_cb(sys, index, farm->frame_count + i, farm->user_data);
+        }
+        spc1000_exec(sys, farm->micro_seconds);
+    }
+}
+
+/* run the own shard first, then steal from the other shards */
+static void _spc1000_farm_work(spc1000_farm_t* farm, int worker) {
+    for (int i = 0; i < farm->num_threads; i++) {
+        spc1000_farm_shard_t* shard = &farm->shards[(worker + i) % farm->num_threads];
+        int index;
+        while ((index = __atomic_fetch_add(&shard->next, 1, __ATOMIC_RELAXED)) < shard->end) {
+            _spc1000_farm_run(farm, index);
+        }
+    }
+}
+
+static void* _spc1000_farm_thread(void* arg) {
+    spc1000_farm_t* farm = (spc1000_farm_t*) arg;
+    pthread_mutex_lock(&farm->lock);
+    const int worker = ++farm->num_busy;
+    uint32_t generation = farm->generation;
+    pthread_cond_signal(&farm->done_cond);
+    for (;;) {
+        while (!farm->quit && (generation == farm->generation)) {
+            pthread_cond_wait(&farm->start_cond, &farm->lock);
+        }
+        if (farm->quit) {
+            break;
+        }
+        generation = farm->generation;
+        pthread_mutex_unlock(&farm->lock);
+        _spc1000_farm_work(farm, worker);
+        pthread_mutex_lock(&farm->lock);
+        if (0 == --farm->num_busy) {
+            pthread_cond_signal(&farm->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&farm->lock);
+    return 0;
+}
+
+void spc1000_farm_init(spc1000_farm_t* farm, const spc1000_farm_desc_t* desc) {
+    CHIPS_ASSERT(farm && desc && (desc->num_instances > 0));
+    memset(farm, 0, sizeof(spc1000_farm_t));
+    farm->num_instances = desc->num_instances;
+    farm->num_threads = desc->num_threads;
+    if (farm->num_threads <= 0) {
+        farm->num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (farm->num_threads > farm->num_instances) {
+        farm->num_threads = farm->num_instances;
+    }
+    if (farm->num_threads < 1) {
+        farm->num_threads = 1;
+    }
+    farm->frame_cb = desc->frame_cb;
+    farm->user_data = desc->user_data;
+
+    /* instances with their own pixel buffers */
+    farm->pixel_buffer_size = spc1000_max_display_size();
+    farm->sys = (spc1000_t*) calloc(farm->num_instances, sizeof(spc1000_t));
+    farm->pixels = (uint32_t*) calloc(farm->num_instances, farm->pixel_buffer_size);
+    CHIPS_ASSERT(farm->sys && farm->pixels);
+    for (int i = 0; i < farm->num_instances; i++) {
+        spc1000_desc_t sys_desc = desc->desc;
+        sys_desc.pixel_buffer = (uint8_t*)farm->pixels + i * farm->pixel_buffer_size;
+        sys_desc.pixel_buffer_size = farm->pixel_buffer_size;
+        spc1000_init(&farm->sys[i], &sys_desc);
+    }
+
+    /* the calling thread is worker 0, the pool has num_threads-1 threads */
+    farm->shards = (spc1000_farm_shard_t*) calloc(farm->num_threads, sizeof(spc1000_farm_shard_t));
+    farm->threads = (pthread_t*) calloc(farm->num_threads, sizeof(pthread_t));
+    CHIPS_ASSERT(farm->shards && farm->threads);
+    pthread_mutex_init(&farm->lock, 0);
+    pthread_cond_init(&farm->start_cond, 0);
+    pthread_cond_init(&farm->done_cond, 0);
+    for (int i = 1; i < farm->num_threads; i++) {
+        pthread_create(&farm->threads[i], 0, _spc1000_farm_thread, farm);
+    }
+    /* wait until all threads have picked their worker index */
+    pthread_mutex_lock(&farm->lock);
+    while (farm->num_busy < (farm->num_threads - 1)) {
+        pthread_cond_wait(&farm->done_cond, &farm->lock);
+    }
+    farm->num_busy = 0;
+    pthread_mutex_unlock(&farm->lock);
+}
+
+void spc1000_farm_discard(spc1000_farm_t* farm) {
+    CHIPS_ASSERT(farm && farm->sys);
+    pthread_mutex_lock(&farm->lock);
+    farm->quit = true;
+    pthread_cond_broadcast(&farm->start_cond);
+    pthread_mutex_unlock(&farm->lock);
+    for (int i = 1; i < farm->num_threads; i++) {
+        pthread_join(farm->threads[i], 0);
+    }
+    pthread_cond_destroy(&farm->done_cond);
+    pthread_cond_destroy(&farm->start_cond);
+    pthread_mutex_destroy(&farm->lock);
+    for (int i = 0; i < farm->num_instances; i++) {
+        spc1000_discard(&farm->sys[i]);
+    }
+    free(farm->threads);
+    free(farm->shards);
+    free(farm->pixels);
+    free(farm->sys);
+    memset(farm, 0, sizeof(spc1000_farm_t));
+}
+
+spc1000_t* spc1000_farm_instance(spc1000_farm_t* farm, int index) {
+    CHIPS_ASSERT(farm && farm->sys && (index >= 0) && (index < farm->num_instances));
+    return &farm->sys[index];
+}
+
+void spc1000_farm_exec(spc1000_farm_t* farm, uint32_t micro_seconds, int num_frames) {
+    CHIPS_ASSERT(farm && farm->sys);
+    pthread_mutex_lock(&farm->lock);
+    farm->micro_seconds = micro_seconds;
+    farm->num_frames = num_frames;
+    for (int i = 0; i < farm->num_threads; i++) {
+        farm->shards[i].next = (farm->num_instances * i) / farm->num_threads;
+        farm->shards[i].end = (farm->num_instances * (i + 1)) / farm->num_threads;
+    }
+    farm->num_busy = farm->num_threads - 1;
+    farm->generation++;
+    pthread_cond_broadcast(&farm->start_cond);
+    pthread_mutex_unlock(&farm->lock);
+    _spc1000_farm_work(farm, 0);
+    pthread_mutex_lock(&farm->lock);
+    while (farm->num_busy > 0) {
+        pthread_cond_wait(&farm->done_cond, &farm->lock);
+    }
+    farm->frame_count += num_frames;
+    pthread_mutex_unlock(&farm->lock);
+}
+
+#endif /* CHIPS_IMPL */
@@ -61,10 +61,30 @@ extern "C" {
 
 /* general callback type for rebooting to different configs */
 typedef void (*ui_spc1000_boot_t)(spc1000_t* sys, spc1000_type_t type);
+/* callback to step back a number of frames, returns the frames stepped back, or with num_frames=0 the frames available */
+typedef int (*ui_spc1000_rewind_t)(spc1000_t* sys, int num_frames);
+/*  optional callbacks which change the emulator state, the defaults call the
+    spc1000_* functions directly, a host which runs the emulator on its own
+    thread passes them on to that thread
+*/
+typedef void (*ui_spc1000_reset_t)(spc1000_t* sys);
+typedef void (*ui_spc1000_set_speed_t)(spc1000_t* sys, float speed, bool skip_audio);
+typedef void (*ui_spc1000_set_tape_fastload_t)(spc1000_t* sys, bool enabled);
+typedef void (*ui_spc1000_set_tape_num_t)(spc1000_t* sys, int num);
+typedef bool (*ui_spc1000_insert_tape_t)(spc1000_t* sys, const uint8_t* ptr, int num_bytes);
+typedef void (*ui_spc1000_mem_write_t)(spc1000_t* sys, int layer, uint16_t addr, uint8_t data);
 
 typedef struct {
     spc1000_t* spc1000;
     ui_spc1000_boot_t boot_cb; /* user-provided callback to reboot to different config */
+    ui_spc1000_rewind_t rewind_cb;  /* optional user-provided callback to rewind the emulation */
+    ui_spc1000_reset_t reset_cb;
+    ui_spc1000_set_speed_t set_speed_cb;
+    ui_spc1000_set_tape_fastload_t set_tape_fastload_cb;
+    ui_spc1000_set_tape_num_t set_tape_num_cb;
+    ui_spc1000_insert_tape_t insert_tape_cb;
+    ui_spc1000_mem_write_t mem_write_cb;
+    bool threaded;      /* emulator runs on another thread: no debugger, hardware and memory windows */
     ui_dbg_create_texture_t create_texture_cb;      /* texture creation callback for ui_dbg_t */
     ui_dbg_update_texture_t update_texture_cb;      /* texture update callback for ui_dbg_t */
     ui_dbg_destroy_texture_t destroy_texture_cb;    /* texture destruction callback for ui_dbg_t */
@@ -74,6 +94,14 @@ typedef struct {
 typedef struct {
     spc1000_t* spc1000;
     ui_spc1000_boot_t boot_cb;
+    ui_spc1000_rewind_t rewind_cb;
+    ui_spc1000_reset_t reset_cb;
+    ui_spc1000_set_speed_t set_speed_cb;
+    ui_spc1000_set_tape_fastload_t set_tape_fastload_cb;
+    ui_spc1000_set_tape_num_t set_tape_num_cb;
+    ui_spc1000_insert_tape_t insert_tape_cb;
+    ui_spc1000_mem_write_t mem_write_cb;
+    bool threaded;
     ui_z80_t cpu;
     ui_ay38910_t ay;
     ui_audio_t audio;
@@ -82,6 +110,7 @@ typedef struct {
     ui_memedit_t memedit[4];
     ui_dasm_t dasm[4];
     ui_dbg_t dbg;
+    float achieved_speed;   /* measured emulation speed multiplier, set by the host */
 } ui_spc1000_t;
 
 void ui_spc1000_init(ui_spc1000_t* ui, const ui_spc1000_desc_t* desc);
@@ -116,7 +145,7 @@ static void _ui_spc1000_draw_menu(ui_spc1000_t* ui, uint64_t time_ms) {
     if (ImGui::BeginMainMenuBar()) {
         if (ImGui::BeginMenu(u8"시스템")) {
             if (ImGui::MenuItem(u8"하드웨어리셋")) {
-                spc1000_reset(ui->spc1000);
+                ui->reset_cb(ui->spc1000);
                 ui_dbg_reset(&ui->dbg);
             }
             if (ImGui::MenuItem("SPC1000", 0, (ui->spc1000->type == SPC1000))) {
@@ -127,6 +156,9 @@ static void _ui_spc1000_draw_menu(ui_spc1000_t* ui, uint64_t time_ms) {
                 ui->boot_cb(ui->spc1000, SPC1000A);
                 ui_dbg_reboot(&ui->dbg);
             }
+            if (ImGui::MenuItem(u8"테입 고속로딩", 0, ui->spc1000->tape_fastload)) {
+                ui->set_tape_fastload_cb(ui->spc1000, !ui->spc1000->tape_fastload);
+            }
 #if 0            
             if (ImGui::BeginMenu("Joystick")) {
                 if (ImGui::MenuItem("None", 0, (ui->spc1000->joystick_type == SPC1K_JOYSTICKTYPE_NONE))) {
@@ -140,7 +172,10 @@ static void _ui_spc1000_draw_menu(ui_spc1000_t* ui, uint64_t time_ms) {
 #endif
             ImGui::EndMenu();
         }
-        if (ImGui::BeginMenu(u8"하드웨어")) {
+        /* these windows read the emulator state while it runs, and the
+           debugger can only stop the CPU from inside ui_spc1000_before_exec()
+        */
+        if (ImGui::BeginMenu(u8"하드웨어", !ui->threaded)) {
             ImGui::MenuItem(u8"메모리 맵", 0, &ui->memmap.open);
             ImGui::MenuItem(u8"키보드 매트릭스", 0, &ui->kbd.open);
             ImGui::MenuItem(u8"오디오 출력", 0, &ui->audio.open);
@@ -148,7 +183,7 @@ static void _ui_spc1000_draw_menu(ui_spc1000_t* ui, uint64_t time_ms) {
             ImGui::MenuItem(u8"AY-3-8912 사운드칩", 0, &ui->ay.open);
             ImGui::EndMenu();
         }
-        if (ImGui::BeginMenu(u8"디버그")) {
+        if (ImGui::BeginMenu(u8"디버그", !ui->threaded)) {
             ImGui::MenuItem(u8"CPU 디버거", 0, &ui->dbg.ui.open);
             ImGui::MenuItem(u8"Break포인트", 0, &ui->dbg.ui.show_breakpoints);
             ImGui::MenuItem(u8"메모리 히트맵", 0, &ui->dbg.ui.show_heatmap);
@@ -168,11 +203,12 @@ static void _ui_spc1000_draw_menu(ui_spc1000_t* ui, uint64_t time_ms) {
             float spacing = ImGui::GetStyle().ItemInnerSpacing.x;
 
             int e = spc1000_get_tape_num(ui->spc1000);
-            for(int i = 0; i < ui->spc1000->tape_num; i++)
+            const spc1000_tape_t* tape = ui->spc1000->tape;
+            for(int i = 0; tape && (i < tape->num); i++)
             {
-                if (ImGui::RadioButton(ui->spc1000->tape_names[i], &e, i))
+                if (ImGui::RadioButton(tape->names[i], &e, i))
                 {
-                    spc1000_set_tape_num(ui->spc1000, e = i);
+                    ui->set_tape_num_cb(ui->spc1000, e = i);
                 }
             }
             ImGui::EndMenu();
@@ -186,12 +222,39 @@ static void _ui_spc1000_draw_menu(ui_spc1000_t* ui, uint64_t time_ms) {
                     if (ImGui::RadioButton(dump_items[i].name, &d, i))
                     {
                         d = i;
-                        spc1000_insert_tape(ui->spc1000, dump_items[i].ptr, dump_items[i].size);
+                        ui->insert_tape_cb(ui->spc1000, dump_items[i].ptr, dump_items[i].size);
                     }
                 }
             }
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu(u8"속도")) {
+            static const float speeds[] = { 1.0f, 2.0f, 5.0f, 10.0f, 50.0f };
+            for (int i = 0; i < (int)(sizeof(speeds)/sizeof(speeds[0])); i++) {
+                char label[16];
+                snprintf(label, sizeof(label), "x%d", (int)speeds[i]);
+                if (ImGui::MenuItem(label, 0, ui->spc1000->speed == speeds[i])) {
+                    ui->set_speed_cb(ui->spc1000, speeds[i], speeds[i] > 1.0f);
+                }
+            }
+            ImGui::EndMenu();
+        }
+        if (ImGui::BeginMenu(u8"되감기", 0 != ui->rewind_cb)) {
+            static const int seconds[] = { 1, 5, 10, 30, 60 };
+            const int num_frames = ui->rewind_cb(ui->spc1000, 0);
+            ImGui::Text(u8"%.1f초 저장됨 (F12: 누르는 동안 되감기)", num_frames / 60.0f);
+            for (int i = 0; i < (int)(sizeof(seconds)/sizeof(seconds[0])); i++) {
+                char label[32];
+                snprintf(label, sizeof(label), u8"%d초 전으로", seconds[i]);
+                if (ImGui::MenuItem(label, 0, false, num_frames > 0)) {
+                    ui->rewind_cb(ui->spc1000, seconds[i] * 60);
+                }
+            }
+            ImGui::EndMenu();
+        }
+        if (spc1000_speed(ui->spc1000) > 1.0f) {
+            ImGui::Text("x%.1f", ui->achieved_speed);
+        }
         //ui_util_options_menu_time(time_ms, ui->dbg.dbg.stopped);
         ImGui::EndMainMenuBar();
     }
@@ -221,23 +284,30 @@ static uint8_t* _ui_spc1000_memptr(spc1000_t* spc1000, int layer, uint16_t addr)
 
 static uint8_t _ui_spc1000_mem_read(int layer, uint16_t addr, void* user_data) {
     CHIPS_ASSERT(user_data);
-    spc1000_t* spc1000 = (spc1000_t*) user_data;
+    spc1000_t* spc1000 = ((ui_spc1000_t*) user_data)->spc1000;
         /* CPU visible layer */
     if (layer == 1)
         return spc1000->vram[addr];
     return spc1000->ram[addr];
 }
 
-static void _ui_spc1000_mem_write(int layer, uint16_t addr, uint8_t data, void* user_data) {
-    CHIPS_ASSERT(user_data);
-    spc1000_t* spc1000 = (spc1000_t*) user_data;
+/* default memory write callback */
+static void _ui_spc1000_write_mem(spc1000_t* spc1000, int layer, uint16_t addr, uint8_t data) {
     if (layer == 0) {
         mem_wr(&spc1000->mem, addr, data);
+        z80_invalidate_blocks(&spc1000->cpu, addr, 1);
     } else if (layer == 1) {
         spc1000->vram[addr] = data;
+        mc6847_invalidate(&spc1000->vdg);
     };
 }
 
+static void _ui_spc1000_mem_write(int layer, uint16_t addr, uint8_t data, void* user_data) {
+    CHIPS_ASSERT(user_data);
+    ui_spc1000_t* ui = (ui_spc1000_t*) user_data;
+    ui->mem_write_cb(ui->spc1000, layer, addr, data);
+}
+
 static const ui_chip_pin_t _ui_spc1000_cpu_pins[] = {
     { "D0",     0,      Z80_D0 },
     { "D1",     1,      Z80_D1 },
@@ -301,6 +371,15 @@ void ui_spc1000_init(ui_spc1000_t* ui, const ui_spc1000_desc_t* ui_desc) {
     CHIPS_ASSERT(ui_desc->boot_cb);
     ui->spc1000 = ui_desc->spc1000;
     ui->boot_cb = ui_desc->boot_cb;
+    ui->rewind_cb = ui_desc->rewind_cb;
+    ui->reset_cb = ui_desc->reset_cb ? ui_desc->reset_cb : spc1000_reset;
+    ui->set_speed_cb = ui_desc->set_speed_cb ? ui_desc->set_speed_cb : spc1000_set_speed;
+    ui->set_tape_fastload_cb = ui_desc->set_tape_fastload_cb ? ui_desc->set_tape_fastload_cb : spc1000_set_tape_fastload;
+    ui->set_tape_num_cb = ui_desc->set_tape_num_cb ? ui_desc->set_tape_num_cb : spc1000_set_tape_num;
+    ui->insert_tape_cb = ui_desc->insert_tape_cb ? ui_desc->insert_tape_cb : spc1000_insert_tape;
+    ui->mem_write_cb = ui_desc->mem_write_cb ? ui_desc->mem_write_cb : _ui_spc1000_write_mem;
+    ui->threaded = ui_desc->threaded;
+    ui->achieved_speed = 1.0f;
     int x = 20, y = 20, dx = 10, dy = 10;
     {
         ui_dbg_desc_t desc = {0};
@@ -313,7 +392,7 @@ void ui_spc1000_init(ui_spc1000_t* ui, const ui_spc1000_desc_t* ui_desc) {
         desc.update_texture_cb = ui_desc->update_texture_cb;
         desc.destroy_texture_cb = ui_desc->destroy_texture_cb;
         desc.keys = ui_desc->dbg_keys;
-        desc.user_data = ui->spc1000;
+        desc.user_data = ui;
         ui_dbg_init(&ui->dbg, &desc);
     }
     x += dx; y += dy;
@@ -371,7 +450,7 @@ void ui_spc1000_init(ui_spc1000_t* ui, const ui_spc1000_desc_t* ui_desc) {
         desc.layers[7] = "Layer 6";
         desc.read_cb = _ui_spc1000_mem_read;
         desc.write_cb = _ui_spc1000_mem_write;
-        desc.user_data = ui->spc1000;
+        desc.user_data = ui;
         static const char* titles[] = { "Memory Editor #1", "Memory Editor #2", "Memory Editor #3", "Memory Editor #4" };
         for (int i = 0; i < 2; i++) {
             desc.title = titles[i]; desc.x = x; desc.y = y;
@@ -400,7 +479,7 @@ void ui_spc1000_init(ui_spc1000_t* ui, const ui_spc1000_desc_t* ui_desc) {
         desc.cpu_type = UI_DASM_CPUTYPE_Z80;
         desc.start_addr = 0x0000;
         desc.read_cb = _ui_spc1000_mem_read;
-        desc.user_data = ui->spc1000;
+        desc.user_data = ui;
         static const char* titles[4] = { "Disassembler #1", "Disassembler #2", "Disassembler #2", "Dissassembler #3" };
         for (int i = 0; i < 4; i++) {
             desc.title = titles[i]; desc.x = x; desc.y = y;
@@ -429,24 +508,26 @@ void ui_spc1000_draw(ui_spc1000_t* ui, double time_ms) {
     CHIPS_ASSERT(ui && ui->spc1000);
     menuon = false;
     _ui_spc1000_draw_menu(ui, ui->spc1000->tick_count);
-    if (ui->memmap.open) {
-        _ui_spc1000_update_memmap(ui);
-    }
-    ui_audio_draw(&ui->audio, ui->spc1000->sample_pos);
-    ui_z80_draw(&ui->cpu);
-    ui_ay38910_draw(&ui->ay);
-    ui_kbd_draw(&ui->kbd);
-    ui_memmap_draw(&ui->memmap);
-    for (int i = 0; i < 2; i++) {
-        ui_memedit_draw(&ui->memedit[i]);
-        ui_dasm_draw(&ui->dasm[i]);
+    if (!ui->threaded) {
+        if (ui->memmap.open) {
+            _ui_spc1000_update_memmap(ui);
+        }
+        ui_audio_draw(&ui->audio, ui->spc1000->sample_pos);
+        ui_z80_draw(&ui->cpu);
+        ui_ay38910_draw(&ui->ay);
+        ui_kbd_draw(&ui->kbd);
+        ui_memmap_draw(&ui->memmap);
+        for (int i = 0; i < 2; i++) {
+            ui_memedit_draw(&ui->memedit[i]);
+            ui_dasm_draw(&ui->dasm[i]);
+        }
+        ui_dbg_draw(&ui->dbg);
     }
-    ui_dbg_draw(&ui->dbg);
-    if (ui->spc1000->tapeMotor)
+    if (ui->spc1000->tapeMotor && ui->spc1000->tape && (ui->spc1000->tape->size > 0))
     {
         bool g_bMenuOpen = false;
         float y = 0;
-        float w = ((float) (100 * ui->spc1000->tape_pos)) / ui->spc1000->tape_size;
+        float w = ((float) (100 * ui->spc1000->tape->pos)) / ui->spc1000->tape->size;
         if (menuon)
             y = 23;
         else 
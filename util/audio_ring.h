@@ -0,0 +1,188 @@
+#pragma once
+/*#
+    # audio_ring.h
+
+    A lock-free single-producer/single-consumer ring buffer for audio
+    samples.
+
+    Do this:
+    ~~~C
+    #define CHIPS_IMPL
+    ~~~
+    before you include this file in *one* C or C++ file to create the
+    implementation.
+
+    Optionally provide the following macros with your own implementation
+
+    ~~~C
+    CHIPS_ASSERT(c)
+    ~~~
+        your own assert macro (default: assert(c))
+
+    ## Usage
+
+    The emulator thread pushes samples with audio_ring_push() (for
+    instance from the system's audio callback), the audio thread pulls
+    them with audio_ring_pull() (for instance from the sokol_audio
+    stream callback). Only one thread may push and only one thread may
+    pull, the two sides only share the read and write positions.
+
+    When the ring is full, the samples that don't fit are dropped and
+    counted as overrun. When the audio thread wants more samples than
+    available, the rest is filled with silence and counted as underrun.
+
+    ## zlib/libpng license
+
+    Copyright (c) 2019 Miso Kim
+    This software is provided 'as-is', without any express or implied warranty.
+    In no event will the authors be held liable for any damages arising from the
+    use of this software.
+    Permission is granted to anyone to use this software for any purpose,
+    including commercial applications, and to alter it and redistribute it
+    freely, subject to the following restrictions:
+        1. The origin of this software must not be misrepresented; you must not
+        claim that you wrote the original software. If you use this software in a
+        product, an acknowledgment in the product documentation would be
+        appreciated but is not required.
+        2. Altered source versions must be plainly marked as such, and must not
+        be misrepresented as being the original software.
+        3. This notice may not be removed or altered from any source
+        distribution.
+#*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_RING_DEFAULT_SIZE (4096)
+
+/* audio ring state, the read and write side each have their own cache line */
+typedef struct {
+    float* buf;
+    uint32_t size;              /* number of samples, a power of 2 */
+    uint32_t mask;
+    uint8_t pad0[48];
+    uint32_t write_pos;         /* only written by the producer */
+    uint32_t num_overruns;      /* number of push calls which dropped samples */
+    uint32_t dropped_samples;
+    uint8_t pad1[52];
+    uint32_t read_pos;          /* only written by the consumer */
+    uint32_t num_underruns;     /* number of pull calls which ran out of samples */
+    uint32_t missing_samples;
+    uint8_t pad2[52];
+} audio_ring_t;
+
+/* initialize the ring with room for at least num_samples (default: 4096) */
+void audio_ring_init(audio_ring_t* ring, int num_samples);
+/* free the ring buffer */
+void audio_ring_discard(audio_ring_t* ring);
+/* producer side: append samples, returns the number of samples written */
+int audio_ring_push(audio_ring_t* ring, const float* samples, int num_samples);
+/* consumer side: take samples, pads with silence, returns the number of real samples */
+int audio_ring_pull(audio_ring_t* ring, float* samples, int num_samples);
+/* number of samples waiting in the ring, may be called from both sides */
+int audio_ring_fill(audio_ring_t* ring);
+/* the ring capacity in samples */
+int audio_ring_size(audio_ring_t* ring);
+/* number of pull calls that ran out of samples */
+uint32_t audio_ring_underruns(audio_ring_t* ring);
+/* number of push calls that found the ring full */
+uint32_t audio_ring_overruns(audio_ring_t* ring);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+/*-- IMPLEMENTATION ----------------------------------------------------------*/
+#ifdef CHIPS_IMPL
+#include <string.h>
+#include <stdlib.h>
+#ifndef CHIPS_ASSERT
+    #include <assert.h>
+    #define CHIPS_ASSERT(c) assert(c)
+#endif
+
+void audio_ring_init(audio_ring_t* ring, int num_samples) {
+    CHIPS_ASSERT(ring && (num_samples >= 0));
+    memset(ring, 0, sizeof(audio_ring_t));
+    ring->size = 1;
+    while (ring->size < (uint32_t)(num_samples > 0 ? num_samples : AUDIO_RING_DEFAULT_SIZE)) {
+        ring->size <<= 1;
+    }
+    ring->mask = ring->size - 1;
+    ring->buf = (float*) calloc(ring->size, sizeof(float));
+    CHIPS_ASSERT(ring->buf);
+}
+
+void audio_ring_discard(audio_ring_t* ring) {
+    CHIPS_ASSERT(ring && ring->buf);
+    free(ring->buf);
+    memset(ring, 0, sizeof(audio_ring_t));
+}
+
+int audio_ring_push(audio_ring_t* ring, const float* samples, int num_samples) {
+    CHIPS_ASSERT(ring && ring->buf && samples);
+    const uint32_t wr = ring->write_pos;
+    const uint32_t rd = __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE);
+    const uint32_t space = ring->size - (wr - rd);
+    uint32_t num = (uint32_t) num_samples;
+    if (num > space) {
+        __atomic_store_n(&ring->num_overruns, ring->num_overruns + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&ring->dropped_samples, ring->dropped_samples + (num - space), __ATOMIC_RELAXED);
+        num = space;
+    }
+    /* copy in up to two pieces, then publish the new write position */
+    const uint32_t pos = wr & ring->mask;
+    const uint32_t n0 = ((pos + num) > ring->size) ? (ring->size - pos) : num;
+    memcpy(&ring->buf[pos], samples, n0 * sizeof(float));
+    memcpy(&ring->buf[0], samples + n0, (num - n0) * sizeof(float));
+    __atomic_store_n(&ring->write_pos, wr + num, __ATOMIC_RELEASE);
+    return (int) num;
+}
+
+int audio_ring_pull(audio_ring_t* ring, float* samples, int num_samples) {
+    CHIPS_ASSERT(ring && ring->buf && samples);
+    const uint32_t rd = ring->read_pos;
+    const uint32_t wr = __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE);
+    const uint32_t avail = wr - rd;
+    uint32_t num = (uint32_t) num_samples;
+    if (num > avail) {
+        __atomic_store_n(&ring->num_underruns, ring->num_underruns + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&ring->missing_samples, ring->missing_samples + (num - avail), __ATOMIC_RELAXED);
+        memset(samples + avail, 0, (num - avail) * sizeof(float));
+        num = avail;
+    }
+    const uint32_t pos = rd & ring->mask;
+    const uint32_t n0 = ((pos + num) > ring->size) ? (ring->size - pos) : num;
+    memcpy(samples, &ring->buf[pos], n0 * sizeof(float));
+    memcpy(samples + n0, &ring->buf[0], (num - n0) * sizeof(float));
+    __atomic_store_n(&ring->read_pos, rd + num, __ATOMIC_RELEASE);
+    return (int) num;
+}
+
+int audio_ring_fill(audio_ring_t* ring) {
+    CHIPS_ASSERT(ring && ring->buf);
+    /* read position first, it can never pass the later loaded write position */
+    const uint32_t rd = __atomic_load_n(&ring->read_pos, __ATOMIC_ACQUIRE);
+    const uint32_t wr = __atomic_load_n(&ring->write_pos, __ATOMIC_ACQUIRE);
+    return (int)(wr - rd);
+}
+
+int audio_ring_size(audio_ring_t* ring) {
+    CHIPS_ASSERT(ring && ring->buf);
+    return (int) ring->size;
+}
+
+uint32_t audio_ring_underruns(audio_ring_t* ring) {
+    CHIPS_ASSERT(ring);
+    return __atomic_load_n(&ring->num_underruns, __ATOMIC_RELAXED);
+}
+
+uint32_t audio_ring_overruns(audio_ring_t* ring) {
+    CHIPS_ASSERT(ring);
+    return __atomic_load_n(&ring->num_overruns, __ATOMIC_RELAXED);
+}
+
+#endif /* CHIPS_IMPL */
@@ -0,0 +1,477 @@
+#pragma once
+/*#
+    # capture.h
+
+    Records emulator video and audio to disk or to a pipe, on a background
+    writer thread.
+
+    Do this:
+    ~~~C
+    #define CHIPS_IMPL
+    ~~~
+    before you include this file in *one* C or C++ file to create the
+    implementation.
+
+    Optionally provide the following macros with your own implementation
+
+    ~~~C
+    CHIPS_ASSERT(c)
+    ~~~
+        your own assert macro (default: assert(c))
+
+    You need to include util/audio_ring.h before including capture.h.
+    The implementation uses POSIX threads.
+
+    ## Usage
+
+    Start a capture with capture_start(), then hand each emulated frame
+    to capture_video() (for instance the MC6847 RGBA8 framebuffer after
+    running a frame), and the audio samples to capture_audio() (for
+    instance from the system's audio callback). Both must be called from
+    the same thread. capture_stop() writes out everything that is still
+    queued and closes the files.
+
+    The video output is either a Y4M file (YUV 4:4:4, so that odd frame
+    sizes and single pixels survive), or raw RGBA8 frames, for instance
+    into a named pipe read by an external encoder:
+
+        mkfifo /tmp/video
+        ffmpeg -f rawvideo -pix_fmt rgba -s 320x243 -r 60 -i /tmp/video out.mp4
+
+    The audio output is an optional 16-bit mono WAV file. The files are
+    opened on the writer thread, so opening a pipe without a reader
+    doesn't block the emulator.
+
+    capture_video() never waits for the writer: the frame is copied into
+    one of num_buffers preallocated buffers and queued. When all buffers
+    are queued, the frame is dropped and counted. A dropped frame, or a
+    null pixel pointer for a frame that didn't change, repeats the
+    previous frame in the output without copying it, so that the video
+    stays in sync with the audio. Audio samples go through an audio_ring_t,
+    samples which don't fit are dropped and counted.
+
+    ## zlib/libpng license
+
+    Copyright (c) 2019 Miso Kim
+    This software is provided 'as-is', without any express or implied warranty.
+    In no event will the authors be held liable for any damages arising from the
+    use of this software.
+    Permission is granted to anyone to use this software for any purpose,
+    including commercial applications, and to alter it and redistribute it
+    freely, subject to the following restrictions:
+        1. The origin of this software must not be misrepresented; you must not
+        claim that you wrote the original software. If you use this software in a
+        product, an acknowledgment in the product documentation would be
+        appreciated but is not required.
+        2. Altered source versions must be plainly marked as such, and must not
+        be misrepresented as being the original software.
+        3. This notice may not be removed or altered from any source
+        distribution.
+#*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_DEFAULT_NUM_BUFFERS (16)
+#define CAPTURE_DEFAULT_FPS (60)
+
+/* video output formats */
+typedef enum {
+    CAPTURE_Y4M,        /* YUV4MPEG2 with 4:4:4 chroma */
+    CAPTURE_RAW,        /* raw RGBA8 frames */
+} capture_format_t;
+
+/* capture setup parameters */
+typedef struct {
+    int width;                  /* frame size in pixels */
+    int height;
+    int fps;                    /* frames per second, default is 60 */
+    capture_format_t format;
+    const char* video_path;     /* video output file or pipe, may be null */
+    const char* audio_path;     /* WAV output file, may be null */
+    int sample_rate;            /* audio sample rate */
+    int num_buffers;            /* number of frame buffers, default is 16 */
+    int audio_buffer_size;      /* audio ring size in samples, default is 1 second */
+} capture_desc_t;
+
+/* a queued frame */
+typedef struct {
+    int buffer;                 /* index into the frame buffers */
+    uint32_t repeat;            /* number of times to repeat the previous frame first */
+} capture_frame_t;
+
+/* capture statistics, the frame counts include the repeated frames */
+typedef struct {
+    uint32_t frames;            /* frames passed to capture_video() */
+    uint32_t dropped_frames;    /* frames dropped because all buffers were queued */
+    uint32_t written_frames;    /* frames written to the video output */
+    uint32_t written_samples;   /* samples written to the audio output */
+    uint32_t dropped_samples;   /* samples dropped because the audio ring was full */
+    bool error;                 /* an output couldn't be opened or written */
+} capture_stats_t;
+
+/* capture state */
+typedef struct {
+    int width;
+    int height;
+    int fps;
+    capture_format_t format;
+    const char* video_path;
+    const char* audio_path;
+    int sample_rate;
+    int num_buffers;
+    uint32_t* pixels;           /* num_buffers frame buffers */
+    int* free_buffers;          /* stack of unused buffer indices */
+    int num_free;
+    capture_frame_t* queue;     /* ring of frames waiting for the writer */
+    int queue_head;
+    int num_queued;
+    uint32_t repeat;            /* frames to repeat before the next queued frame */
+    bool has_frame;             /* a frame was queued before */
+    audio_ring_t audio;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool quit;
+    capture_stats_t stats;
+} capture_t;
+
+/* allocate the buffers and start the writer thread */
+void capture_start(capture_t* cap, const capture_desc_t* desc);
+/* write out all queued frames and samples, stop the writer thread and free the buffers */
+void capture_stop(capture_t* cap);
+/* queue a frame of RGBA8 pixels, or repeat the last frame if pixels is null, false if dropped */
+bool capture_video(capture_t* cap, const uint32_t* pixels);
+/* queue audio samples, returns the number of samples queued */
+int capture_audio(capture_t* cap, const float* samples, int num_samples);
+/* get the capture statistics, may be called at any time */
+void capture_stats(capture_t* cap, capture_stats_t* stats);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+/*-- IMPLEMENTATION ----------------------------------------------------------*/
+#ifdef CHIPS_IMPL
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#ifndef CHIPS_ASSERT
+    #include <assert.h>
+    #define CHIPS_ASSERT(c) assert(c)
+#endif
+
+#define _CAPTURE_DEFAULT(val,def) (((val) != 0) ? (val) : (def))
+#define _CAPTURE_AUDIO_CHUNK (1024)
+
+/* writer thread state, only touched by the writer */
+typedef struct {
+    FILE* video;
+    FILE* audio;
+    uint8_t* out;               /* the last frame in the output format */
+    int out_size;
+    uint32_t num_samples;
+} _capture_writer_t;
+
+static void _capture_put_u32(uint8_t* dst, uint32_t v) {
+    dst[0] = (uint8_t)v; dst[1] = (uint8_t)(v>>8); dst[2] = (uint8_t)(v>>16); dst[3] = (uint8_t)(v>>24);
+}
+
+/* 44-byte WAV header for 16-bit mono PCM */
+static void _capture_wav_header(uint8_t* hdr, int sample_rate, uint32_t num_samples) {
+    memcpy(hdr, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\x01\0\0\0\0\0\0\0\0\0\x02\0\x10\0data\0\0\0\0", 44);
+    _capture_put_u32(hdr + 4, 36 + num_samples * 2);
+    _capture_put_u32(hdr + 24, (uint32_t) sample_rate);
+    _capture_put_u32(hdr + 28, (uint32_t) sample_rate * 2);
+    _capture_put_u32(hdr + 40, num_samples * 2);
+}
+
+static void _capture_error(capture_t* cap) {
+    __atomic_store_n(&cap->stats.error, true, __ATOMIC_RELAXED);
+}
+
+/* convert a frame to the output format, BT.601 limited range for Y4M */
+static void _capture_convert(capture_t* cap, const uint32_t* src, uint8_t* dst) {
+    const int num = cap->width * cap->height;
+    if (cap->format == CAPTURE_RAW) {
+        memcpy(dst, src, num * sizeof(uint32_t));
+        return;
+    }
+    memcpy(dst, "FRAME\n", 6);
+    uint8_t* y_plane = dst + 6;
+    uint8_t* u_plane = y_plane + num;
+    uint8_t* v_plane = u_plane + num;
+    for (int i = 0; i < num; i++) {
+        /* R in the lowest byte */
+        const int r = src[i] & 0xFF;
+        const int g = (src[i] >> 8) & 0xFF;
+        const int b = (src[i] >> 16) & 0xFF;
+        y_plane[i] = (uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u_plane[i] = (uint8_t) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v_plane[i] = (uint8_t) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+}
+
+/* write the last converted frame num times */
+static void _capture_write_frames(capture_t* cap, _capture_writer_t* wr, uint32_t num) {
+    for (uint32_t i = 0; (i < num) && wr->video; i++) {
+        if (fwrite(wr->out, wr->out_size, 1, wr->video) != 1) {
+            /* for instance the encoder closed the pipe */
+            _capture_error(cap);
+            fclose(wr->video);
+            wr->video = 0;
+            break;
+        }
+        __atomic_store_n(&cap->stats.written_frames, cap->stats.written_frames + 1, __ATOMIC_RELAXED);
+    }
+}
+
+/* move the samples from the audio ring into the WAV file */
+static void _capture_write_audio(capture_t* cap, _capture_writer_t* wr) {
+    float samples[_CAPTURE_AUDIO_CHUNK];
+    int16_t pcm[_CAPTURE_AUDIO_CHUNK];
+    int num;
+    while ((num = audio_ring_fill(&cap->audio)) > 0) {
+        num = (num > _CAPTURE_AUDIO_CHUNK) ? _CAPTURE_AUDIO_CHUNK : num;
+        audio_ring_pull(&cap->audio, samples, num);
+        if (!wr->audio) {
+            continue;
+        }
+        for (int i = 0; i < num; i++) {
+            const float s = samples[i] * 32767.0f;
+            pcm[i] = (int16_t) ((s > 32767.0f) ? 32767.0f : ((s < -32768.0f) ? -32768.0f : s));
+        }
+        if (fwrite(pcm, sizeof(int16_t), num, wr->audio) != (size_t)num) {
+            _capture_error(cap);
+            fclose(wr->audio);
+            wr->audio = 0;
+            continue;
+        }
+        wr->num_samples += num;
+        __atomic_store_n(&cap->stats.written_samples, wr->num_samples, __ATOMIC_RELAXED);
+    }
+}
+
+static void _capture_open(capture_t* cap, _capture_writer_t* wr) {
+    if (cap->video_path) {
+        wr->video = fopen(cap->video_path, "wb");
+        if (!wr->video) {
+            _capture_error(cap);
+        }
+        else if (cap->format == CAPTURE_Y4M) {
+            fprintf(wr->video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", cap->width, cap->height, cap->fps);
+        }
+    }
+    if (cap->audio_path) {
+        wr->audio = fopen(cap->audio_path, "wb");
+        if (!wr->audio) {
+            _capture_error(cap);
+        }
+        else {
+            /* the sizes are patched in when closing, unless the output is a pipe */
+            uint8_t hdr[44];
+            _capture_wav_header(hdr, cap->sample_rate, 0x7FFFFFF0);
+            fwrite(hdr, sizeof(hdr), 1, wr->audio);
+        }
+    }
+}
+
+static void _capture_close(capture_t* cap, _capture_writer_t* wr) {
+    if (wr->video) {
+        if (0 != fclose(wr->video)) {
+            _capture_error(cap);
+        }
+    }
+    if (wr->audio) {
+        if (0 == fseek(wr->audio, 0, SEEK_SET)) {
+            uint8_t hdr[44];
+            _capture_wav_header(hdr, cap->sample_rate, wr->num_samples);
+            fwrite(hdr, sizeof(hdr), 1, wr->audio);
+        }
+        if (0 != fclose(wr->audio)) {
+            _capture_error(cap);
+        }
+    }
+}
+
+static void* _capture_thread(void* arg) {
+    capture_t* cap = (capture_t*) arg;
+    /* a closed pipe must fail the write instead of killing the process */
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, 0);
+
+    _capture_writer_t wr;
+    memset(&wr, 0, sizeof(wr));
+    const int num_pixels = cap->width * cap->height;
+    wr.out_size = (cap->format == CAPTURE_RAW) ? (num_pixels * 4) : (6 + num_pixels * 3);
+    wr.out = (uint8_t*) calloc(1, wr.out_size);
+    CHIPS_ASSERT(wr.out);
+    if (cap->format == CAPTURE_Y4M) {
+        /* black until the first frame arrives */
+        memcpy(wr.out, "FRAME\n", 6);
+        memset(wr.out + 6, 16, num_pixels);
+        memset(wr.out + 6 + num_pixels, 128, num_pixels * 2);
+    }
+    _capture_open(cap, &wr);
+
+    pthread_mutex_lock(&cap->lock);
+    for (;;) {
+        if ((cap->num_queued == 0) && !cap->quit) {
+            /* wake up regularly to drain the audio ring */
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += 20000000;
+            if (ts.tv_nsec >= 1000000000) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&cap->cond, &cap->lock, &ts);
+        }
+        capture_frame_t frame = { -1, 0 };
+        if (cap->num_queued > 0) {
+            frame = cap->queue[cap->queue_head];
+            cap->queue_head = (cap->queue_head + 1) % cap->num_buffers;
+            cap->num_queued--;
+        }
+        const bool quit = cap->quit;
+        pthread_mutex_unlock(&cap->lock);
+
+        _capture_write_audio(cap, &wr);
+        if (frame.buffer >= 0) {
+            _capture_write_frames(cap, &wr, frame.repeat);
+            _capture_convert(cap, &cap->pixels[frame.buffer * num_pixels], wr.out);
+            _capture_write_frames(cap, &wr, 1);
+        }
+
+        pthread_mutex_lock(&cap->lock);
+        if (frame.buffer >= 0) {
+            cap->free_buffers[cap->num_free++] = frame.buffer;
+        }
+        else if (quit) {
+            break;
+        }
+    }
+    /* the frames after the last queued frame */
+    const uint32_t repeat = cap->repeat;
+    pthread_mutex_unlock(&cap->lock);
+    _capture_write_frames(cap, &wr, repeat);
+    _capture_write_audio(cap, &wr);
+    _capture_close(cap, &wr);
+    free(wr.out);
+    return 0;
+}
+
+void capture_start(capture_t* cap, const capture_desc_t* desc) {
+    CHIPS_ASSERT(cap && desc && (desc->width > 0) && (desc->height > 0));
+    CHIPS_ASSERT(!desc->audio_path || (desc->sample_rate > 0));
+    memset(cap, 0, sizeof(capture_t));
+    cap->width = desc->width;
+    cap->height = desc->height;
+    cap->fps = _CAPTURE_DEFAULT(desc->fps, CAPTURE_DEFAULT_FPS);
+    cap->format = desc->format;
+    cap->video_path = desc->video_path;
+    cap->audio_path = desc->audio_path;
+    cap->sample_rate = desc->sample_rate;
+    cap->num_buffers = _CAPTURE_DEFAULT(desc->num_buffers, CAPTURE_DEFAULT_NUM_BUFFERS);
+    cap->pixels = (uint32_t*) malloc((size_t)cap->num_buffers * cap->width * cap->height * sizeof(uint32_t));
+    cap->free_buffers = (int*) malloc(cap->num_buffers * sizeof(int));
+    cap->queue = (capture_frame_t*) malloc(cap->num_buffers * sizeof(capture_frame_t));
+    CHIPS_ASSERT(cap->pixels && cap->free_buffers && cap->queue);
+    for (int i = 0; i < cap->num_buffers; i++) {
+        cap->free_buffers[i] = i;
+    }
+    cap->num_free = cap->num_buffers;
+    audio_ring_init(&cap->audio, _CAPTURE_DEFAULT(desc->audio_buffer_size, cap->sample_rate));
+    pthread_mutex_init(&cap->lock, 0);
+    pthread_cond_init(&cap->cond, 0);
+    pthread_create(&cap->thread, 0, _capture_thread, cap);
+}
+
+void capture_stop(capture_t* cap) {
+    CHIPS_ASSERT(cap && cap->pixels);
+    pthread_mutex_lock(&cap->lock);
+    cap->quit = true;
+    pthread_cond_signal(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+    pthread_join(cap->thread, 0);
+    pthread_cond_destroy(&cap->cond);
+    pthread_mutex_destroy(&cap->lock);
+    cap->stats.dropped_samples = cap->audio.dropped_samples;
+    audio_ring_discard(&cap->audio);
+    free(cap->queue);
+    free(cap->free_buffers);
+    free(cap->pixels);
+    cap->queue = 0;
+    cap->free_buffers = 0;
+    cap->pixels = 0;
+}
+
+bool capture_video(capture_t* cap, const uint32_t* pixels) {
+    CHIPS_ASSERT(cap && cap->pixels);
+    __atomic_store_n(&cap->stats.frames, cap->stats.frames + 1, __ATOMIC_RELAXED);
+    const bool unchanged = !pixels && cap->has_frame;
+    pthread_mutex_lock(&cap->lock);
+    int buffer = -1;
+    if (!unchanged && (cap->num_free > 0)) {
+        buffer = cap->free_buffers[--cap->num_free];
+    }
+    if (buffer < 0) {
+        /* unchanged or dropped, repeat the previous frame */
+        cap->repeat++;
+        pthread_mutex_unlock(&cap->lock);
+        if (!unchanged) {
+            __atomic_store_n(&cap->stats.dropped_frames, cap->stats.dropped_frames + 1, __ATOMIC_RELAXED);
+        }
+        return unchanged;
+    }
+    pthread_mutex_unlock(&cap->lock);
+
+    /* the buffer belongs to this thread until it is queued */
+    const int num_pixels = cap->width * cap->height;
+    uint32_t* dst = &cap->pixels[buffer * num_pixels];
+    if (pixels) {
+        memcpy(dst, pixels, num_pixels * sizeof(uint32_t));
+    }
+    else {
+        /* no frame yet */
+        memset(dst, 0, num_pixels * sizeof(uint32_t));
+    }
+
+    pthread_mutex_lock(&cap->lock);
+    const int tail = (cap->queue_head + cap->num_queued) % cap->num_buffers;
+    cap->queue[tail].buffer = buffer;
+    cap->queue[tail].repeat = cap->repeat;
+    cap->num_queued++;
+    cap->repeat = 0;
+    cap->has_frame = true;
+    pthread_cond_signal(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+    return true;
+}
+
+int capture_audio(capture_t* cap, const float* samples, int num_samples) {
+    CHIPS_ASSERT(cap && cap->pixels && samples);
+    if (!cap->audio_path) {
+        return 0;
+    }
+    return audio_ring_push(&cap->audio, samples, num_samples);
+}
+
+void capture_stats(capture_t* cap, capture_stats_t* stats) {
+    CHIPS_ASSERT(cap && stats);
+    stats->frames = __atomic_load_n(&cap->stats.frames, __ATOMIC_RELAXED);
+    stats->dropped_frames = __atomic_load_n(&cap->stats.dropped_frames, __ATOMIC_RELAXED);
+    stats->written_frames = __atomic_load_n(&cap->stats.written_frames, __ATOMIC_RELAXED);
+    stats->written_samples = __atomic_load_n(&cap->stats.written_samples, __ATOMIC_RELAXED);
+    stats->dropped_samples = cap->pixels ? __atomic_load_n(&cap->audio.dropped_samples, __ATOMIC_RELAXED) : cap->stats.dropped_samples;
+    stats->error = __atomic_load_n(&cap->stats.error, __ATOMIC_RELAXED);
+}
+
+#endif /* CHIPS_IMPL */
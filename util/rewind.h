@@ -0,0 +1,320 @@
+#pragma once
+/*#
+    # rewind.h
+
+    A rewind ring buffer for fixed-size emulator save states.
+
+    Do this:
+    ~~~C
+    #define CHIPS_IMPL
+    ~~~
+    before you include this file in *one* C or C++ file to create the
+    implementation.
+
+    Optionally provide the following macros with your own implementation
+
+    ~~~C
+    CHIPS_ASSERT(c)
+    ~~~
+        your own assert macro (default: assert(c))
+
+    ## Usage
+
+    Push one save state per frame with rewind_push(), and step back one
+    frame with rewind_pop(), which returns the state that was pushed
+    before the current one.
+
+    The most recent state is kept uncompressed. Older states are stored
+    as the XOR difference to the next newer state, run-length encoded,
+    so that stepping back only needs one pass over the newest entry.
+    Every key_interval-th state is stored as a complete (run-length
+    encoded) key frame instead. Most frames only change a few hundred
+    bytes of RAM and VRAM, so a delta entry is usually tiny.
+
+    The buffer memory is fixed at init time, when the buffer is full or
+    max_states is reached, the oldest states are dropped.
+
+    ## zlib/libpng license
+
+    Copyright (c) 2019 Miso Kim
+    This software is provided 'as-is', without any express or implied warranty.
+    In no event will the authors be held liable for any damages arising from the
+    use of this software.
+    Permission is granted to anyone to use this software for any purpose,
+    including commercial applications, and to alter it and redistribute it
+    freely, subject to the following restrictions:
+        1. The origin of this software must not be misrepresented; you must not
+        claim that you wrote the original software. If you use this software in a
+        product, an acknowledgment in the product documentation would be
+        appreciated but is not required.
+        2. Altered source versions must be plainly marked as such, and must not
+        be misrepresented as being the original software.
+        3. This notice may not be removed or altered from any source
+        distribution.
+#*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REWIND_DEFAULT_BUFFER_SIZE (32*1024*1024)
+#define REWIND_DEFAULT_MAX_STATES (60*60)       /* 60 seconds at 60 Hz */
+#define REWIND_DEFAULT_KEY_INTERVAL (60)
+
+/* rewind buffer setup parameters */
+typedef struct {
+    int state_size;         /* size of one save state in bytes */
+    int buffer_size;        /* compressed state memory in bytes, default is 32 MB */
+    int max_states;         /* max number of states to keep, default is 3600 */
+    int key_interval;       /* store every n-th state as key frame, default is 60 */
+} rewind_desc_t;
+
+/* a stored state */
+typedef struct {
+    uint32_t offset;        /* byte offset in the ring buffer */
+    uint32_t size;          /* encoded size in bytes */
+    bool key;               /* true for a key frame, false for a delta to the next state */
+} rewind_entry_t;
+
+/* rewind buffer state */
+typedef struct {
+    int state_size;
+    int buffer_size;
+    int max_states;
+    int key_interval;
+    uint8_t* buffer;        /* the ring buffer with the encoded states */
+    uint8_t* scratch;       /* encoder output, worst case size */
+    uint8_t* last;          /* the most recent state, uncompressed */
+    bool has_last;
+    rewind_entry_t* entries;    /* entry queue, from oldest to newest */
+    int head;               /* index of the oldest entry */
+    int num;                /* number of entries */
+    uint32_t write_pos;     /* ring buffer offset behind the newest entry */
+    uint32_t push_count;
+} rewind_t;
+
+/* initialize a rewind buffer, this allocates the buffer memory */
+void rewind_init(rewind_t* rw, const rewind_desc_t* desc);
+/* free the rewind buffer memory */
+void rewind_discard(rewind_t* rw);
+/* drop all stored states */
+void rewind_reset(rewind_t* rw);
+/* push a new state of state_size bytes */
+void rewind_push(rewind_t* rw, const void* state);
+/* step back one state, copies the previous state into 'state', false if there is none */
+bool rewind_pop(rewind_t* rw, void* state);
+/* number of states that can be stepped back */
+int rewind_num_states(rewind_t* rw);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+/*-- IMPLEMENTATION ----------------------------------------------------------*/
+#ifdef CHIPS_IMPL
+#include <string.h>
+#include <stdlib.h>
+#ifndef CHIPS_ASSERT
+    #include <assert.h>
+    #define CHIPS_ASSERT(c) assert(c)
+#endif
+
+#define _REWIND_DEFAULT(val,def) (((val) != 0) ? (val) : (def))
+
+void rewind_init(rewind_t* rw, const rewind_desc_t* desc) {
+    CHIPS_ASSERT(rw && desc && (desc->state_size > 0));
+    memset(rw, 0, sizeof(rewind_t));
+    rw->state_size = desc->state_size;
+    rw->buffer_size = _REWIND_DEFAULT(desc->buffer_size, REWIND_DEFAULT_BUFFER_SIZE);
+    rw->max_states = _REWIND_DEFAULT(desc->max_states, REWIND_DEFAULT_MAX_STATES);
+    rw->key_interval = _REWIND_DEFAULT(desc->key_interval, REWIND_DEFAULT_KEY_INTERVAL);
+    rw->buffer = (uint8_t*) malloc(rw->buffer_size);
+    /* worst case: one zero run and one literal run per 2 bytes */
+    rw->scratch = (uint8_t*) malloc(rw->state_size * 2 + 16);
+    rw->last = (uint8_t*) malloc(rw->state_size);
+    rw->entries = (rewind_entry_t*) malloc(rw->max_states * sizeof(rewind_entry_t));
+    CHIPS_ASSERT(rw->buffer && rw->scratch && rw->last && rw->entries);
+}
+
+void rewind_discard(rewind_t* rw) {
+    CHIPS_ASSERT(rw && rw->buffer);
+    free(rw->buffer);
+    free(rw->scratch);
+    free(rw->last);
+    free(rw->entries);
+    memset(rw, 0, sizeof(rewind_t));
+}
+
+void rewind_reset(rewind_t* rw) {
+    CHIPS_ASSERT(rw && rw->buffer);
+    rw->has_last = false;
+    rw->head = 0;
+    rw->num = 0;
+    rw->write_pos = 0;
+    rw->push_count = 0;
+}
+
+int rewind_num_states(rewind_t* rw) {
+    CHIPS_ASSERT(rw && rw->buffer);
+    return rw->num;
+}
+
+static uint8_t* _rewind_put_varint(uint8_t* dst, uint32_t val) {
+    while (val >= 0x80) {
+        *dst++ = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    *dst++ = (uint8_t)val;
+    return dst;
+}
+
+static const uint8_t* _rewind_get_varint(const uint8_t* src, uint32_t* val) {
+    uint32_t v = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+        b = *src++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    *val = v;
+    return src;
+}
+
+/*  run-length encode a^b (or a alone if b is null) as a sequence of
+    (zero run length, literal run length, literal bytes)
+*/
+static uint32_t _rewind_encode(const uint8_t* a, const uint8_t* b, int size, uint8_t* dst) {
+    uint8_t* out = dst;
+    int i = 0;
+    while (i < size) {
+        int start = i;
+        if (b) {
+            while ((i < size) && (a[i] == b[i])) {
+                i++;
+            }
+        }
+        else {
+            while ((i < size) && (a[i] == 0)) {
+                i++;
+            }
+        }
+        out = _rewind_put_varint(out, (uint32_t)(i - start));
+        start = i;
+        if (b) {
+            while ((i < size) && (a[i] != b[i])) {
+                i++;
+            }
+            out = _rewind_put_varint(out, (uint32_t)(i - start));
+            for (int j = start; j < i; j++) {
+                *out++ = a[j] ^ b[j];
+            }
+        }
+        else {
+            while ((i < size) && (a[i] != 0)) {
+                i++;
+            }
+            out = _rewind_put_varint(out, (uint32_t)(i - start));
+            memcpy(out, &a[start], i - start);
+            out += i - start;
+        }
+    }
+    return (uint32_t)(out - dst);
+}
+
+/* XOR an encoded stream into a state */
+static void _rewind_decode(const uint8_t* src, uint32_t src_size, uint8_t* state, int size) {
+    const uint8_t* end = src + src_size;
+    int i = 0;
+    while (src < end) {
+        uint32_t zeros, literals;
+        src = _rewind_get_varint(src, &zeros);
+        src = _rewind_get_varint(src, &literals);
+        i += zeros;
+        CHIPS_ASSERT((i + (int)literals) <= size);
+        for (uint32_t j = 0; j < literals; j++) {
+            state[i++] ^= *src++;
+        }
+    }
+    (void)size;
+}
+
+static void _rewind_drop_oldest(rewind_t* rw) {
+    CHIPS_ASSERT(rw->num > 0);
+    rw->head = (rw->head + 1) % rw->max_states;
+    rw->num--;
+}
+
+static rewind_entry_t* _rewind_entry(rewind_t* rw, int i) {
+    return &rw->entries[(rw->head + i) % rw->max_states];
+}
+
+/* find room for an entry of num_bytes, dropping the oldest entries as needed */
+static uint32_t _rewind_alloc(rewind_t* rw, uint32_t num_bytes) {
+    uint32_t pos = rw->write_pos;
+    if (rw->num == rw->max_states) {
+        _rewind_drop_oldest(rw);
+    }
+    while (rw->num > 0) {
+        const uint32_t tail = _rewind_entry(rw, 0)->offset;
+        if (tail >= pos) {
+            /* free space is between pos and the oldest entry */
+            if ((pos + num_bytes) <= tail) {
+                return pos;
+            }
+            _rewind_drop_oldest(rw);
+        }
+        else {
+            /* free space is behind pos up to the end, and in front of the oldest entry */
+            if ((pos + num_bytes) <= (uint32_t)rw->buffer_size) {
+                return pos;
+            }
+            pos = 0;
+        }
+    }
+    return ((pos + num_bytes) <= (uint32_t)rw->buffer_size) ? pos : 0;
+}
+
+void rewind_push(rewind_t* rw, const void* state) {
+    CHIPS_ASSERT(rw && rw->buffer && state);
+    if (rw->has_last) {
+        /* store the previous state as key frame or as delta to the new state */
+        const bool key = 0 == (rw->push_count % rw->key_interval);
+        const uint32_t size = _rewind_encode(rw->last, key ? 0 : (const uint8_t*)state, rw->state_size, rw->scratch);
+        if (size <= (uint32_t)rw->buffer_size) {
+            const uint32_t pos = _rewind_alloc(rw, size);
+            memcpy(rw->buffer + pos, rw->scratch, size);
+            rewind_entry_t* entry = _rewind_entry(rw, rw->num++);
+            entry->offset = pos;
+            entry->size = size;
+            entry->key = key;
+            rw->write_pos = pos + size;
+        }
+        else {
+            rewind_reset(rw);
+        }
+    }
+    memcpy(rw->last, state, rw->state_size);
+    rw->has_last = true;
+    rw->push_count++;
+}
+
+bool rewind_pop(rewind_t* rw, void* state) {
+    CHIPS_ASSERT(rw && rw->buffer && state);
+    if (rw->num == 0) {
+        return false;
+    }
+    rewind_entry_t* entry = _rewind_entry(rw, --rw->num);
+    if (entry->key) {
+        memset(rw->last, 0, rw->state_size);
+    }
+    _rewind_decode(rw->buffer + entry->offset, entry->size, rw->last, rw->state_size);
+    rw->write_pos = entry->offset;
+    rw->push_count--;
+    memcpy(state, rw->last, rw->state_size);
+    return true;
+}
+
+#endif /* CHIPS_IMPL */